@@ -45,6 +45,9 @@ extern "C" {
 
 #define SUSCAN_ANALYZER_GUARD_BAND_PROPORTION 1.1
 #define SUSCAN_ANALYZER_FS_MEASURE_INTERVAL   1.0
+#define SUSCAN_ANALYZER_SAMPLES_LOST_INTERVAL 1.0
+#define SUSCAN_ANALYZER_SWEEP_RATE_INTERVAL   1.0
+#define SUSCAN_ANALYZER_SWEEP_DEFAULT_REVISIT 1.0 /* When no bands are set */
 
 /* Permissions */
 #define SUSCAN_ANALYZER_PERM_HALT               (1ull << 0)
@@ -85,6 +88,9 @@ extern "C" {
 #define SUSCAN_ANALYZER_SLOW_RATE             44100
 #define SUSCAN_ANALYZER_SLOW_READ_SIZE        32
 #define SUSCAN_ANALYZER_FAST_READ_SIZE        1024
+#define SUSCAN_ANALYZER_READ_LATENCY          5e-3 /* Seconds per read block */
+#define SUSCAN_ANALYZER_MAX_READ_WINDOWS      8    /* In tuner windows */
+#define SUSCAN_ANALYZER_PSD_QUEUE_DEPTH       4    /* Blocks for the PSD worker */
 #define SUSCAN_ANALYZER_MIN_POST_HOP_FFTS     7
 
 struct suscan_analyzer;
@@ -115,6 +121,13 @@ SUSCAN_SERIALIZABLE(suscan_analyzer_params) {
   SUFLOAT  psd_update_int;     /*!< Spectrum update interval (seconds) */
   SUFREQ   min_freq; /*!< Minimum sweep frequency (only in wide spectrum mode) */
   SUFREQ   max_freq; /*!< Maximum sweep frequency (only in wide spectrum mode) */
+
+  /* Local-only parameters (not serialized) */
+  enum suscan_inspsched_policy inspsched_policy; /*!< Inspector scheduling policy */
+  unsigned int inspsched_pipeline_depth; /*!< Windows in flight (0: synchronous) */
+  unsigned int capture_ring_depth; /*!< SDR capture ring blocks (0: no capture thread) */
+  SUBOOL free_run; /*!< File sources: no throttling, throughput report at EOS */
+  SUSCOUNT read_size; /*!< Samples per read block (0: adaptive) */
 };
 
 #define suscan_analyzer_params_INITIALIZER {                               \
@@ -124,6 +137,11 @@ SUSCAN_SERIALIZABLE(suscan_analyzer_params) {
   SU_ADDSFX(0.04),                              /* psd_update_int */        \
   0,                                            /* min_freq */              \
   0,                                            /* max_freq */              \
+  SUSCAN_INSPSCHED_POLICY_ROUND_ROBIN,          /* inspsched_policy */      \
+  0,                                            /* pipeline_depth */        \
+  0,                                            /* capture_ring_depth */    \
+  SU_FALSE,                                     /* free_run */              \
+  0,                                            /* read_size */             \
 }
 
 SUSCAN_SERIALIZABLE(suscan_analyzer_gain_info) {
@@ -181,8 +199,12 @@ void suscan_analyzer_gain_info_destroy(struct suscan_analyzer_gain_info *self);
 enum suscan_analyzer_sweep_strategy {
   SUSCAN_ANALYZER_SWEEP_STRATEGY_STOCHASTIC,
   SUSCAN_ANALYZER_SWEEP_STRATEGY_PROGRESSIVE,
+  SUSCAN_ANALYZER_SWEEP_STRATEGY_SCHEDULED,
 };
 
+#define SUSCAN_ANALYZER_SWEEP_STRATEGY_COUNT \
+  (SUSCAN_ANALYZER_SWEEP_STRATEGY_SCHEDULED + 1)
+
 /*!
  * \brief Wideband analyzer spectrum partitioning
  *
@@ -839,6 +861,24 @@ SUBOOL suscan_analyzer_seek_async(
     const struct timeval *pos,
     uint32_t req_id);
 
+/*!
+ * For wideband analyzers using the scheduled sweep strategy, sets the
+ * target revisit time of a frequency band (asynchronous). Partitions
+ * outside any band are revisited as often as the least demanding band.
+ * \param analyzer pointer to the analyzer object
+ * \param min_freq lower frequency of the band
+ * \param max_freq upper frequency of the band
+ * \param revisit target revisit time, in seconds (0 removes all bands)
+ * \param req_id arbitrary request identifier used to match responses
+ * \return SU_TRUE for success or SU_FALSE on failure
+ */
+SUBOOL suscan_analyzer_set_sweep_band_async(
+    suscan_analyzer_t *analyzer,
+    SUFREQ min_freq,
+    SUFREQ max_freq,
+    SUFLOAT revisit,
+    uint32_t req_id);
+
 /*!
  * For channel analyzers, open a new inspector of a given class at a given
  * frequency (asynchronous).
@@ -1031,6 +1071,25 @@ SUBOOL suscan_analyzer_set_inspector_watermark_async(
     SUSCOUNT watermark,
     uint32_t req_id);
 
+/*!
+ * For channel analyzers, set the power gate of an inspector. While the
+ * mean power of the channel stays below the threshold, the inspector is
+ * suspended and its samples are not processed. Changes in the suspension
+ * state are reported by means of GATE_REPORT inspector messages.
+ * \param analyzer pointer to the analyzer object
+ * \param handle inspector handle
+ * \param threshold mean channel power (linear). 0 disables the gate
+ * \param policy whether to freeze or reset the demodulator on suspension
+ * \param req_id arbitrary request identifier used to match responses
+ * \return SU_TRUE for success or SU_FALSE on failure
+ */
+SUBOOL suscan_analyzer_set_inspector_gate_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUFLOAT threshold,
+    enum suscan_inspector_gate_policy policy,
+    uint32_t req_id);
+
 /*!
  * For channel analyzer, enable or disable a channel parameter estimator
  * associated to an inspector (asynchronous).
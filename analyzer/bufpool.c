@@ -18,85 +18,333 @@
 
 #define SU_LOG_DOMAIN "bufpool"
 
+#include <stdlib.h>
 #include <sigutils/log.h>
 
 #include "bufpool.h"
 
-#define MIN_POOL 5
-#define NUM_POOLS 16
+#define MIN_POOL  SUSCAN_POOL_MIN_CLASS
+#define NUM_POOLS SUSCAN_POOL_NUM_CLASSES
 
 SUPRIVATE struct suscan_pool pools[NUM_POOLS];
 
+/****************************** Global slots *********************************/
+SUPRIVATE struct suscan_buffer_header *
+suscan_pool_take(struct suscan_pool *pool)
+{
+  struct suscan_buffer_header *header;
+  unsigned int i;
 
-void
-suscan_buffer_return(SUCOMPLEX *data)
+  for (i = 0; i < SUSCAN_POOL_SLOTS; ++i) {
+    if (__atomic_load_n(&pool->slots[i], __ATOMIC_RELAXED) == NULL)
+      continue;
+
+    header = __atomic_exchange_n(&pool->slots[i], NULL, __ATOMIC_ACQUIRE);
+    if (header != NULL)
+      return header;
+  }
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+suscan_pool_give(struct suscan_pool *pool, struct suscan_buffer_header *header)
+{
+  struct suscan_buffer_header *expected;
+  unsigned int i;
+
+  for (i = 0; i < SUSCAN_POOL_SLOTS; ++i) {
+    expected = NULL;
+    if (__atomic_compare_exchange_n(
+          &pool->slots[i],
+          &expected,
+          header,
+          SU_FALSE,
+          __ATOMIC_RELEASE,
+          __ATOMIC_RELAXED))
+      return SU_TRUE;
+  }
+
+  return SU_FALSE;
+}
+
+/* Buffers are only kept if the free bytes of their class stay in budget */
+SUPRIVATE SUBOOL
+suscan_pool_reserve_idle(struct suscan_pool *pool, unsigned int index)
+{
+  uint64_t size = (uint64_t) 1 << index;
+
+  if (__atomic_add_fetch(&pool->bytes_idle, size, __ATOMIC_RELAXED)
+    <= SUSCAN_POOL_MAX_IDLE_BYTES)
+    return SU_TRUE;
+
+  __atomic_sub_fetch(&pool->bytes_idle, size, __ATOMIC_RELAXED);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE void
+suscan_pool_release_idle(struct suscan_pool *pool, unsigned int index)
+{
+  __atomic_sub_fetch(
+    &pool->bytes_idle,
+    (uint64_t) 1 << index,
+    __ATOMIC_RELAXED);
+}
+
+SUPRIVATE void
+suscan_pool_free(struct suscan_pool *pool, struct suscan_buffer_header *header)
+{
+  __atomic_sub_fetch(&pool->allocated, 1, __ATOMIC_RELAXED);
+  free(header);
+}
+
+/* The buffer must be accounted as idle */
+SUPRIVATE void
+suscan_pool_give_or_free(
+  struct suscan_pool *pool,
+  struct suscan_buffer_header *header)
+{
+  if (!suscan_pool_give(pool, header)) {
+    suscan_pool_release_idle(pool, header->pool_index);
+    suscan_pool_free(pool, header);
+  }
+}
+
+/****************************** Thread caches ********************************/
+struct suscan_bufpool_cache {
+  struct suscan_buffer_header *free[NUM_POOLS][SUSCAN_POOL_THREAD_CACHE];
+  unsigned int count[NUM_POOLS];
+};
+
+SUPRIVATE pthread_once_t g_bufpool_cache_once = PTHREAD_ONCE_INIT;
+SUPRIVATE pthread_key_t  g_bufpool_cache_key;
+SUPRIVATE SUBOOL         g_bufpool_cache_key_init = SU_FALSE;
+
+SUPRIVATE void
+suscan_bufpool_cache_flush(
+  struct suscan_bufpool_cache *cache,
+  unsigned int index,
+  unsigned int keep)
+{
+  while (cache->count[index] > keep)
+    suscan_pool_give_or_free(
+      pools + index,
+      cache->free[index][--cache->count[index]]);
+}
+
+SUPRIVATE void
+suscan_bufpool_cache_refill(
+  struct suscan_bufpool_cache *cache,
+  unsigned int index)
 {
   struct suscan_buffer_header *header;
-  unsigned int index;
 
-  header = (struct suscan_buffer_header *) (
-      (char *) data - sizeof(struct suscan_buffer_header));
+  while (cache->count[index] < SUSCAN_POOL_THREAD_CACHE / 2
+    && (header = suscan_pool_take(pools + index)) != NULL)
+    cache->free[index][cache->count[index]++] = header;
+}
+
+SUPRIVATE void
+suscan_bufpool_cache_dtor(void *data)
+{
+  struct suscan_bufpool_cache *cache = (struct suscan_bufpool_cache *) data;
+  unsigned int i;
+
+  for (i = 0; i < NUM_POOLS; ++i)
+    suscan_bufpool_cache_flush(cache, i, 0);
 
-  if (header->pool_index >= NUM_POOLS) {
+  free(cache);
+}
+
+SUPRIVATE void
+suscan_bufpool_cache_init_key(void)
+{
+  g_bufpool_cache_key_init =
+    pthread_key_create(&g_bufpool_cache_key, suscan_bufpool_cache_dtor) == 0;
+}
+
+SUPRIVATE struct suscan_bufpool_cache *
+suscan_bufpool_cache_get(void)
+{
+  struct suscan_bufpool_cache *cache;
+
+  (void) pthread_once(&g_bufpool_cache_once, suscan_bufpool_cache_init_key);
+
+  if (!g_bufpool_cache_key_init)
+    return NULL;
+
+  if ((cache = pthread_getspecific(g_bufpool_cache_key)) == NULL) {
+    if ((cache = calloc(1, sizeof(struct suscan_bufpool_cache))) == NULL)
+      return NULL;
+
+    if (pthread_setspecific(g_bufpool_cache_key, cache) != 0) {
+      free(cache);
+      return NULL;
+    }
+  }
+
+  return cache;
+}
+
+/******************************* Public API **********************************/
+void
+suscan_bufpool_ref(void *data)
+{
+  struct suscan_buffer_header *header = suscan_bufpool_get_header(data);
+
+  __atomic_add_fetch(&header->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+void
+suscan_bufpool_return(void *data)
+{
+  struct suscan_buffer_header *header = suscan_bufpool_get_header(data);
+  struct suscan_bufpool_cache *cache;
+  unsigned int index;
+
+  if (header->pool_index < MIN_POOL || header->pool_index >= NUM_POOLS) {
     SU_ERROR("*** INVALID POOL BUFFER RETURN ***\n");
     abort();
   }
 
+  if (__atomic_sub_fetch(&header->refcnt, 1, __ATOMIC_ACQ_REL) != 0)
+    return;
+
   index = header->pool_index;
 
-  pthread_mutex_lock(&pools[index].mutex);
-  header->next = pools[index].first;
-  pools[index].first = header;
-  pthread_mutex_lock(&pools[index].mutex);
+  __atomic_sub_fetch(
+    &pools[index].bytes_outstanding,
+    (uint64_t) 1 << index,
+    __ATOMIC_RELAXED);
+
+  if (!suscan_pool_reserve_idle(pools + index, index)) {
+    suscan_pool_free(pools + index, header);
+    return;
+  }
+
+  if ((cache = suscan_bufpool_cache_get()) == NULL) {
+    /* No thread cache available. Return it directly to the pool. */
+    suscan_pool_give_or_free(pools + index, header);
+    return;
+  }
+
+  if (cache->count[index] == SUSCAN_POOL_THREAD_CACHE)
+    suscan_bufpool_cache_flush(cache, index, SUSCAN_POOL_THREAD_CACHE / 2);
 
+  cache->free[index][cache->count[index]++] = header;
 }
 
-SUCOMPLEX *
-suscan_buffer_alloc(unsigned int length)
+void *
+suscan_bufpool_alloc(size_t size)
 {
-  unsigned int i = 0;
+  unsigned int i = MIN_POOL;
+  struct suscan_bufpool_cache *cache;
   struct suscan_buffer_header *header = NULL;
 
-  while ((length >>= 1) != 0)
+  /* Smallest size class that fits the requested size */
+  while (i < NUM_POOLS && ((size_t) 1 << i) < size)
     ++i;
 
-  if (i < MIN_POOL)
-    i = MIN_POOL;
-
   if (i >= NUM_POOLS) {
-    SU_ERROR("Pool allocation of %d samples is too big\n", length);
+    SU_ERROR(
+      "Pool allocation of %lu bytes is too big\n",
+      (unsigned long) size);
     return NULL;
   }
 
-  pthread_mutex_lock(&pools[i].mutex);
-  header = pools[i].first;
-  if (header != NULL)
-    pools[i].first = header->next;
-  pthread_mutex_unlock(&pools[i].mutex);
+  if ((cache = suscan_bufpool_cache_get()) != NULL) {
+    if (cache->count[i] == 0)
+      suscan_bufpool_cache_refill(cache, i);
+
+    if (cache->count[i] > 0)
+      header = cache->free[i][--cache->count[i]];
+  } else {
+    header = suscan_pool_take(pools + i);
+  }
 
-  if (header == NULL) {
+  if (header != NULL) {
+    suscan_pool_release_idle(pools + i, i);
+    __atomic_add_fetch(&pools[i].hits, 1, __ATOMIC_RELAXED);
+  } else {
     SU_TRYCATCH(
-        header = malloc(
-          sizeof(struct suscan_buffer_header) + (sizeof(SUCOMPLEX) << i)),
+        header = malloc(sizeof(struct suscan_buffer_header) + (1ul << i)),
         return NULL);
+    __atomic_add_fetch(&pools[i].misses, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&pools[i].allocated, 1, __ATOMIC_RELAXED);
   }
 
+  __atomic_add_fetch(
+    &pools[i].bytes_outstanding,
+    (uint64_t) 1 << i,
+    __ATOMIC_RELAXED);
+
   header->pool_index = i;
-  header->length = length;
+  header->size       = size;
+  header->refcnt     = 1;
 
   return header->data;
 }
 
+unsigned int
+suscan_bufpool_get_class_count(void)
+{
+  return NUM_POOLS - MIN_POOL;
+}
+
 SUBOOL
-suscan_init_pools(void)
+suscan_bufpool_get_stats(
+  unsigned int index,
+  struct suscan_bufpool_stats *stats)
+{
+  const struct suscan_pool *pool;
+
+  if (index >= suscan_bufpool_get_class_count())
+    return SU_FALSE;
+
+  index += MIN_POOL;
+  pool   = pools + index;
+
+  stats->class_size        = (size_t) 1 << index;
+  stats->hits              = __atomic_load_n(&pool->hits, __ATOMIC_RELAXED);
+  stats->misses            = __atomic_load_n(&pool->misses, __ATOMIC_RELAXED);
+  stats->bytes_outstanding =
+    __atomic_load_n(&pool->bytes_outstanding, __ATOMIC_RELAXED);
+  stats->bytes_idle        =
+    __atomic_load_n(&pool->bytes_idle, __ATOMIC_RELAXED);
+  stats->allocated         =
+    __atomic_load_n(&pool->allocated, __ATOMIC_RELAXED);
+
+  return SU_TRUE;
+}
+
+void
+suscan_bufpool_debug(void)
 {
+  struct suscan_bufpool_stats stats;
   unsigned int i;
 
-  for (i = 0; i < NUM_POOLS; ++i) {
-    SU_TRYCATCH(
-        pthread_mutex_init(&pools[i].mutex, NULL) != -1,
-        return SU_FALSE);
+  for (i = 0; i < suscan_bufpool_get_class_count(); ++i) {
+    (void) suscan_bufpool_get_stats(i, &stats);
+
+    if (stats.hits + stats.misses == 0)
+      continue;
+
+    SU_INFO(
+      "Class %8lu: %8lu hits, %6lu misses, %3u buffers, %lu bytes in use, "
+      "%lu bytes free\n",
+      (unsigned long) stats.class_size,
+      (unsigned long) stats.hits,
+      (unsigned long) stats.misses,
+      stats.allocated,
+      (unsigned long) stats.bytes_outstanding,
+      (unsigned long) stats.bytes_idle);
   }
+}
 
+SUBOOL
+suscan_init_pools(void)
+{
+  /* Pools are statically initialized and need no further setup */
   return SU_TRUE;
 }
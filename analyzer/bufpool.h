@@ -26,40 +26,133 @@ extern "C" {
 
 #include <sigutils/types.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
 
+/*
+ * Pool buffers are preceded by a small header that keeps track of the
+ * size class they belong to, the number of bytes requested by the
+ * caller and a reference counter. The placeholder keeps the buffer data
+ * aligned to the alignment of SUCOMPLEX.
+ */
 struct suscan_buffer_header {
   union {
     struct {
-      uint16_t pool_index;
-      uint16_t length;
+      uint32_t pool_index;
+      uint32_t size;
+      uint32_t refcnt;
     };
 
-    struct suscan_buffer_header *next;
-    SUCOMPLEX placeholder;
+    SUCOMPLEX placeholder[2];
   };
 
   SUCOMPLEX data[0];
 };
 
+/*
+ * Size class i holds buffers of 2^i bytes. Every size class keeps a fixed
+ * number of global free slots. Slots are taken and released with atomic
+ * exchanges, so no locking is needed and there is no ABA problem. On top
+ * of that, every thread keeps a small cache of free buffers per class, and
+ * only touches the global slots when it runs out of buffers (refill) or
+ * when it has too many (flush). Buffers that do not fit anywhere are
+ * freed, and so are buffers that would take the free bytes of their class
+ * (slots and thread caches together) above SUSCAN_POOL_MAX_IDLE_BYTES.
+ */
+#define SUSCAN_POOL_MIN_CLASS      8
+#define SUSCAN_POOL_NUM_CLASSES    25
+#define SUSCAN_POOL_SLOTS          64
+#define SUSCAN_POOL_THREAD_CACHE   8
+#define SUSCAN_POOL_MAX_IDLE_BYTES (16ul << 20)
 
 struct suscan_pool {
-  struct suscan_buffer_header *first;
+  struct suscan_buffer_header *slots[SUSCAN_POOL_SLOTS];
+
+  /* Statistics */
+  uint64_t     hits;              /* Allocations served from a free list */
+  uint64_t     misses;            /* Allocations served by malloc */
+  uint64_t     bytes_outstanding; /* Bytes currently held by users */
+  uint64_t     bytes_idle;        /* Bytes in free buffers */
+  unsigned int allocated;         /* Buffers alive, either free or in use */
+};
+
+struct suscan_bufpool_stats {
+  size_t       class_size;
+  uint64_t     hits;
+  uint64_t     misses;
+  uint64_t     bytes_outstanding;
+  uint64_t     bytes_idle;
   unsigned int allocated;
-  pthread_mutex_t mutex;
 };
 
-SUINLINE uint16_t
-suscan_buffer_get_length(const SUCOMPLEX *data)
+SUINLINE struct suscan_buffer_header *
+suscan_bufpool_get_header(const void *data)
 {
-  struct suscan_buffer_header *header;
-  header = (struct suscan_buffer_header *) (
+  return (struct suscan_buffer_header *) (
       (char *) data - sizeof(struct suscan_buffer_header));
+}
+
+/* Requested size, in bytes */
+SUINLINE size_t
+suscan_bufpool_get_size(const void *data)
+{
+  return suscan_bufpool_get_header(data)->size;
+}
+
+/* Allocated size, in bytes (always greater or equal than the size) */
+SUINLINE size_t
+suscan_bufpool_get_capacity(const void *data)
+{
+  return (size_t) 1 << suscan_bufpool_get_header(data)->pool_index;
+}
+
+void *suscan_bufpool_alloc(size_t size);
+
+/* Adds a new reference to the buffer */
+void suscan_bufpool_ref(void *data);
+
+/* Drops a reference. When the last one is gone, the buffer is recycled */
+void suscan_bufpool_return(void *data);
+
+unsigned int suscan_bufpool_get_class_count(void);
 
-  return header->length;
+SUBOOL suscan_bufpool_get_stats(
+  unsigned int index,
+  struct suscan_bufpool_stats *stats);
+
+void suscan_bufpool_debug(void);
+
+/* Sample buffer helpers */
+SUINLINE SUCOMPLEX *
+suscan_buffer_alloc(unsigned int length)
+{
+  return (SUCOMPLEX *) suscan_bufpool_alloc(length * sizeof(SUCOMPLEX));
+}
+
+SUINLINE SUSCOUNT
+suscan_buffer_get_length(const SUCOMPLEX *data)
+{
+  return suscan_bufpool_get_size(data) / sizeof(SUCOMPLEX);
+}
+
+SUINLINE SUSCOUNT
+suscan_buffer_get_capacity(const SUCOMPLEX *data)
+{
+  return suscan_bufpool_get_capacity(data) / sizeof(SUCOMPLEX);
+}
+
+SUINLINE void
+suscan_buffer_ref(SUCOMPLEX *data)
+{
+  suscan_bufpool_ref(data);
+}
+
+SUINLINE void
+suscan_buffer_return(SUCOMPLEX *data)
+{
+  suscan_bufpool_return(data);
 }
 
-void suscan_buffer_return(SUCOMPLEX *data);
-SUCOMPLEX *suscan_buffer_alloc(unsigned int length);
 SUBOOL suscan_init_pools(void);
 
 #ifdef __cplusplus
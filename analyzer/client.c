@@ -138,6 +138,44 @@ done:
   return ok;
 }
 
+SUBOOL
+suscan_analyzer_set_sweep_band_async(
+    suscan_analyzer_t *analyzer,
+    SUFREQ min_freq,
+    SUFREQ max_freq,
+    SUFLOAT revisit,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_sweep_band_msg *band = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      band = malloc(sizeof(struct suscan_analyzer_sweep_band_msg)),
+      goto done);
+
+  band->min_freq = min_freq;
+  band->max_freq = max_freq;
+  band->revisit  = revisit;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_BAND,
+      band)) {
+    SU_ERROR("Failed to send sweep band command\n");
+    goto done;
+  }
+
+  band = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (band != NULL)
+    free(band);
+
+  return ok;
+}
+
 /****************************** Inspector methods ****************************/
 SUBOOL
 suscan_analyzer_open_ex_async(
@@ -662,4 +700,44 @@ done:
   return ok;
 }
 
+SUBOOL
+suscan_analyzer_set_inspector_gate_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUFLOAT threshold,
+    enum suscan_inspector_gate_policy policy,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_inspector_msg *req = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      req = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_GATE,
+          req_id),
+      goto done);
+
+  req->handle = handle;
+  req->gate_threshold = threshold;
+  req->gate_policy = policy;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      req)) {
+    SU_ERROR("Failed to send set_gate command\n");
+    goto done;
+  }
+
+  req = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (req != NULL)
+    suscan_analyzer_inspector_msg_destroy(req);
+
+  return ok;
+}
+
 
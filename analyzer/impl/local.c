@@ -257,6 +257,8 @@ suscan_analyzer_thread(void *data)
   const struct suscan_analyzer_params *new_params;
   const struct suscan_analyzer_throttle_msg *throttle;
   const struct suscan_analyzer_seek_msg *seek;
+  struct suscan_msg *batch[SUSCAN_WORKER_BATCH_SIZE];
+  unsigned int i = 0, count = 0;
   void *private = NULL;
   uint32_t type;
   SUBOOL mutex_acquired = SU_FALSE;
@@ -310,10 +312,18 @@ suscan_analyzer_thread(void *data)
 
   /* Pop all messages from queue before reading from the source */
   for (;;) {
-    /* First read: blocks */
-    private = suscan_mq_read(&self->mq_in, &type);
+    /* Blocking read of all pending messages (up to the batch size) */
+    count = suscan_mq_read_batch(
+      &self->mq_in,
+      batch,
+      SUSCAN_WORKER_BATCH_SIZE,
+      NULL);
+
+    for (i = 0; i < count; ++i) {
+      type    = batch[i]->type;
+      private = batch[i]->privdata;
+      suscan_msg_destroy(batch[i]);
 
-    do {
       switch (type) {
         case SUSCAN_WORKER_MSG_TYPE_HALT:
           suscan_local_analyzer_ack_halt(self);
@@ -402,6 +412,11 @@ suscan_analyzer_thread(void *data)
 
             /* vvvvvvvvvvvvvvv Source parameters update start vvvvvvvvvvvvv */
 
+            /* The PSD worker may still be using the detector */
+            SU_TRYCATCH(
+                suscan_local_analyzer_wait_wide_pipeline(self),
+                goto done);
+
             /* Attempt to update detector parameters */
             new_det_params = self->detector->params; /* Not all parameters are allowed */
 
@@ -447,15 +462,36 @@ suscan_analyzer_thread(void *data)
               pthread_mutex_unlock(&self->loop_mutex) != -1,
               goto done);
           mutex_acquired = SU_FALSE;
+          break;
+
+        case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_BAND:
+          if (self->parent->params.mode
+            != SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM) {
+            SU_WARNING("Sweep bands only apply to wide spectrum analyzers\n");
+            break;
+          }
+
+          SU_TRYCATCH(
+              pthread_mutex_lock(&self->loop_mutex) != -1,
+              goto done);
+          mutex_acquired = SU_TRUE;
+
+          SU_TRYCATCH(
+              suscan_local_analyzer_set_sweep_band(self, private),
+              goto done);
+
+          SU_TRYCATCH(
+              pthread_mutex_unlock(&self->loop_mutex) != -1,
+              goto done);
+          mutex_acquired = SU_FALSE;
+          break;
       }
 
       if (private != NULL) {
         suscan_analyzer_dispose_message(type, private);
         private = NULL;
       }
-
-      /* Next reads: until message queue is empty */
-    } while (suscan_mq_poll(&self->mq_in, &type, &private));
+    }
   }
 
 done:
@@ -465,6 +501,12 @@ done:
   if (private != NULL)
     suscan_analyzer_dispose_message(type, private);
 
+  /* Release the rest of the batch */
+  while (++i < count) {
+    suscan_analyzer_dispose_message(batch[i]->type, batch[i]->privdata);
+    suscan_msg_destroy(batch[i]);
+  }
+
   if (suscan_source_is_capturing(self->source))
     suscan_source_stop_capture(self->source);
 
@@ -516,6 +558,9 @@ suscan_local_analyzer_source_init(
     suscan_throttle_init(
         &self->throttle,
         suscan_local_analyzer_get_samp_rate(self));
+
+    /* Free-running sources are read as fast as the pipeline allows */
+    self->free_run = self->parent->params.free_run;
   }
 
   return SU_TRUE;
@@ -539,6 +584,46 @@ suscan_analyzer_params_debug(const struct suscan_analyzer_params *params)
 
 SUPRIVATE void suscan_local_analyzer_dtor(void *ptr);
 
+/*
+ * Read blocks are sized after the sample rate, so that every block
+ * holds SUSCAN_ANALYZER_READ_LATENCY seconds of signal. This keeps the
+ * per-block overhead (locking, timing, worker re-queueing) constant in
+ * time rather than proportional to the sample rate. Blocks are kept
+ * under a few tuner windows, to bound the latency of the channels.
+ */
+SUPRIVATE SUSCOUNT
+suscan_local_analyzer_get_read_size(const suscan_local_analyzer_t *self)
+{
+  const struct suscan_analyzer_params *params = &self->parent->params;
+  SUSCOUNT size, max, window;
+
+  /* Pinned by the user */
+  if (params->read_size > 0)
+    return params->read_size;
+
+  if (self->effective_samp_rate <= SUSCAN_ANALYZER_SLOW_RATE)
+    return SUSCAN_ANALYZER_SLOW_READ_SIZE;
+
+  size   = self->effective_samp_rate * SUSCAN_ANALYZER_READ_LATENCY;
+  window = params->detector_params.window_size;
+  max    = SUSCAN_ANALYZER_MAX_READ_WINDOWS * window;
+
+  if (size > max)
+    size = max;
+
+  /* Whole tuner half-windows, so that all blocks cost the same */
+  if (window > 1 && size >= window)
+    size -= size % (window / 2);
+
+  if (size < SUSCAN_ANALYZER_FAST_READ_SIZE)
+    size = SUSCAN_ANALYZER_FAST_READ_SIZE;
+
+  if (size < self->source->mtu)
+    size = self->source->mtu;
+
+  return size;
+}
+
 SUPRIVATE SUBOOL
 suscan_local_analyzer_source_info_add_gain(
     void *private,
@@ -680,7 +765,7 @@ suscan_local_analyzer_ctor(suscan_analyzer_t *parent, va_list ap)
   new->parent = parent;
 
   /* Create input message queue */
-  if (!suscan_mq_init(&new->mq_in)) {
+  if (!suscan_mq_init_ex(&new->mq_in, SUSCAN_MQ_BACKEND_LOCKFREE)) {
     SU_ERROR("Cannot allocate input MQ\n");
     goto fail;
   }
@@ -721,6 +806,16 @@ suscan_local_analyzer_ctor(suscan_analyzer_t *parent, va_list ap)
     goto fail;
   }
 
+  /* Create PSD worker */
+  if ((new->psd_wk = suscan_worker_new_ex(
+    "psd-worker", 
+    &new->mq_in, 
+    new))
+      == NULL) {
+    SU_ERROR("Cannot create PSD worker thread\n");
+    goto fail;
+  }
+
   /* Initialize gain request mutex */
   SU_TRYCATCH(pthread_mutex_init(&new->hotconf_mutex, NULL) == 0, goto fail);
   new->gain_req_mutex_init = SU_TRUE;
@@ -762,27 +857,31 @@ suscan_local_analyzer_ctor(suscan_analyzer_t *parent, va_list ap)
   SU_TRYCATCH(pthread_mutex_init(&new->insp_mutex, NULL) == 0, goto fail);
   new->insp_init = SU_TRUE;
   
+  /* Decouple the device reader from DSP, if requested */
+  if (parent->params.mode == SUSCAN_ANALYZER_MODE_CHANNEL
+      && parent->params.capture_ring_depth > 0
+      && suscan_source_get_type(new->source) == SUSCAN_SOURCE_TYPE_SDR)
+    SU_TRYCATCH(
+        suscan_source_set_capture_ring(
+            new->source,
+            parent->params.capture_ring_depth),
+        goto fail);
+
   SU_TRYCATCH(suscan_source_start_capture(new->source), goto fail);
 
   new->effective_samp_rate = suscan_local_analyzer_get_samp_rate(new);
 
-  /* Allocate read buffer */
-  new->read_size =
-      new->effective_samp_rate <= SUSCAN_ANALYZER_SLOW_RATE
-      ? SUSCAN_ANALYZER_SLOW_READ_SIZE
-      : SUSCAN_ANALYZER_FAST_READ_SIZE;
-
-  if (new->read_size < new->source->mtu)
-    new->read_size = new->source->mtu;
-
-  if ((new->read_buf = malloc(
-      new->read_size * sizeof(SUCOMPLEX))) == NULL) {
-    SU_ERROR("Failed to allocate read buffer\n");
-    goto fail;
-  }
+  new->read_size = suscan_local_analyzer_get_read_size(new);
 
   /* In wide spectrum mode, additional tests are required */
   if (parent->params.mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM) {
+    /* Channel mode reads into the blocks of the PSD pool instead */
+    if ((new->read_buf = malloc(
+        new->read_size * sizeof(SUCOMPLEX))) == NULL) {
+      SU_ERROR("Failed to allocate read buffer\n");
+      goto fail;
+    }
+
     det_params = parent->params.detector_params;
     suscan_local_analyzer_init_detector_params(new, &det_params);
     SU_TRYCATCH(
@@ -813,6 +912,8 @@ suscan_local_analyzer_ctor(suscan_analyzer_t *parent, va_list ap)
             SUSCAN_ANALYZER_MIN_POST_HOP_FFTS * det_params.window_size;
     new->current_sweep_params.max_freq = parent->params.max_freq;
     new->current_sweep_params.min_freq = parent->params.min_freq;
+
+    SU_TRYCATCH(suscan_local_analyzer_init_wide_pipeline(new), goto fail);
   } else {
     SU_TRYCATCH(
         suscan_local_analyzer_init_channel_worker(new),
@@ -878,6 +979,22 @@ suscan_local_analyzer_dtor(void *ptr)
       return;
     }
 
+  if (self->psd_wk != NULL)
+    if (!suscan_analyzer_halt_worker(self->psd_wk)) {
+      SU_ERROR("PSD worker destruction failed, memory leak ahead\n");
+      return;
+    }
+
+  suscan_local_analyzer_finalize_wide_pipeline(self);
+
+  if (self->block_pool != NULL) {
+    for (i = 0; i < self->block_count; ++i)
+      if (self->block_pool[i].data != NULL)
+        free(self->block_pool[i].data);
+
+    free(self->block_pool);
+  }
+
   /* Destroy global inspector table */
   suscan_local_analyzer_destroy_global_handles_unsafe(self);
 
@@ -1012,6 +1129,8 @@ suscan_local_analyzer_set_iq_reverse(void *ptr, SUBOOL value)
 
   if (self->iq_rev != value) {
     self->iq_rev = value;
+    /* The source conjugates samples while converting them */
+    (void) suscan_source_set_iq_reverse(self->source, value);
     self->source_info.iq_reverse = self->iq_rev;
     return suscan_analyzer_send_source_info(self->parent, &self->source_info);
   }
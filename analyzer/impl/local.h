@@ -49,6 +49,41 @@ struct suscan_analyzer_baseband_filter {
   void *privdata;
 };
 
+/*
+ * In wide spectrum mode, the source worker collects one FFT window of
+ * samples per hop and hands it to the PSD worker. The next retune is then
+ * issued right away, so that the device settles while the PSD of the
+ * previous window is being computed.
+ */
+struct suscan_local_analyzer_wide_window {
+  SUCOMPLEX     *data;
+  SUSCOUNT       alloc;
+  SUSCOUNT       size;      /* Samples collected so far */
+  SUFREQ         freq;      /* Frequency at which they were captured */
+  struct timeval timestamp;
+};
+
+/*
+ * Sample blocks read in channel mode. Both the source worker and the PSD
+ * worker hold references to them, and they return to the pool once both
+ * are done with them. The source state is saved when the block is read,
+ * since the PSD worker processes it later.
+ */
+struct suscan_local_analyzer_block {
+  SUCOMPLEX     *data;
+  SUSCOUNT       size;
+  unsigned int   refcnt;
+  struct timeval timestamp; /* Source time after the block was read */
+  SUBOOL         looped;
+};
+
+/* Revisit priorities of the scheduled sweep strategy */
+struct suscan_local_analyzer_sweep_band {
+  SUFREQ  min_freq;
+  SUFREQ  max_freq;
+  SUFLOAT revisit; /* In seconds */
+};
+
 struct suscan_local_analyzer {
   suscan_analyzer_t *parent;
   struct suscan_mq mq_in;   /* Input queue */
@@ -68,6 +103,14 @@ struct suscan_local_analyzer {
   uint64_t last_measure;
   SUBOOL   iq_rev;
 
+  /* Free-running mode (file sources only) and its throughput statistics */
+  SUBOOL   free_run;
+  uint64_t free_run_start;
+  uint64_t free_run_samples;
+  uint64_t free_run_read_ns;
+  uint64_t free_run_baseband_ns;
+  uint64_t free_run_inspector_ns;
+
   /* Periodic updates */
   struct sigutils_smoothpsd_params sp_params;
   SUFLOAT  interval_channels;
@@ -126,14 +169,28 @@ struct suscan_local_analyzer {
   uint64_t process_end;
   uint64_t last_psd;
   uint64_t last_channels;
+  uint64_t last_samples_lost;
+
+  /* Capture losses already reported */
+  uint64_t reported_overflows;
+  uint64_t reported_lost;
+  uint64_t reported_psd_dropped;
 
   /* Source worker objects */
   su_channel_detector_t *detector; /* Channel detector */
   su_smoothpsd_t  *smooth_psd;
   suscan_worker_t *source_wk; /* Used by one source only */
   suscan_worker_t *slow_wk; /* Worker for slow operations */
-  SUCOMPLEX *read_buf;
+  suscan_worker_t *psd_wk; /* Computes the main spectrum */
+  SUCOMPLEX *read_buf; /* Wide spectrum mode only */
   SUSCOUNT   read_size;
+
+  /* Channel mode: blocks are not queued if the PSD worker falls behind */
+  struct suscan_local_analyzer_block *block_pool;
+  unsigned int block_count;
+  unsigned int psd_in_flight;
+  uint64_t     psd_dropped; /* Blocks not fed to the PSD */
+  const struct suscan_local_analyzer_block *psd_block; /* PSD worker only */
   PTR_LIST(struct suscan_analyzer_baseband_filter, bbfilt);
 
   /* Spectral tuner */
@@ -147,7 +204,35 @@ struct suscan_local_analyzer {
   struct suscan_analyzer_sweep_params pending_sweep_params;
   SUFREQ   curr_freq;
   SUSCOUNT part_ndx;
-  SUSCOUNT fft_samples; /* Number of FFT frames */
+
+  /* Overlapped sweep pipeline */
+  struct suscan_local_analyzer_wide_window wide_window[2];
+  unsigned int     wide_fill;         /* Window being filled */
+  SUBOOL           wide_busy;         /* The other one is being processed */
+  pthread_mutex_t  wide_mutex;
+  pthread_cond_t   wide_cond;
+  SUBOOL           wide_sync_init;
+  uint64_t         wide_settle_until; /* Device sample where the hop is usable */
+  uint64_t         wide_last_report;
+  SUFREQ           wide_swept;        /* Since the last report */
+  SUFLOAT          sweep_rate;        /* In Hz/s */
+
+  /*
+   * Sweep scheduler. The hop range is split in partitions of fs / 2, and
+   * the time of the last visit to each of them is kept regardless of the
+   * strategy (for the coverage statistics). The scheduled strategy always
+   * hops to the partition that is the most late with respect to its
+   * target revisit time.
+   */
+  PTR_LIST(struct suscan_local_analyzer_sweep_band, sweep_band);
+  uint64_t        *sched_last_visit;  /* In ns. 0: never visited */
+  SUFLOAT         *sched_revisit;     /* Target revisit time, in seconds */
+  unsigned int     sched_count;
+  SUFREQ           sched_min;
+  SUFREQ           sched_max;
+  SUFREQ           sched_step;
+  uint64_t         sched_epoch;       /* When the table was built */
+  SUBOOL           sched_dirty;       /* Bands changed */
 
   suscan_inspector_factory_t         *insp_factory;
   suscan_inspector_request_manager_t  insp_reqmgr;
@@ -221,6 +306,23 @@ suscan_local_analyzer_destroy_global_handles_unsafe(
 /* Internal */
 void suscan_local_analyzer_destroy_slow_worker_data(suscan_local_analyzer_t *);
 
+/* Internal */
+SUBOOL suscan_local_analyzer_init_wide_pipeline(suscan_local_analyzer_t *self);
+
+/* Internal */
+void suscan_local_analyzer_finalize_wide_pipeline(
+  suscan_local_analyzer_t *self);
+
+/* Internal: waits for the PSD worker to release the detector */
+SUBOOL suscan_local_analyzer_wait_wide_pipeline(suscan_local_analyzer_t *self);
+
+struct suscan_analyzer_sweep_band_msg;
+
+/* Internal: must be called with the loop mutex held */
+SUBOOL suscan_local_analyzer_set_sweep_band(
+  suscan_local_analyzer_t *self,
+  const struct suscan_analyzer_sweep_band_msg *msg);
+
 /* Internal */
 SUBOOL suscan_local_analyzer_set_inspector_freq_slow(
     suscan_local_analyzer_t *self,
@@ -35,6 +35,8 @@
 #define SUSCLI_MULTICAST_ANNOUNCE_DELAY_MS 1000
 #define SUSCLI_MULTICAST_ANNOUNCE_START_MS 2000
 #define SUSCLI_MULTICAST_FRAGMENT_MTU      508 /* 576 - IP hdr - UDP hdr */
+#define SUSCLI_MULTICAST_MAX_FRAGMENT_MTU  65507 /* Largest UDP/IPv4 payload */
+#define SUSCLI_MULTICAST_TX_BATCH_SIZE     64
 #define SUSCLI_MULTICAST_FRAG_MESSAGE      1
 
 #define SUSCLI_MULTICAST_FRAG_SIZE(payload) \
@@ -63,6 +65,7 @@ struct suscli_multicast_manager {
   int cancel_pipefd[2];
   uint8_t id;
   SUBOOL cancelled;
+  unsigned int mtu; /* Datagram size, including fragment header */
 
   struct sockaddr_in mc_addr;
 
@@ -90,7 +93,11 @@ struct suscli_multicast_manager {
 
 typedef struct suscli_multicast_manager suscli_multicast_manager_t;
 
-SU_INSTANCER(suscli_multicast_manager, const char *addr, uint16_t port);
+SU_INSTANCER(
+  suscli_multicast_manager,
+  const char *addr,
+  uint16_t port,
+  unsigned int mtu);
 SU_COLLECTOR(suscli_multicast_manager);
 
 SU_METHOD(
@@ -124,7 +124,9 @@ suscan_remote_partial_pdu_state_read(
     if (self->header.size == 0) {
       if (self->header.magic == SUSCAN_REMOTE_COMPRESSED_PDU_HEADER_MAGIC)
         SU_TRYCATCH(
-          suscan_remote_inflate_pdu(&self->incoming_pdu), 
+          suscan_remote_inflater_inflate(
+            &self->inflater,
+            &self->incoming_pdu), 
           goto done);
 
       grow_buf_seek(&self->incoming_pdu, 0, SEEK_SET);
@@ -165,6 +167,7 @@ suscan_remote_partial_pdu_state_finalize(
   struct suscan_remote_partial_pdu_state *self)
 {
   grow_buf_finalize(&self->incoming_pdu);
+  suscan_remote_inflater_finalize(&self->inflater);
 }
 
 SUSCAN_SERIALIZER_PROTO(suscan_analyzer_multicast_info) {
@@ -543,7 +546,9 @@ SUSCAN_DESERIALIZER_PROTO(suscan_analyzer_remote_call)
 
     case SUSCAN_ANALYZER_REMOTE_SET_SWEEP_STRATEGY:
       SUSCAN_UNPACK(uint32, self->sweep_strategy);
-      SU_TRYCATCH(self->sweep_strategy < 2, goto fail);
+      SU_TRYCATCH(
+        self->sweep_strategy < SUSCAN_ANALYZER_SWEEP_STRATEGY_COUNT,
+        goto fail);
       break;
 
     case SUSCAN_ANALYZER_REMOTE_SET_SPECTRUM_PARTITIONING:
@@ -759,116 +764,106 @@ done:
   return got;
 }
 
+/* Maximum compression ratio achievable by deflate */
+#define SUSCAN_REMOTE_MAX_DEFLATE_RATIO 1032
+
+void
+suscan_remote_deflater_init(
+  struct suscan_remote_deflater *self,
+  int level,
+  int strategy)
+{
+  memset(self, 0, sizeof(struct suscan_remote_deflater));
+
+  self->level    = level;
+  self->strategy = strategy;
+}
+
 SUBOOL
-suscan_remote_deflate_pdu(grow_buf_t *buffer, grow_buf_t *dest)
+suscan_remote_deflater_deflate(
+  struct suscan_remote_deflater *self,
+  const grow_buf_t *buffer,
+  grow_buf_t *dest)
 {
-  z_stream stream;
-  grow_buf_t tmpbuf      = grow_buf_INITIALIZER;
-  grow_buf_t swapbuf;
   uint8_t *buffer_bytes  = grow_buf_get_buffer(buffer);
   size_t   buffer_size   = grow_buf_get_size(buffer);
   uint8_t *output        = NULL;
-  uint32_t avail_size;
-  SUBOOL   deflate_init  = SU_TRUE;
-  int      last_err      = Z_OK;
-  int      flush         = Z_NO_FLUSH;
-  SUBOOL   ok = SU_FALSE;
+  uLong    bound;
 
-  if (dest == NULL)
-    dest = &tmpbuf;
+  grow_buf_shrink(dest);
 
-  SU_TRYCATCH(grow_buf_get_size(dest) == 0, goto done);
-  SU_TRYCATCH(output = grow_buf_alloc(dest, sizeof(uint32_t) + 5), goto done);
+  if (!self->stream_init) {
+    self->stream.zalloc = Z_NULL;
+    self->stream.zfree  = Z_NULL;
+    self->stream.opaque = Z_NULL;
 
-  /* Step 1: allocate and compress */
-  stream.zalloc   = Z_NULL;
-  stream.zfree    = Z_NULL;
-  stream.opaque   = Z_NULL;
+    SU_TRYCATCH(
+      deflateInit2(
+        &self->stream,
+        self->level,
+        Z_DEFLATED,
+        MAX_WBITS,
+        8, /* Default memLevel, as in deflateInit */
+        self->strategy) == Z_OK,
+      return SU_FALSE);
 
-  stream.next_in   = buffer_bytes;
-  stream.avail_in  = buffer_size;
+    self->stream_init = SU_TRUE;
+  } else {
+    SU_TRYCATCH(deflateReset(&self->stream) == Z_OK, return SU_FALSE);
+  }
 
-  stream.next_out  = output + sizeof(uint32_t);
-  stream.avail_out = grow_buf_get_size(dest) - sizeof(uint32_t);
+  /* Allocate the worst case once, so that deflate runs in a single call */
+  bound = deflateBound(&self->stream, buffer_size);
 
   SU_TRYCATCH(
-    deflateInit(&stream, 9) == Z_OK,
-    goto done);
-
-  deflate_init     = SU_TRUE;
-  /* Begin compression */
-  while ((last_err = deflate(&stream, flush)) == Z_OK) {
-    /* Buffer was not completely consumed, reallocate */
-
-    if (stream.avail_out == 0) {
-      avail_size = grow_buf_get_size(dest);
+    output = grow_buf_alloc(dest, sizeof(uint32_t) + bound),
+    return SU_FALSE);
 
-      if (avail_size > 4 * buffer_size) {
-        SU_ERROR("Compressed buffer grew beyond a reasonable size.\n");
-        goto done;
-      }
+  self->stream.next_in   = buffer_bytes;
+  self->stream.avail_in  = buffer_size;
+  self->stream.next_out  = output + sizeof(uint32_t);
+  self->stream.avail_out = bound;
 
-      SU_TRYCATCH(
-          output = grow_buf_alloc(dest, avail_size), 
-          goto done);
-
-      /* Update stream properties */
-      stream.next_out  = output;
-      stream.avail_out = avail_size;
-    }
-
-    if (stream.total_in == buffer_size)
-      flush = Z_FINISH;
-  }
-
-  SU_TRYCATCH(last_err == Z_STREAM_END, goto done);
+  SU_TRYCATCH(
+    deflate(&self->stream, Z_FINISH) == Z_STREAM_END,
+    return SU_FALSE);
 
   /* TODO: Expose API!! */
-  dest->size = stream.total_out + sizeof(uint32_t);
+  dest->size = self->stream.total_out + sizeof(uint32_t);
 
-  /* Step 2: update PDU size */
-  output = grow_buf_get_buffer(dest);
+  /* Update PDU size */
   *(uint32_t *) output = htonl(buffer_size);
 
-  if (dest == &tmpbuf) {
-    swapbuf = tmpbuf;
-    tmpbuf  = *buffer;
-    *buffer = swapbuf;
-  }
-
-  ok = SU_TRUE;
-
-done:
-  if (deflate_init)
-    deflateEnd(&stream);
+  return SU_TRUE;
+}
 
-  grow_buf_finalize(&tmpbuf);
+void
+suscan_remote_deflater_finalize(struct suscan_remote_deflater *self)
+{
+  if (self->stream_init)
+    deflateEnd(&self->stream);
 
-  return ok;
+  self->stream_init = SU_FALSE;
 }
 
 SUBOOL
-suscan_remote_inflate_pdu(grow_buf_t *buffer)
+suscan_remote_inflater_inflate(
+  struct suscan_remote_inflater *self,
+  grow_buf_t *buffer)
 {
   uint32_t cmpsize;
   uint8_t *cmpbytes;
   uint32_t size;
-  z_stream stream;
   uint8_t *output;
-  uint32_t out_alloc;
   grow_buf_t swapbuf;
-  grow_buf_t tmpbuf = grow_buf_INITIALIZER;
   int last_err;
-  int flush = Z_NO_FLUSH;
-  SUBOOL inflate_init = SU_FALSE;
-  SUBOOL ok = SU_FALSE;
 
   cmpsize  = grow_buf_get_size(buffer);
   cmpbytes = grow_buf_get_buffer(buffer);
 
   if (cmpsize <= sizeof(uint32_t)) {
     SU_ERROR("Compressed frame too short\n");
-    goto done;
+    return SU_FALSE;
   }
 
   size = ntohl(*(uint32_t *) cmpbytes);
@@ -876,87 +871,148 @@ suscan_remote_inflate_pdu(grow_buf_t *buffer)
   cmpsize  -= sizeof(uint32_t);
   cmpbytes += sizeof(uint32_t);
 
-  /* Initialize buffers */
-  stream.zalloc = Z_NULL;
-  stream.zfree  = Z_NULL;
-  stream.opaque = Z_NULL;
-
-  out_alloc = cmpsize;
-  
-  SU_TRYCATCH(
-    output = grow_buf_alloc(&tmpbuf, out_alloc), 
-    goto done);
-
-  stream.next_in   = cmpbytes;
-  stream.avail_in  = cmpsize;
+  /* The output buffer is allocated at once, make sure size makes sense */
+  if ((uint64_t) size > (uint64_t) cmpsize * SUSCAN_REMOTE_MAX_DEFLATE_RATIO) {
+    SU_ERROR(
+      "Implausible inflated size (%u bytes from %u compressed bytes)\n",
+      size,
+      cmpsize);
+    return SU_FALSE;
+  }
 
-  stream.next_out  = output;
-  stream.avail_out = out_alloc;
+  if (!self->stream_init) {
+    self->stream.zalloc = Z_NULL;
+    self->stream.zfree  = Z_NULL;
+    self->stream.opaque = Z_NULL;
+    self->stream.next_in  = Z_NULL;
+    self->stream.avail_in = 0;
 
-  /* Initialize inflate */
-  SU_TRYCATCH(inflateInit(&stream) == Z_OK, goto done);
-  inflate_init     = SU_TRUE;
+    SU_TRYCATCH(inflateInit(&self->stream) == Z_OK, return SU_FALSE);
+    self->stream_init = SU_TRUE;
+  } else {
+    SU_TRYCATCH(inflateReset(&self->stream) == Z_OK, return SU_FALSE);
+  }
 
-  /* Begin decompression */
-  while ((last_err = inflate(&stream, flush)) == Z_OK) {
-    if (stream.avail_out == 0) {
-      /* Buffer was not completely consumed, reallocate */
-      out_alloc = grow_buf_get_size(&tmpbuf);
+  grow_buf_shrink(&self->spare);
 
-      if (grow_buf_get_size(&tmpbuf) + out_alloc > size)
-        out_alloc = size - grow_buf_get_size(&tmpbuf);
+  /* Allocate one extra byte, as size may be zero */
+  SU_TRYCATCH(output = grow_buf_alloc(&self->spare, size + 1), return SU_FALSE);
 
-      if (out_alloc > 0) {
-        SU_TRYCATCH(
-        output = grow_buf_alloc(&tmpbuf, out_alloc), 
-        goto done);
-      } else {
-        output = Z_NULL;
-      }
-      
-      stream.next_out  = output;
-      stream.avail_out = out_alloc;
-    }
+  self->stream.next_in   = cmpbytes;
+  self->stream.avail_in  = cmpsize;
+  self->stream.next_out  = output;
+  self->stream.avail_out = size + 1;
 
-    if (stream.total_in == cmpsize)
-      flush = Z_FINISH;
-  }
+  last_err = inflate(&self->stream, Z_FINISH);
 
   if (last_err != Z_STREAM_END) {
     SU_ERROR(
-      "Inflate error %d (%d/%d bytes decompressed, corrupted data?)\n", 
+      "Inflate error %d (%lu/%u bytes decompressed, corrupted data?)\n", 
       last_err,
-      stream.total_out,
+      self->stream.total_out,
       size);
-    SU_ERROR("%02x %02x %02x %02x\n", cmpbytes[0], cmpbytes[1], cmpbytes[2], cmpbytes[3]);
-    SU_ERROR("Consumed: %d/%d\n", cmpsize - stream.avail_in, cmpsize);
-    goto done;
+    SU_ERROR(
+      "Consumed: %u/%u\n",
+      cmpsize - self->stream.avail_in,
+      cmpsize);
+    return SU_FALSE;
   }
 
-  if (size != stream.total_out) {
+  if (size != self->stream.total_out) {
     SU_ERROR(
-      "Inflated packet size mismatch (%d != %d)\n", 
-      stream.total_out, 
+      "Inflated packet size mismatch (%lu != %u)\n", 
+      self->stream.total_out, 
       size);
-    goto done;
+    return SU_FALSE;
   }
 
-  /* Swap these */
-  swapbuf = *buffer;
-  *buffer = tmpbuf;
-  tmpbuf  = swapbuf;
+  /* TODO: Expose API!! */
+  self->spare.size = size;
+
+  /* Swap these. The compressed buffer is recycled for the next PDU. */
+  swapbuf      = *buffer;
+  *buffer      = self->spare;
+  self->spare  = swapbuf;
+
+  return SU_TRUE;
+}
+
+void
+suscan_remote_inflater_finalize(struct suscan_remote_inflater *self)
+{
+  if (self->stream_init)
+    inflateEnd(&self->stream);
+
+  self->stream_init = SU_FALSE;
+
+  grow_buf_finalize(&self->spare);
+  memset(&self->spare, 0, sizeof(grow_buf_t));
+}
+
+SUBOOL
+suscan_remote_deflate_pdu(grow_buf_t *buffer, grow_buf_t *dest)
+{
+  return suscan_remote_deflate_pdu_ex(
+    buffer,
+    dest,
+    SUSCAN_REMOTE_DEFAULT_COMPRESS_LEVEL,
+    SUSCAN_REMOTE_DEFAULT_COMPRESS_STRATEGY);
+}
+
+SUBOOL
+suscan_remote_deflate_pdu_ex(
+  grow_buf_t *buffer,
+  grow_buf_t *dest,
+  int level,
+  int strategy)
+{
+  struct suscan_remote_deflater deflater;
+  grow_buf_t tmpbuf = grow_buf_INITIALIZER;
+  grow_buf_t swapbuf;
+  SUBOOL ok = SU_FALSE;
+
+  suscan_remote_deflater_init(&deflater, level, strategy);
+
+  if (dest == NULL)
+    dest = &tmpbuf;
+
+  SU_TRYCATCH(grow_buf_get_size(dest) == 0, goto done);
+
+  SU_TRYCATCH(
+    suscan_remote_deflater_deflate(&deflater, buffer, dest),
+    goto done);
+
+  if (dest == &tmpbuf) {
+    swapbuf = tmpbuf;
+    tmpbuf  = *buffer;
+    *buffer = swapbuf;
+  }
 
   ok = SU_TRUE;
 
 done:
-  if (inflate_init)
-    inflateEnd(&stream);
+  suscan_remote_deflater_finalize(&deflater);
 
   grow_buf_finalize(&tmpbuf);
 
   return ok;
 }
 
+SUBOOL
+suscan_remote_inflate_pdu(grow_buf_t *buffer)
+{
+  struct suscan_remote_inflater inflater;
+  SUBOOL ok;
+
+  memset(&inflater, 0, sizeof(struct suscan_remote_inflater));
+
+  ok = suscan_remote_inflater_inflate(&inflater, buffer);
+
+  suscan_remote_inflater_finalize(&inflater);
+
+  return ok;
+}
+
 SUBOOL
 suscan_remote_read_pdu(
     int sfd,
@@ -1143,7 +1199,6 @@ suscan_remote_analyzer_receive_call(
 {
   struct suscan_analyzer_remote_call *call = NULL, *qcall = NULL;
   uint32_t type;
-  uint8_t *read_buf = self->peer.pdu_state.read_buffer;
   struct sockaddr_in addr;
   grow_buf_t buf = grow_buf_INITIALIZER;
   int n = 2, active;
@@ -1217,8 +1272,8 @@ suscan_remote_analyzer_receive_call(
     if (n > 2 && (fds[2].revents & POLLIN)) {
       ret = recvfrom(
         self->peer.mc_fd,
-        (void *) read_buf,
-        SUSCAN_REMOTE_READ_BUFFER,
+        (void *) self->peer.mc_read_buffer,
+        SUSCLI_MULTICAST_MAX_FRAGMENT_MTU,
         0,
         (struct sockaddr *) &addr,
         &len);
@@ -1227,7 +1282,7 @@ suscan_remote_analyzer_receive_call(
         SU_TRY(
           suscli_multicast_processor_process_datagram(
             self->peer.mc_processor,
-            read_buf,
+            self->peer.mc_read_buffer,
             ret));
 
       /* Loop now */
@@ -1476,6 +1531,9 @@ suscan_remote_analyzer_auth_peer(suscan_remote_analyzer_t *self)
   if (self->peer.mc_processor != NULL)
     call->client_auth.flags |= SUSCAN_REMOTE_FLAGS_MULTICAST;
 
+  call->client_auth.flags |=
+    SUSCAN_REMOTE_FLAGS_SWEEP | SUSCAN_REMOTE_FLAGS_SAMPLES_LOST;
+
   write_ok = suscan_remote_analyzer_deliver_call(
       self,
       self->peer.control_fd,
@@ -1642,6 +1700,13 @@ suscan_remote_analyzer_open_multicast(
     goto done;
   }
 
+  /* Servers may send datagrams up to the largest UDP payload */
+  if (self->peer.mc_read_buffer == NULL)
+    SU_ALLOCATE_MANY(
+      self->peer.mc_read_buffer,
+      SUSCLI_MULTICAST_MAX_FRAGMENT_MTU,
+      uint8_t);
+
   /* All set to initialize a multicast processor */
   SU_MAKE(
     self->peer.mc_processor,
@@ -2146,6 +2211,9 @@ suscan_remote_analyzer_dtor(void *ptr)
   if (self->peer.mc_processor != NULL)
     suscli_multicast_processor_destroy(self->peer.mc_processor);
 
+  if (self->peer.mc_read_buffer != NULL)
+    free(self->peer.mc_read_buffer);
+
   if (self->call_mutex_initialized)
     pthread_mutex_destroy(&self->call_mutex);
 
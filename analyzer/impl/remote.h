@@ -23,6 +23,7 @@
 #include <analyzer/analyzer.h>
 #include <util/compat-in.h>
 #include <util/sha256.h>
+#include <zlib.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,6 +36,8 @@ extern "C" {
 #define SUSCAN_REMOTE_ANALYZER_AUTH_TIMEOUT_MS          30000
 #define SUSCAN_REMOTE_ANALYZER_PDU_BODY_TIMEOUT_MS      15000
 #define SUSCAN_REMOTE_READ_BUFFER                        1400
+#define SUSCAN_REMOTE_DEFAULT_COMPRESS_LEVEL                9
+#define SUSCAN_REMOTE_DEFAULT_COMPRESS_STRATEGY             0 /* Z_DEFAULT_STRATEGY */
 
 #define SUSCAN_REMOTE_HALT                                  2
 
@@ -49,6 +52,14 @@ extern "C" {
 
 #define SUSCAN_REMOTE_FLAGS_MULTICAST                       1
 
+/*
+ * Client capabilities, announced in the flags of the client auth. Servers
+ * only send these messages to clients that announce them, so that older
+ * 0.8 clients (which drop the connection on unknown messages) keep working.
+ */
+#define SUSCAN_REMOTE_FLAGS_SWEEP                           2 /* Band, stats */
+#define SUSCAN_REMOTE_FLAGS_SAMPLES_LOST                    4
+
 struct suscan_analyzer_remote_pdu_header {
   uint32_t magic;
   uint32_t size;
@@ -226,7 +237,49 @@ SUSCAN_PARTIAL_DESERIALIZER_PROTO(suscan_analyzer_remote_call);
   SUSCAN_ANALYZER_REMOTE_NONE /* type */                \
 }
 
+/*
+ * Reusable PDU compression contexts. The zlib stream is created on first
+ * use and reset (instead of re-created) for every subsequent PDU. The
+ * inflater also recycles the buffer of the last compressed PDU as the
+ * output buffer of the next one. A zeroed inflater is ready to use.
+ */
+struct suscan_remote_deflater {
+  z_stream stream;
+  SUBOOL   stream_init;
+  int      level;
+  int      strategy;
+};
+
+struct suscan_remote_inflater {
+  z_stream   stream;
+  SUBOOL     stream_init;
+  grow_buf_t spare;
+};
+
+void suscan_remote_deflater_init(
+  struct suscan_remote_deflater *self,
+  int level,
+  int strategy);
+
+SUBOOL suscan_remote_deflater_deflate(
+  struct suscan_remote_deflater *self,
+  const grow_buf_t *buffer,
+  grow_buf_t *dest);
+
+void suscan_remote_deflater_finalize(struct suscan_remote_deflater *self);
+
+SUBOOL suscan_remote_inflater_inflate(
+  struct suscan_remote_inflater *self,
+  grow_buf_t *buffer);
+
+void suscan_remote_inflater_finalize(struct suscan_remote_inflater *self);
+
 SUBOOL suscan_remote_deflate_pdu(grow_buf_t *buffer, grow_buf_t *dest);
+SUBOOL suscan_remote_deflate_pdu_ex(
+  grow_buf_t *buffer,
+  grow_buf_t *dest,
+  int level,
+  int strategy);
 SUBOOL suscan_remote_inflate_pdu(grow_buf_t *buffer);
 
 void suscan_analyzer_remote_call_init(
@@ -274,6 +327,7 @@ struct suscli_multicast_processor;
 
 struct suscan_remote_partial_pdu_state {
   grow_buf_t incoming_pdu;
+  struct suscan_remote_inflater inflater;
 
   uint8_t read_buffer[SUSCAN_REMOTE_READ_BUFFER];
 
@@ -321,6 +375,7 @@ struct suscan_remote_analyzer_peer_info {
   grow_buf_t write_buffer;
 
   struct suscli_multicast_processor *mc_processor;
+  uint8_t *mc_read_buffer; /* Fits the largest fragment */
 };
 
 struct suscan_remote_analyzer {
@@ -508,6 +508,31 @@ done:
   return SU_TRUE;
 }
 
+DEF_MSGCB(SET_GATE)
+{
+  suscan_inspector_t *insp = NULL;
+  
+  if ((insp = suscan_local_analyzer_insp_from_msg(self, msg)) == NULL)
+    goto done;
+  
+  if (!suscan_inspector_set_gate(
+      insp,
+      msg->gate_threshold,
+      msg->gate_policy)) {
+    msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_ARGUMENT;
+    goto done;
+  }
+
+  /* Reply with the current state of the gate */
+  suscan_inspector_get_gate_report(insp, msg);
+
+done:
+  if (insp != NULL)
+    suscan_local_analyzer_return_inspector(self, insp);
+  
+  return SU_TRUE;
+}
+
 DEF_MSGCB(SET_FREQ)
 {
   struct suscan_inspector_overridable_request *req = NULL;
@@ -718,6 +743,7 @@ suscan_insp_server_init(void)
   INIT_MSGCB(SET_TLE);
   INIT_MSGCB(RESET_EQUALIZER);
   INIT_MSGCB(SET_WATERMARK);
+  INIT_MSGCB(SET_GATE);
   INIT_MSGCB(SET_FREQ);
   INIT_MSGCB(SET_BANDWIDTH);
   INIT_MSGCB(CLOSE);
@@ -145,7 +145,10 @@ suscan_inspector_factory_new(const char *name, ...)
   new->inspector_list_init = SU_TRUE;
 
   SU_TRYCATCH(
-    new->sched = suscan_inspsched_new(new->mq_ctl),
+    new->sched = suscan_inspsched_new_ex(
+      new->mq_ctl,
+      new->sched_policy,
+      new->sched_pipeline_depth),
     goto done);
 
   ok = SU_TRUE;
@@ -213,7 +216,13 @@ suscan_inspector_factory_feed(
   /* Step 1: update frequency corrections for this inspector */
   suscan_inspector_factory_update_frequency_corrections(self, insp);
 
-  /* Step 2: allocate task info and queue task */
+  /* Step 2: skip the window if the inspector is suspended */
+  if (!suscan_inspector_gate_feed(insp, data, size)) {
+    ok = SU_TRUE;
+    goto done;
+  }
+
+  /* Step 3: allocate task info and queue task */
   SU_TRYCATCH(
     info = suscan_inspsched_acquire_task_info(self->sched, insp), 
     goto done);
@@ -86,6 +86,8 @@ struct suscan_inspector_factory {
   SUBOOL              inspector_list_init;
   
   suscan_inspsched_t *sched;   /* Inspector scheduler */
+  enum suscan_inspsched_policy sched_policy; /* Set by the constructor */
+  unsigned int sched_pipeline_depth;         /* Set by the constructor */
 };
 
 typedef struct suscan_inspector_factory suscan_inspector_factory_t;
@@ -106,6 +108,29 @@ suscan_inspector_factory_set_mq_ctl(
   self->mq_ctl = mq;
 }
 
+SUINLINE void
+suscan_inspector_factory_set_sched_policy(
+  suscan_inspector_factory_t *self,
+  enum suscan_inspsched_policy policy)
+{
+  self->sched_policy = policy;
+}
+
+SUINLINE void
+suscan_inspector_factory_set_sched_pipeline_depth(
+  suscan_inspector_factory_t *self,
+  unsigned int depth)
+{
+  self->sched_pipeline_depth = depth;
+}
+
+SUINLINE uint64_t
+suscan_inspector_factory_get_backpressure_count(
+  const suscan_inspector_factory_t *self)
+{
+  return suscan_inspsched_get_backpressure_count(self->sched);
+}
+
 SUINLINE void
 suscan_inspector_factory_get_time(
   const suscan_inspector_factory_t *self,
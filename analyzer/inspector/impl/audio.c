@@ -61,6 +61,8 @@ struct suscan_audio_inspector_params {
 
 #define SUSCAN_AUDIO_SQUELCH_AVG_SECONDS          1e-2
 
+#define SUSCAN_AUDIO_INSPECTOR_BLOCK_SIZE         512
+
 struct suscan_audio_inspector {
   struct suscan_inspector_sampling_info samp_info;
   struct suscan_audio_inspector_params req_params;
@@ -86,6 +88,9 @@ struct suscan_audio_inspector {
   SUFLOAT am_power_carr;  /* Measure of AM power carrier */
 
   SUFLOAT ssb_power_chan; /* Measure of SSB power */
+
+  SUCOMPLEX block[SUSCAN_AUDIO_INSPECTOR_BLOCK_SIZE];
+  SUFLOAT   power[SUSCAN_AUDIO_INSPECTOR_BLOCK_SIZE];
 };
 
 SUPRIVATE void
@@ -308,134 +313,245 @@ suscan_audio_inspector_commit_config(void *private)
   self->cur_params = self->req_params;
 }
 
-SUSDIFF
-suscan_audio_inspector_feed(
-    void *private,
-    suscan_inspector_t *insp,
+/*
+ * Demodulation runs per block: the demodulator is chosen once per block,
+ * and every stage runs over the whole block before the next one starts.
+ */
+SUPRIVATE void
+suscan_audio_inspector_load_block(
+    struct suscan_audio_inspector *self,
     const SUCOMPLEX *x,
+    SUCOMPLEX *y,
+    SUSCOUNT count)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < count; ++i)
+    y[i] = SU_C_VALID(x[i]) ? x[i] : 0;
+}
+
+/* SSB squelch. Returns SU_TRUE if it was closed during the whole block */
+SUPRIVATE SUBOOL
+suscan_audio_inspector_ssb_squelch_block(
+    struct suscan_audio_inspector *self,
+    suscan_inspector_t *insp,
+    SUCOMPLEX *y,
+    SUSCOUNT count)
+{
+  SUFLOAT level = self->cur_params.audio.squelch_level
+    * suscan_inspector_get_equiv_bw(insp)
+    / suscan_inspector_get_equiv_fs(insp);
+  SUBOOL closed = SU_TRUE;
+  SUSCOUNT i;
+
+  for (i = 0; i < count; ++i)
+    self->power[i] = SU_C_REAL(y[i]) * SU_C_REAL(y[i])
+      + SU_C_IMAG(y[i]) * SU_C_IMAG(y[i]);
+
+  for (i = 0; i < count; ++i) {
+    SU_SPLPF_FEED(self->ssb_power_chan, self->power[i], self->sql_alpha);
+
+    if (self->ssb_power_chan < level)
+      y[i] = 0;
+    else
+      closed = SU_FALSE;
+  }
+
+  return closed;
+}
+
+SUPRIVATE void
+suscan_audio_inspector_gain_block(
+    struct suscan_audio_inspector *self,
+    SUCOMPLEX *y,
     SUSCOUNT count)
 {
-  SUCOMPLEX last, det_x, output = 0;
+  SUFLOAT gain = 2 * self->cur_params.gc.gc_gain;
   SUSCOUNT i;
-  SUCOMPLEX lo;
+
+  switch (self->cur_params.gc.gc_ctrl) {
+    case SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL:
+      for (i = 0; i < count; ++i)
+        y[i] *= gain;
+      break;
+
+    case SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC:
+      for (i = 0; i < count; ++i)
+        y[i] = 2 * su_agc_feed(&self->agc, y[i]);
+      break;
+  }
+}
+
+SUPRIVATE void
+suscan_audio_inspector_fm_block(
+    struct suscan_audio_inspector *self,
+    SUCOMPLEX *y,
+    SUSCOUNT count)
+{
   SUCOMPLEX ylp;
-  struct suscan_audio_inspector *self =
-      (struct suscan_audio_inspector *) private;
+  SUSCOUNT i;
 
-  if (self->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_DISABLED)
-    return count;
+  self->last = suscan_spectsrc_kernel_phasediff(y, count, self->last, 1 / M_PI);
 
-  last = self->last;
+  /*
+   * FM squelch compares the output in lower frequencies
+   * with the output of the full channel.
+   */
+  if (self->cur_params.audio.squelch) {
+    for (i = 0; i < count; ++i)
+      self->power[i] = SU_C_REAL(y[i]) * SU_C_REAL(y[i]);
 
-  for (i = 0; i < count && suscan_inspector_sampler_buf_avail(insp) > 0; ++i) {
-    det_x = SU_C_VALID(x[i]) ? x[i] : 0;
+    for (i = 0; i < count; ++i) {
+      ylp = su_iir_filt_feed(&self->fm_lpf, y[i]);
 
-    if (self->cur_params.audio.squelch
-        && (self->cur_params.audio.demod
-              == SUSCAN_INSPECTOR_AUDIO_DEMOD_LSB
-            || self->cur_params.audio.demod
-                == SUSCAN_INSPECTOR_AUDIO_DEMOD_USB)) {
       SU_SPLPF_FEED(
-          self->ssb_power_chan,
-          SU_C_REAL(det_x * SU_C_CONJ(det_x)),
+          self->fm_power_low,
+          SU_C_REAL(ylp * SU_C_CONJ(ylp)),
           self->sql_alpha);
 
-      if (self->ssb_power_chan
-          * suscan_inspector_get_equiv_fs(insp)
-            / suscan_inspector_get_equiv_bw(insp)
-            < self->cur_params.audio.squelch_level)
-        det_x = 0;
+      SU_SPLPF_FEED(self->fm_power_chan, self->power[i], self->sql_alpha);
+
+      if (!sufreleq(self->fm_power_chan, self->fm_power_low, 1e-1))
+        y[i] = 0;
     }
+  }
+}
 
-    /* Perform gain control */
-    switch (self->cur_params.gc.gc_ctrl) {
-      case SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL:
-        det_x = 2 * self->cur_params.gc.gc_gain * det_x;
-        break;
+SUPRIVATE void
+suscan_audio_inspector_am_block(
+    struct suscan_audio_inspector *self,
+    SUCOMPLEX *y,
+    SUSCOUNT count)
+{
+  SUCOMPLEX carrier = self->last;
+  SUSCOUNT i;
 
-      case SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC:
-        det_x  = 2 * su_agc_feed(&self->agc, det_x);
-        break;
+  /* Synchronous detection and carrier removal */
+  if (self->cur_params.audio.squelch) {
+    for (i = 0; i < count; ++i) {
+      y[i] = su_pll_track(&self->pll, y[i]);
+      SU_SPLPF_FEED(carrier, y[i], self->beta);
+      SU_SPLPF_FEED(
+          self->am_power_carr,
+          SU_C_REAL(carrier * SU_C_CONJ(carrier)),
+          self->sql_alpha);
+
+      if (self->am_power_carr < self->cur_params.audio.squelch_level)
+        y[i] = 0;
+      else
+        y[i] -= carrier;
+    }
+  } else {
+    for (i = 0; i < count; ++i) {
+      y[i] = su_pll_track(&self->pll, y[i]);
+      SU_SPLPF_FEED(carrier, y[i], self->beta);
+      y[i] -= carrier;
     }
+  }
 
-    switch (self->cur_params.audio.demod) {
-      case SUSCAN_INSPECTOR_AUDIO_DEMOD_FM:
-        output = SU_C_ARG(det_x * SU_C_CONJ(last)) / M_PI;
-        last   = det_x;
+  self->last = carrier;
+}
 
-        /*
-         * FM squelch compares the output in lower frequencies
-         * with the output of the full channel.
-         */
-        if (self->cur_params.audio.squelch) {
-          ylp = su_iir_filt_feed(&self->fm_lpf, output);
+SUPRIVATE void
+suscan_audio_inspector_output_block(
+    struct suscan_audio_inspector *self,
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *y,
+    SUSCOUNT count,
+    SUFLOAT volume)
+{
+  SUCOMPLEX output;
+  SUSCOUNT i;
+
+  for (i = 0; i < count; ++i) {
+    output = su_iir_filt_feed(&self->filt, volume * y[i]);
+
+    if (su_sampler_feed(&self->sampler, &output))
+      suscan_inspector_push_sample(insp, output * .75);
+  }
+}
 
-          SU_SPLPF_FEED(
-              self->fm_power_low,
-              SU_C_REAL(ylp * SU_C_CONJ(ylp)),
-              self->sql_alpha);
+SUSDIFF
+suscan_audio_inspector_feed(
+    void *private,
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    SUSCOUNT count)
+{
+  SUSCOUNT i = 0;
+  SUSCOUNT j, chunk;
+  SUFLOAT volume;
+  SUBOOL ssb;
+  struct suscan_audio_inspector *self =
+      (struct suscan_audio_inspector *) private;
+  SUCOMPLEX *y = self->block;
 
-          SU_SPLPF_FEED(
-              self->fm_power_chan,
-              SU_C_REAL(output * SU_C_CONJ(output)),
-              self->sql_alpha);
+  if (self->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_DISABLED)
+    return count;
 
-          if (!sufreleq(self->fm_power_chan, self->fm_power_low, 1e-1))
-            output = 0;
-        }
+  ssb = self->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_LSB
+    || self->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_USB;
+
+  volume = self->cur_params.audio.volume;
+  if (self->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_AM)
+    volume *= SUSCAN_AUDIO_AM_ATTENUATION;
+
+  /*
+   * The sampler yields at most one sample per input sample, so blocks
+   * that fit in the room left in the sampler buffer consume exactly the
+   * samples a sample-by-sample loop would.
+   */
+  while (i < count && (chunk = suscan_inspector_sampler_buf_avail(insp)) > 0) {
+    if (chunk > count - i)
+      chunk = count - i;
+    if (chunk > SUSCAN_AUDIO_INSPECTOR_BLOCK_SIZE)
+      chunk = SUSCAN_AUDIO_INSPECTOR_BLOCK_SIZE;
+
+    suscan_audio_inspector_load_block(self, x + i, y, chunk);
+
+    /*
+     * SSB squelch works on the input power. While it is closed, the
+     * demodulator output is silence and only the audio filter is fed.
+     */
+    if (ssb
+        && self->cur_params.audio.squelch
+        && suscan_audio_inspector_ssb_squelch_block(self, insp, y, chunk)) {
+      suscan_audio_inspector_output_block(self, insp, y, chunk, 0);
+      i += chunk;
+      continue;
+    }
+
+    /* Perform gain control */
+    suscan_audio_inspector_gain_block(self, y, chunk);
 
+    switch (self->cur_params.audio.demod) {
+      case SUSCAN_INSPECTOR_AUDIO_DEMOD_FM:
+        suscan_audio_inspector_fm_block(self, y, chunk);
         break;
 
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_AM:
-        /* Synchronous detection */
-        output  = su_pll_track(&self->pll, det_x);
-
-        /* Carrier removal */
-        SU_SPLPF_FEED(last, output, self->beta);
-
-        if (self->cur_params.audio.squelch) {
-          SU_SPLPF_FEED(
-              self->am_power_carr,
-              SU_C_REAL(last * SU_C_CONJ(last)),
-              self->sql_alpha);
-
-          if (self->am_power_carr < self->cur_params.audio.squelch_level)
-            output = 0;
-          else
-            output -= last;
-        } else {
-          output -= last;
-        }
-
-        /* Volume attenuation */
-        output *= SUSCAN_AUDIO_AM_ATTENUATION;
+        suscan_audio_inspector_am_block(self, y, chunk);
         break;
 
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_USB:
-        lo = su_ncqo_read(&self->lo);
-        output  = det_x * lo;
+        for (j = 0; j < chunk; ++j)
+          y[j] *= su_ncqo_read(&self->lo);
         break;
 
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_LSB:
-        lo = su_ncqo_read(&self->lo);
-        output = det_x * SU_C_CONJ(lo);
+        for (j = 0; j < chunk; ++j)
+          y[j] *= SU_C_CONJ(su_ncqo_read(&self->lo));
         break;
 
       default:
-        break;
+        memset(y, 0, chunk * sizeof(SUCOMPLEX));
     }
 
-    output *= self->cur_params.audio.volume;
+    suscan_audio_inspector_output_block(self, insp, y, chunk, volume);
 
-    output = su_iir_filt_feed(&self->filt, output);
-
-    if (su_sampler_feed(&self->sampler, &output))
-      suscan_inspector_push_sample(insp, output * .75);
+    i += chunk;
   }
 
-
-  self->last = last;
-
   return i;
 }
 
@@ -39,6 +39,7 @@
 #define SUSCAN_PSK_INSPECTOR_DEFAULT_EQ_MU     1e-3
 #define SUSCAN_PSK_INSPECTOR_DEFAULT_EQ_LENGTH 20
 #define SUSCAN_PSK_INSPECTOR_MAX_MF_SPAN       1024
+#define SUSCAN_PSK_INSPECTOR_BLOCK_SIZE        512
 
 /*
  * Spike durations measured in symbol times
@@ -76,6 +77,8 @@ struct suscan_psk_inspector {
   su_ncqo_t           lo;         /* Oscillator for manual carrier offset */
 
   SUCOMPLEX           phase;      /* Local oscillator phase */
+
+  SUCOMPLEX           block[SUSCAN_PSK_INSPECTOR_BLOCK_SIZE];
 };
 
 SUSCOUNT
@@ -393,69 +396,139 @@ suscan_psk_inspector_commit_config(void *private)
   }
 }
 
-SUSDIFF
-suscan_psk_inspector_feed(
-    void *private,
-    suscan_inspector_t *insp,
+/*
+ * The front end is processed in blocks. Every stage runs over the whole
+ * block before the next one starts, with its configuration checked once
+ * per block. Open-loop stages (carrier mixing and manual gain) reduce to
+ * a single complex product per sample, and closed loops (AGC, Costas,
+ * clock recovery) run in tight loops of their own.
+ */
+SUPRIVATE void
+suscan_psk_inspector_mix_block(
+    struct suscan_psk_inspector *self,
     const SUCOMPLEX *x,
+    SUCOMPLEX *y,
     SUSCOUNT count)
 {
+  SUCOMPLEX k = self->phase;
   SUSCOUNT i;
-  SUCOMPLEX det_x;
-  SUCOMPLEX output;
-  SUBOOL new_sample = SU_FALSE;
-  struct suscan_psk_inspector *psk_insp =
-      (struct suscan_psk_inspector *) private;
 
-  for (i = 0; i < count && suscan_inspector_sampler_buf_avail(insp) > 0; ++i) {
-    /* Re-center carrier */
-    det_x = x[i] * SU_C_CONJ(su_ncqo_read(&psk_insp->lo)) * psk_insp->phase;
+  if (self->cur_params.gc.gc_ctrl == SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL)
+    k *= 2 * self->cur_params.gc.gc_gain;
 
-    /* Perform gain control */
-    switch (psk_insp->cur_params.gc.gc_ctrl) {
-      case SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL:
-        det_x *= 2 * psk_insp->cur_params.gc.gc_gain;
-        break;
+  if (su_ncqo_get_freq(&self->lo) == 0) {
+    /* Constant oscillator: fold it into the gain */
+    k *= SU_C_CONJ(su_ncqo_read(&self->lo));
 
-      case SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC:
-        det_x  = 2 * su_agc_feed(&psk_insp->agc, det_x);
-        break;
-    }
+    for (i = 0; i < count; ++i)
+      y[i] = x[i] * k;
+  } else {
+    for (i = 0; i < count; ++i)
+      y[i] = x[i] * SU_C_CONJ(su_ncqo_read(&self->lo)) * k;
+  }
+}
+
+SUPRIVATE void
+suscan_psk_inspector_sync_block(
+    struct suscan_psk_inspector *self,
+    suscan_inspector_t *insp,
+    SUCOMPLEX *y,
+    SUSCOUNT count)
+{
+  SUSCOUNT i;
+
+  /* Perform gain control */
+  if (self->cur_params.gc.gc_ctrl == SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC)
+    for (i = 0; i < count; ++i)
+      y[i] = 2 * su_agc_feed(&self->agc, y[i]);
 
-    /* Perform frequency correction */
-    if (psk_insp->cur_params.fc.fc_ctrl
-        != SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL) {
-      su_costas_feed(&psk_insp->costas, det_x);
-      det_x = psk_insp->costas.y;
+  /* Perform frequency correction */
+  if (self->cur_params.fc.fc_ctrl != SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL)
+    for (i = 0; i < count; ++i) {
+      su_costas_feed(&self->costas, y[i]);
+      y[i] = self->costas.y;
     }
 
-    /* Save for subcarrier inspection */
-    suscan_inspector_feed_sc_sample(insp, det_x);
+  /* Save for subcarrier inspection */
+  for (i = 0; i < count; ++i)
+    suscan_inspector_feed_sc_sample(insp, y[i]);
 
-    /* Add matched filter, if enabled */
-    if (psk_insp->cur_params.mf.mf_conf == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL)
-      det_x = su_iir_filt_feed(&psk_insp->mf, det_x);
+  /* Add matched filter, if enabled */
+  if (self->cur_params.mf.mf_conf == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL)
+    for (i = 0; i < count; ++i)
+      y[i] = su_iir_filt_feed(&self->mf, y[i]);
+}
 
-    /* Check if channel sampler is enabled */
-    if (psk_insp->cur_params.br.br_ctrl == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
-      output = det_x;
-      new_sample = su_sampler_feed(&psk_insp->sampler, &output);
-    } else {
-      /* Automatic baudrate control enabled */
-      su_clock_detector_feed(&psk_insp->cd, det_x);
-      new_sample = su_clock_detector_read(&psk_insp->cd, &output, 1) == 1;
-    }
+SUINLINE void
+suscan_psk_inspector_push_symbol(
+    struct suscan_psk_inspector *self,
+    suscan_inspector_t *insp,
+    SUCOMPLEX output)
+{
+  /* Apply channel equalizer, if enabled */
+  if (self->cur_params.eq.eq_conf == SUSCAN_INSPECTOR_EQUALIZER_CMA)
+    output = su_equalizer_feed(&self->eq, output);
+
+  /* Reduce amplitude so it fits in the constellation window */
+  suscan_inspector_push_sample(insp, output * .75);
+}
 
-    /* Apply channel equalizer, if enabled */
-    if (new_sample) {
-      if (psk_insp->cur_params.eq.eq_conf == SUSCAN_INSPECTOR_EQUALIZER_CMA) {
-        output = su_equalizer_feed(&psk_insp->eq, output);
-      }
+SUPRIVATE void
+suscan_psk_inspector_sample_block(
+    struct suscan_psk_inspector *self,
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *y,
+    SUSCOUNT count)
+{
+  SUCOMPLEX output;
+  SUSCOUNT i;
 
-      /* Reduce amplitude so it fits in the constellation window */
-      suscan_inspector_push_sample(insp, output * .75);
+  if (self->cur_params.br.br_ctrl
+      == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
+    for (i = 0; i < count; ++i) {
+      output = y[i];
+      if (su_sampler_feed(&self->sampler, &output))
+        suscan_psk_inspector_push_symbol(self, insp, output);
+    }
+  } else {
+    /* Automatic baudrate control enabled */
+    for (i = 0; i < count; ++i) {
+      su_clock_detector_feed(&self->cd, y[i]);
+      if (su_clock_detector_read(&self->cd, &output, 1) == 1)
+        suscan_psk_inspector_push_symbol(self, insp, output);
     }
   }
+}
+
+SUSDIFF
+suscan_psk_inspector_feed(
+    void *private,
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    SUSCOUNT count)
+{
+  SUSCOUNT i = 0;
+  SUSCOUNT chunk;
+  struct suscan_psk_inspector *psk_insp =
+      (struct suscan_psk_inspector *) private;
+
+  /*
+   * Every input sample yields at most one symbol. Blocks no longer than
+   * the room left in the sampler buffer consume exactly the samples that
+   * a sample-by-sample loop would.
+   */
+  while (i < count && (chunk = suscan_inspector_sampler_buf_avail(insp)) > 0) {
+    if (chunk > count - i)
+      chunk = count - i;
+    if (chunk > SUSCAN_PSK_INSPECTOR_BLOCK_SIZE)
+      chunk = SUSCAN_PSK_INSPECTOR_BLOCK_SIZE;
+
+    suscan_psk_inspector_mix_block(psk_insp, x + i, psk_insp->block, chunk);
+    suscan_psk_inspector_sync_block(psk_insp, insp, psk_insp->block, chunk);
+    suscan_psk_inspector_sample_block(psk_insp, insp, psk_insp->block, chunk);
+
+    i += chunk;
+  }
 
   return i;
 }
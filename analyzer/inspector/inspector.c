@@ -34,6 +34,7 @@
 
 #include "realtime.h"
 #include "msg.h"
+#include "bufpool.h"
 
 void
 suscan_inspector_lock(suscan_inspector_t *insp)
@@ -351,6 +352,177 @@ suscan_inspector_register_factory(void)
   return suscan_inspector_factory_class_register(&g_sc_factory);
 }
 
+/******************************* Power gate **********************************/
+SUBOOL
+suscan_inspector_set_gate(
+  suscan_inspector_t *self,
+  SUFLOAT threshold,
+  enum suscan_inspector_gate_policy policy)
+{
+  if (threshold < 0 || policy >= SUSCAN_INSPECTOR_GATE_POLICY_COUNT)
+    return SU_FALSE;
+
+  self->gate_policy    = policy;
+  self->gate_threshold = threshold;
+
+  return SU_TRUE;
+}
+
+void
+suscan_inspector_get_gate_report(
+  const suscan_inspector_t *self,
+  struct suscan_analyzer_inspector_msg *msg)
+{
+  msg->gate_threshold = self->gate_threshold;
+  msg->gate_policy    = self->gate_policy;
+  msg->gate_suspended = self->gate_suspended;
+  msg->gate_power     = self->gate_power;
+  msg->gate_skipped   = self->gate_skipped;
+  msg->gate_saved_ns  = self->gate_saved_ns;
+}
+
+SUPRIVATE SUBOOL
+suscan_inspector_send_gate_report(suscan_inspector_t *self)
+{
+  struct suscan_analyzer_inspector_msg *msg = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+    msg = suscan_analyzer_inspector_msg_new(
+      SUSCAN_ANALYZER_INSPECTOR_MSGKIND_GATE_REPORT,
+      rand()),
+    goto done);
+
+  msg->inspector_id = self->inspector_id;
+  suscan_inspector_get_gate_report(self, msg);
+
+  SU_TRYCATCH(
+    suscan_mq_write(
+      self->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      msg),
+    goto done);
+
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    suscan_analyzer_inspector_msg_destroy(msg);
+
+  return ok;
+}
+
+/*
+ * The gate is checked by the factory before queuing a window, so a
+ * suspended inspector costs one power estimate per window. It opens as
+ * soon as a window is above the threshold (that same window is processed)
+ * and closes after SUSCAN_INSPECTOR_GATE_HANG_TIME below it.
+ */
+SUBOOL
+suscan_inspector_gate_feed(
+  suscan_inspector_t *self,
+  const SUCOMPLEX *data,
+  SUSCOUNT size)
+{
+  SUFLOAT threshold = self->gate_threshold;
+  SUFLOAT power = 0;
+  SUFLOAT cost;
+  SUSCOUNT i;
+
+  if (threshold <= 0 && !self->gate_suspended)
+    return SU_TRUE;
+
+  for (i = 0; i < size; ++i)
+    power += SU_C_REAL(data[i]) * SU_C_REAL(data[i])
+      + SU_C_IMAG(data[i]) * SU_C_IMAG(data[i]);
+
+  if (size > 0)
+    power /= size;
+
+  self->gate_power = power;
+
+  if (threshold <= 0 || power >= threshold) {
+    self->gate_quiet = 0;
+
+    if (self->gate_suspended) {
+      self->gate_suspended = SU_FALSE;
+      self->gate_reset =
+        self->gate_policy == SUSCAN_INSPECTOR_GATE_POLICY_RESET;
+      (void) suscan_inspector_send_gate_report(self);
+    }
+
+    return SU_TRUE;
+  }
+
+  if (!self->gate_suspended) {
+    self->gate_quiet += size;
+    if (self->gate_quiet
+      < SUSCAN_INSPECTOR_GATE_HANG_TIME * self->samp_info.equiv_fs)
+      return SU_TRUE;
+
+    self->gate_suspended = SU_TRUE;
+    (void) suscan_inspector_send_gate_report(self);
+  }
+
+  /* Last measured cost of a window is what we are saving. Workers update it */
+  __atomic_load(&self->sched_cost, &cost, __ATOMIC_RELAXED);
+
+  ++self->gate_skipped;
+  if (cost > 0)
+    self->gate_saved_ns += cost;
+
+  return SU_FALSE;
+}
+
+/*
+ * Implements the reset policy: the demodulator is opened again from
+ * scratch with the current configuration.
+ */
+SUPRIVATE SUBOOL
+suscan_inspector_reset_demodulator(suscan_inspector_t *self)
+{
+  suscan_config_t *config = NULL;
+  void *privdata = NULL;
+  SUBOOL locked = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  /* Commit pending requests first, or they will be lost */
+  suscan_inspector_assert_params(self);
+
+  SU_TRYCATCH(config = suscan_inspector_create_config(self), goto done);
+
+  suscan_inspector_lock(self);
+  locked = SU_TRUE;
+
+  SU_TRYCATCH((self->iface->get_config) (self->privdata, config), goto done);
+  SU_TRYCATCH(privdata = (self->iface->open) (&self->samp_info), goto done);
+  SU_TRYCATCH((self->iface->parse_config) (privdata, config), goto done);
+  (self->iface->commit_config) (privdata);
+
+  if (self->new_bandwidth > 0 && self->iface->new_bandwidth != NULL)
+    (self->iface->new_bandwidth) (privdata, self->new_bandwidth);
+
+  (self->iface->close) (self->privdata);
+  self->privdata = privdata;
+  privdata = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (locked)
+    suscan_inspector_unlock(self);
+
+  if (privdata != NULL)
+    (self->iface->close) (privdata);
+
+  if (config != NULL)
+    suscan_config_destroy(config);
+
+  return ok;
+}
+
 /********************* Inspector loop methods ***************************/
 SUBOOL
 suscan_inspector_sampler_loop(
@@ -359,8 +531,15 @@ suscan_inspector_sampler_loop(
     SUSCOUNT samp_count)
 {
   struct suscan_analyzer_sample_batch_msg *msg = NULL;
+  SUCOMPLEX *fresh = NULL;
   SUSDIFF fed;
 
+  /* Resuming from a suspension with the reset policy */
+  if (insp->gate_reset) {
+    insp->gate_reset = SU_FALSE;
+    SU_TRYCATCH(suscan_inspector_reset_demodulator(insp), goto fail);
+  }
+
   while (samp_count > 0) {
     /* Ensure the current inspector parameters are up-to-date */
     suscan_inspector_assert_params(insp);
@@ -370,13 +549,31 @@ suscan_inspector_sampler_loop(
         goto fail);
 
     if (suscan_inspector_get_output_length(insp) > insp->sample_msg_watermark) {
-      /* New samples produced by sampler: send to client */
-      SU_TRYCATCH(
-          msg = suscan_analyzer_sample_batch_msg_new(
-              insp->inspector_id,
-              suscan_inspector_get_output_buffer(insp),
-              suscan_inspector_get_output_length(insp)),
-          goto fail);
+      /*
+       * New samples produced by sampler: send to client. Instead of
+       * copying them, we hand the sampler buffer off to the message and
+       * continue with a fresh one from the pool. If the pool cannot
+       * provide one, fall back to copying.
+       */
+      if ((fresh = suscan_buffer_alloc(SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE))
+        != NULL) {
+        SU_TRYCATCH(
+            msg = suscan_analyzer_sample_batch_msg_new_from_pool(
+                insp->inspector_id,
+                insp->sampler_buf,
+                suscan_inspector_get_output_length(insp)),
+            goto fail);
+
+        insp->sampler_buf = fresh;
+        fresh = NULL;
+      } else {
+        SU_TRYCATCH(
+            msg = suscan_analyzer_sample_batch_msg_new(
+                insp->inspector_id,
+                suscan_inspector_get_output_buffer(insp),
+                suscan_inspector_get_output_length(insp)),
+            goto fail);
+      }
 
       /* Reset size */
       insp->sampler_ptr = 0;
@@ -401,6 +598,9 @@ fail:
   if (msg != NULL)
     suscan_analyzer_sample_batch_msg_destroy(msg);
 
+  if (fresh != NULL)
+    suscan_buffer_return(fresh);
+
   return SU_FALSE;
 }
 
@@ -695,6 +895,9 @@ suscan_inspector_destroy(suscan_inspector_t *self)
   if (self->spectsrc_list != NULL)
     free(self->spectsrc_list);
 
+  if (self->sampler_buf != NULL)
+    suscan_buffer_return(self->sampler_buf);
+
   free(self);
 }
 
@@ -943,6 +1146,11 @@ suscan_inspector_new(
   SU_TRYCATCH(new = calloc(1, sizeof (suscan_inspector_t)), goto fail);
   new->state            = SUSCAN_ASYNC_STATE_CREATED;
   new->samp_info        = *samp_info;
+  new->sched_affinity   = -1;
+
+  SU_TRYCATCH(
+    new->sampler_buf = suscan_buffer_alloc(SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE),
+    goto fail);
 
   /* Initialize reference counting */
   SU_TRYCATCH(SUSCAN_INIT_REFCOUNT(suscan_inspector, new), goto fail);
@@ -38,7 +38,17 @@ extern "C" {
 #define SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE  SU_BLOCK_STREAM_BUFFER_SIZE
 #define SUSCAN_INSPECTOR_SPECTRUM_BUF_SIZE 8192
 
+#define SUSCAN_INSPECTOR_GATE_HANG_TIME    .25 /* Seconds before suspending */
+
 struct suscan_inspector_factory;
+struct suscan_analyzer_inspector_msg;
+
+/* What to do with the demodulator state after a suspension */
+enum suscan_inspector_gate_policy {
+  SUSCAN_INSPECTOR_GATE_POLICY_FREEZE, /* Resume where it was left */
+  SUSCAN_INSPECTOR_GATE_POLICY_RESET,  /* Start over on resume */
+  SUSCAN_INSPECTOR_GATE_POLICY_COUNT
+};
 
 enum suscan_aync_state {
   SUSCAN_ASYNC_STATE_CREATED,
@@ -95,8 +105,24 @@ struct suscan_inspector {
   pthread_mutex_t                  sc_stuner_mutex;
   SUBOOL                           sc_stuner_init;
 
-  /* Sampler output */
-  SUCOMPLEX sampler_buf[SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE];
+  /* Scheduling information (inspector scheduler) */
+  int          sched_affinity; /* Preferred worker, -1 if not assigned yet */
+  SUFLOAT      sched_cost;     /* Measured processing time per task (ns) */
+  unsigned int sched_inflight; /* Tasks queued or being processed */
+  SUBOOL       sched_busy;     /* A worker is processing a task */
+
+  /* Power gate (suspends the inspector while the channel is idle) */
+  SUFLOAT      gate_threshold; /* Mean channel power. 0: disabled */
+  enum suscan_inspector_gate_policy gate_policy;
+  SUFLOAT      gate_power;     /* Power of the last window */
+  SUSCOUNT     gate_quiet;     /* Samples below threshold */
+  SUBOOL       gate_suspended;
+  SUBOOL       gate_reset;     /* Reset demodulator before next feed */
+  uint64_t     gate_skipped;   /* Windows not processed */
+  uint64_t     gate_saved_ns;  /* Estimated processing time saved */
+
+  /* Sampler output (pool buffer, handed off to sample batch messages) */
+  SUCOMPLEX *sampler_buf;
   SUSCOUNT  sampler_ptr;
   SUSCOUNT  sample_msg_watermark; /* Watermark. When reached, message is sent */
 
@@ -266,6 +292,21 @@ SUBOOL suscan_inspector_deliver_report(
 
 void suscan_inspector_assert_params(suscan_inspector_t *insp);
 
+SUBOOL suscan_inspector_set_gate(
+  suscan_inspector_t *self,
+  SUFLOAT threshold,
+  enum suscan_inspector_gate_policy policy);
+
+void suscan_inspector_get_gate_report(
+  const suscan_inspector_t *self,
+  struct suscan_analyzer_inspector_msg *msg);
+
+/* Called from the factory for every window. SU_FALSE: skip the window */
+SUBOOL suscan_inspector_gate_feed(
+  suscan_inspector_t *self,
+  const SUCOMPLEX *data,
+  SUSCOUNT size);
+
 void suscan_inspector_destroy(suscan_inspector_t *insp);
 
 SUBOOL suscan_inspector_set_config(
@@ -26,6 +26,7 @@
 
 #include <compat.h>
 #include "msg.h"
+#include "realtime.h"
 
 /*************************** Task Info API ***************************/
 SUPRIVATE struct suscan_inspector_task_info *
@@ -45,6 +46,12 @@ suscan_inspector_task_info_new(suscan_inspector_t *inspector)
 SUPRIVATE void
 suscan_inspector_task_info_destroy(struct suscan_inspector_task_info *info)
 {
+  if (info == NULL)
+    return;
+
+  if (info->buffer != NULL)
+    free(info->buffer);
+
   free(info);
 }
 
@@ -122,30 +129,128 @@ done:
   if (mutex_acquired)
     (void) pthread_mutex_unlock(&self->task_mutex);
 
-  if (task_info == NULL)
+  /* Only if we could not put it back into the free list */
+  if (task_info != NULL)
     suscan_inspector_task_info_destroy(task_info);
 }
 
 
-/****************************** Inspsched API ****************************/
+/***************************** Pipelined mode ******************************/
+SUPRIVATE struct suscan_inspsched_window *
+suscan_inspsched_acquire_window(suscan_inspsched_t *self)
+{
+  struct suscan_inspsched_window *window = NULL;
+  SUBOOL waited = SU_FALSE;
+  unsigned int i;
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->window_mutex) == 0, return NULL);
+
+  for (;;) {
+    for (i = 0; i < self->pipeline_depth; ++i)
+      if (self->window_list[i].refcnt == 0) {
+        window = self->window_list + i;
+        break;
+      }
+
+    if (window != NULL)
+      break;
+
+    /* All windows are still in use. Back-pressure the source. */
+    if (!waited) {
+      ++self->backpressure_count;
+      waited = SU_TRUE;
+    }
+
+    pthread_cond_wait(&self->window_cond, &self->window_mutex);
+  }
+
+  /* This reference is held by the source until the window is closed */
+  window->refcnt = 1;
+
+  (void) pthread_mutex_unlock(&self->window_mutex);
+
+  return window;
+}
+
+SUPRIVATE void
+suscan_inspsched_release_window(
+    suscan_inspsched_t *self,
+    struct suscan_inspsched_window *window)
+{
+  (void) pthread_mutex_lock(&self->window_mutex);
+
+  if (--window->refcnt == 0)
+    pthread_cond_signal(&self->window_cond);
+
+  (void) pthread_mutex_unlock(&self->window_mutex);
+}
+
+/*
+ * The data delivered by the spectral tuner is only valid until the next
+ * window. Since we are not waiting for the inspectors to finish, we must
+ * keep a copy of it and attach the task to the current window.
+ */
 SUPRIVATE SUBOOL
-suscan_inpsched_task_cb(
-    struct suscan_mq *mq_out,
-    void *wk_private,
-    void *cb_private)
+suscan_inspsched_detach_task(
+    suscan_inspsched_t *self,
+    struct suscan_inspector_task_info *task_info)
 {
-  suscan_inspsched_t *sched = (suscan_inspsched_t *) wk_private;
-  struct suscan_inspector_task_info *task_info =
-      (struct suscan_inspector_task_info *) cb_private;
-  SUBOOL ok = SU_FALSE;
+  SUCOMPLEX *tmp;
 
+  if (self->curr_window == NULL)
+    SU_TRYCATCH(
+        self->curr_window = suscan_inspsched_acquire_window(self),
+        return SU_FALSE);
+
+  if (task_info->buffer_alloc < task_info->size) {
+    SU_TRYCATCH(
+        tmp = realloc(task_info->buffer, task_info->size * sizeof(SUCOMPLEX)),
+        return SU_FALSE);
+
+    task_info->buffer       = tmp;
+    task_info->buffer_alloc = task_info->size;
+  }
+
+  memcpy(task_info->buffer, task_info->data, task_info->size * sizeof(SUCOMPLEX));
+  task_info->data = task_info->buffer;
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->window_mutex) == 0, return SU_FALSE);
+  ++self->curr_window->refcnt;
+  task_info->window = self->curr_window;
+  (void) pthread_mutex_unlock(&self->window_mutex);
+
+  return SU_TRUE;
+}
+
+/****************************** Inspsched API ****************************/
+SUPRIVATE void
+suscan_inspsched_finish_task(
+    suscan_inspsched_t *sched,
+    struct suscan_inspector_task_info *task_info)
+{
+  if (task_info->window != NULL) {
+    suscan_inspsched_release_window(sched, task_info->window);
+    task_info->window = NULL;
+  }
+
+  (void) __atomic_sub_fetch(
+      &task_info->inspector->sched_inflight,
+      1,
+      __ATOMIC_ACQ_REL);
+
+  suscan_inspsched_return_task_info(sched, task_info);
+}
+
+SUPRIVATE SUBOOL
+suscan_inspsched_run_task(struct suscan_inspector_task_info *task_info)
+{
   /* Feed all enabled estimators */
   SU_TRYCATCH(
       suscan_inspector_estimator_loop(
           task_info->inspector,
           task_info->data,
           task_info->size),
-      goto fail);
+      return SU_FALSE);
 
   /* Feed spectrum */
   SU_TRYCATCH(
@@ -153,7 +258,7 @@ suscan_inpsched_task_cb(
           task_info->inspector,
           task_info->data,
           task_info->size),
-      goto fail);
+      return SU_FALSE);
 
   /*
    * We just process the incoming data. If we broke something,
@@ -164,15 +269,69 @@ suscan_inpsched_task_cb(
           task_info->inspector,
           task_info->data,
           task_info->size),
-      goto fail);
+      return SU_FALSE);
 
-  ok = SU_TRUE;
+  return SU_TRUE;
+}
 
-fail:
-  if (!ok)
+/*
+ * Cost estimates are written by the workers and read by the thread that
+ * queues the tasks without holding any lock. They are only hints, so a
+ * relaxed access is enough as long as it is not torn.
+ */
+SUINLINE SUFLOAT
+suscan_inspsched_load_cost(const SUFLOAT *cost)
+{
+  SUFLOAT value;
+
+  __atomic_load(cost, &value, __ATOMIC_RELAXED);
+
+  return value;
+}
+
+SUINLINE void
+suscan_inspsched_store_cost(SUFLOAT *cost, SUFLOAT value)
+{
+  __atomic_store(cost, &value, __ATOMIC_RELAXED);
+}
+
+/*
+ * Feeds the measured cost of a task back into the inspector. It is used
+ * for placement decisions and to account the time saved by the power gate.
+ * Only the worker processing the inspector updates it.
+ */
+SUINLINE void
+suscan_inspsched_update_cost(suscan_inspector_t *insp, uint64_t elapsed)
+{
+  SUFLOAT cost = suscan_inspsched_load_cost(&insp->sched_cost);
+
+  if (cost <= 0)
+    cost = elapsed;
+  else
+    cost += SUSCAN_INSPSCHED_COST_ALPHA * (elapsed - cost);
+
+  suscan_inspsched_store_cost(&insp->sched_cost, cost);
+}
+
+SUPRIVATE SUBOOL
+suscan_inpsched_task_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  suscan_inspsched_t *sched = (suscan_inspsched_t *) wk_private;
+  struct suscan_inspector_task_info *task_info =
+      (struct suscan_inspector_task_info *) cb_private;
+  uint64_t start = suscan_gettime();
+
+  if (!suscan_inspsched_run_task(task_info))
     task_info->inspector->state = SUSCAN_ASYNC_STATE_HALTING;
 
-  suscan_inspsched_return_task_info(sched, task_info);
+  suscan_inspsched_update_cost(
+    task_info->inspector,
+    suscan_gettime() - start);
+
+  suscan_inspsched_finish_task(sched, task_info);
 
   return SU_FALSE;
 }
@@ -202,30 +361,388 @@ suscan_inspsched_get_min_workers(void)
   return count - 1;
 }
 
+/************************* Work-stealing policy ******************************/
+SUPRIVATE void
+suscan_inspsched_queue_push_unsafe(
+    struct suscan_inspsched_queue *queue,
+    struct suscan_inspector_task_info *task_info)
+{
+  task_info->wq_next = NULL;
+  task_info->wq_prev = queue->tail;
+
+  if (queue->tail != NULL)
+    queue->tail->wq_next = task_info;
+  else
+    queue->head = task_info;
+
+  queue->tail = task_info;
+  (void) __atomic_add_fetch(&queue->size, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Take the oldest task whose inspector is not being processed by another
+ * worker. Since all queued tasks of an inspector live in the same queue,
+ * this preserves the order in which they were queued.
+ */
+SUPRIVATE struct suscan_inspector_task_info *
+suscan_inspsched_queue_pop(struct suscan_inspsched_queue *queue)
+{
+  struct suscan_inspector_task_info *task_info = NULL;
+
+  if (pthread_mutex_lock(&queue->mutex) != 0)
+    return NULL;
+
+  for (task_info = queue->head;
+      task_info != NULL;
+      task_info = task_info->wq_next)
+    if (!task_info->inspector->sched_busy)
+      break;
+
+  if (task_info != NULL) {
+    task_info->inspector->sched_busy = SU_TRUE;
+    task_info->queue = queue;
+
+    if (task_info->wq_prev != NULL)
+      task_info->wq_prev->wq_next = task_info->wq_next;
+    else
+      queue->head = task_info->wq_next;
+
+    if (task_info->wq_next != NULL)
+      task_info->wq_next->wq_prev = task_info->wq_prev;
+    else
+      queue->tail = task_info->wq_prev;
+
+    task_info->wq_next = task_info->wq_prev = NULL;
+    (void) __atomic_sub_fetch(&queue->size, 1, __ATOMIC_RELAXED);
+  }
+
+  (void) pthread_mutex_unlock(&queue->mutex);
+
+  return task_info;
+}
+
+SUPRIVATE struct suscan_inspector_task_info *
+suscan_inspsched_take_task(
+    suscan_inspsched_t *sched,
+    struct suscan_inspsched_queue *queue,
+    SUBOOL *stolen)
+{
+  struct suscan_inspector_task_info *task_info;
+  unsigned int i, victim;
+
+  *stolen = SU_FALSE;
+
+  if ((task_info = suscan_inspsched_queue_pop(queue)) != NULL)
+    return task_info;
+
+  /* Nothing to do in our queue: steal from the rest */
+  for (i = 1; i < sched->worker_count; ++i) {
+    victim = (queue->index + i) % sched->worker_count;
+    task_info = suscan_inspsched_queue_pop(sched->queue_list + victim);
+    if (task_info != NULL) {
+      *stolen = SU_TRUE;
+      return task_info;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Every queued task pushes one of these callbacks to some worker. The
+ * callback keeps taking tasks (either from its own queue or from others)
+ * until no task is pending, so no task can be left behind: if the only
+ * pending tasks belong to an inspector being processed elsewhere, the
+ * worker processing it will take them after it is done.
+ */
+SUPRIVATE SUBOOL
+suscan_inpsched_ws_task_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  suscan_inspsched_t *sched = (suscan_inspsched_t *) wk_private;
+  struct suscan_inspsched_queue *queue =
+    (struct suscan_inspsched_queue *) cb_private;
+  struct suscan_inspector_task_info *task_info;
+  suscan_inspector_t *insp;
+  uint64_t start, elapsed;
+  SUBOOL stolen;
+
+  __atomic_store_n(&queue->running, SU_TRUE, __ATOMIC_RELAXED);
+
+  while (__atomic_load_n(&sched->pending, __ATOMIC_ACQUIRE) > 0) {
+    if ((task_info = suscan_inspsched_take_task(sched, queue, &stolen))
+      == NULL)
+      break;
+
+    (void) __atomic_sub_fetch(&sched->pending, 1, __ATOMIC_ACQ_REL);
+
+    insp  = task_info->inspector;
+    start = suscan_gettime();
+
+    if (!suscan_inspsched_run_task(task_info))
+      insp->state = SUSCAN_ASYNC_STATE_HALTING;
+
+    elapsed = suscan_gettime() - start;
+
+    suscan_inspsched_update_cost(insp, elapsed);
+
+    /* Statistics may be read from other threads at any time */
+    (void) __atomic_add_fetch(&queue->tasks, 1, __ATOMIC_RELAXED);
+    (void) __atomic_add_fetch(
+      &queue->samples,
+      task_info->size,
+      __ATOMIC_RELAXED);
+    (void) __atomic_add_fetch(&queue->busy_ns, elapsed, __ATOMIC_RELAXED);
+    if (stolen)
+      (void) __atomic_add_fetch(&queue->stolen, 1, __ATOMIC_RELAXED);
+
+    /* Let other workers take the next task of this inspector */
+    (void) pthread_mutex_lock(&task_info->queue->mutex);
+    insp->sched_busy = SU_FALSE;
+    (void) pthread_mutex_unlock(&task_info->queue->mutex);
+
+    suscan_inspsched_finish_task(sched, task_info);
+  }
+
+  __atomic_store_n(&queue->running, SU_FALSE, __ATOMIC_RELAXED);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE unsigned int
+suscan_inspsched_find_least_loaded(const suscan_inspsched_t *sched)
+{
+  const struct suscan_inspsched_queue *queue;
+  unsigned int i, best = 0;
+  SUFLOAT load, best_load = INFINITY;
+
+  for (i = 0; i < sched->worker_count; ++i) {
+    queue = sched->queue_list + i;
+    load  = suscan_inspsched_load_cost(&queue->last_load)
+      + suscan_inspsched_load_cost(&queue->window_load);
+    if (load < best_load) {
+      best_load = load;
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+/*
+ * Decide which worker owns this inspector. Inspectors stick to their worker
+ * (keeping their state in that core's cache) unless the measured load of
+ * that worker is unbalanced enough to justify a migration. Inspectors with
+ * tasks in flight are never migrated, so their tasks are kept in order.
+ */
+SUPRIVATE unsigned int
+suscan_inspsched_place(suscan_inspsched_t *sched, suscan_inspector_t *insp)
+{
+  unsigned int best;
+  struct suscan_inspsched_queue *curr, *cand;
+  SUFLOAT cost = suscan_inspsched_load_cost(&insp->sched_cost);
+  SUFLOAT curr_load, cand_load;
+
+  best = suscan_inspsched_find_least_loaded(sched);
+
+  if (insp->sched_affinity < 0
+      || insp->sched_affinity >= (int) sched->worker_count) {
+    insp->sched_affinity = best;
+  } else if (insp->sched_affinity != best
+    && __atomic_load_n(&insp->sched_inflight, __ATOMIC_ACQUIRE) == 0) {
+    curr = sched->queue_list + insp->sched_affinity;
+    cand = sched->queue_list + best;
+
+    curr_load = suscan_inspsched_load_cost(&curr->last_load);
+    cand_load = suscan_inspsched_load_cost(&cand->last_load);
+
+    if (curr_load - cand_load > SUSCAN_INSPSCHED_MIGRATION_FACTOR * cost) {
+      /* Update load estimates, so we do not migrate everything at once */
+      suscan_inspsched_store_cost(&curr->last_load, curr_load - cost);
+      suscan_inspsched_store_cost(&cand->last_load, cand_load + cost);
+      insp->sched_affinity = best;
+    }
+  }
+
+  return insp->sched_affinity;
+}
+
+/* Queued tasks, plus one if the worker is processing a task */
+SUINLINE unsigned int
+suscan_inspsched_queue_occupancy(const struct suscan_inspsched_queue *queue)
+{
+  return __atomic_load_n(&queue->size, __ATOMIC_RELAXED)
+    + !!__atomic_load_n(&queue->running, __ATOMIC_RELAXED);
+}
+
+SUPRIVATE unsigned int
+suscan_inspsched_find_idle(
+    const suscan_inspsched_t *sched,
+    unsigned int preferred)
+{
+  unsigned int i, best = preferred;
+  unsigned int occupancy, best_occupancy;
+  const struct suscan_inspsched_queue *queue;
+
+  queue = sched->queue_list + preferred;
+  best_occupancy = suscan_inspsched_queue_occupancy(queue);
+
+  for (i = 0; i < sched->worker_count && best_occupancy > 0; ++i) {
+    queue = sched->queue_list + i;
+    occupancy = suscan_inspsched_queue_occupancy(queue);
+    if (occupancy < best_occupancy) {
+      best_occupancy = occupancy;
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+SUPRIVATE SUBOOL
+suscan_inspsched_queue_task_ws(
+    suscan_inspsched_t *sched,
+    struct suscan_inspector_task_info *task_info)
+{
+  struct suscan_inspsched_queue *queue;
+  unsigned int owner, target;
+
+  owner = suscan_inspsched_place(sched, task_info->inspector);
+  queue = sched->queue_list + owner;
+
+  /*
+   * The task must be counted as pending before any worker can pop it.
+   * Otherwise, the worker would decrement the counter first and make it
+   * wrap around.
+   */
+  SU_TRYCATCH(pthread_mutex_lock(&queue->mutex) == 0, return SU_FALSE);
+  (void) __atomic_add_fetch(
+      &task_info->inspector->sched_inflight,
+      1,
+      __ATOMIC_ACQ_REL);
+  (void) __atomic_add_fetch(&sched->pending, 1, __ATOMIC_ACQ_REL);
+  suscan_inspsched_queue_push_unsafe(queue, task_info);
+  suscan_inspsched_store_cost(
+      &queue->window_load,
+      suscan_inspsched_load_cost(&queue->window_load)
+      + suscan_inspsched_load_cost(&task_info->inspector->sched_cost));
+  (void) pthread_mutex_unlock(&queue->mutex);
+
+  /*
+   * Wake up the owner, unless it has work already. In that case, wake
+   * up the least busy worker and let it steal.
+   */
+  target = suscan_inspsched_find_idle(sched, owner);
+
+  /*
+   * The task belongs to the queue now. If we fail to wake up a worker,
+   * it will be taken by the next one.
+   */
+  if (!suscan_worker_push(
+      sched->worker_list[target],
+      suscan_inpsched_ws_task_cb,
+      sched->queue_list + target))
+    SU_WARNING("Failed to wake up inspector worker %d\n", target);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspsched_get_worker_stats(
+    suscan_inspsched_t *sched,
+    unsigned int worker,
+    struct suscan_inspsched_worker_stats *stats)
+{
+  const struct suscan_inspsched_queue *queue;
+
+  if (sched->queue_list == NULL || worker >= sched->worker_count)
+    return SU_FALSE;
+
+  queue = sched->queue_list + worker;
+
+  stats->tasks   = __atomic_load_n(&queue->tasks,   __ATOMIC_RELAXED);
+  stats->stolen  = __atomic_load_n(&queue->stolen,  __ATOMIC_RELAXED);
+  stats->samples = __atomic_load_n(&queue->samples, __ATOMIC_RELAXED);
+  stats->busy_ns = __atomic_load_n(&queue->busy_ns, __ATOMIC_RELAXED);
+
+  return SU_TRUE;
+}
+
 SUBOOL
 suscan_inspsched_queue_task(
     suscan_inspsched_t *sched,
     struct suscan_inspector_task_info *task_info)
 {
+  suscan_inspector_t *insp = task_info->inspector;
+  unsigned int worker;
+
+  if (suscan_inspsched_is_pipelined(sched))
+    SU_TRYCATCH(suscan_inspsched_detach_task(sched, task_info), return SU_FALSE);
+
+  if (sched->policy == SUSCAN_INSPSCHED_POLICY_WORK_STEALING)
+    return suscan_inspsched_queue_task_ws(sched, task_info);
+
+  worker = sched->last_worker;
+
+  /*
+   * In pipelined mode, tasks of the same inspector from different windows
+   * may coexist. Keep them in the same worker queue while any of them is
+   * in flight, so they are processed in order.
+   */
+  if (suscan_inspsched_is_pipelined(sched)) {
+    if (insp->sched_affinity < 0
+        || insp->sched_affinity >= (int) sched->worker_count
+        || __atomic_load_n(&insp->sched_inflight, __ATOMIC_ACQUIRE) == 0)
+      insp->sched_affinity = worker;
+    else
+      worker = insp->sched_affinity;
+  }
+
+  (void) __atomic_add_fetch(&insp->sched_inflight, 1, __ATOMIC_ACQ_REL);
+
   /* Process new samples */
   SU_TRYCATCH(
       suscan_worker_push(
-          sched->worker_list[sched->last_worker],
+          sched->worker_list[worker],
           suscan_inpsched_task_cb,
           task_info),
-      return SU_FALSE);
+      goto fail);
 
-  if (++sched->last_worker == sched->worker_count)
+  if (worker == sched->last_worker
+      && ++sched->last_worker == sched->worker_count)
     sched->last_worker = 0;
 
   return SU_TRUE;
+
+fail:
+  (void) __atomic_sub_fetch(&insp->sched_inflight, 1, __ATOMIC_ACQ_REL);
+
+  if (task_info->window != NULL) {
+    suscan_inspsched_release_window(sched, task_info->window);
+    task_info->window = NULL;
+  }
+
+  return SU_FALSE;
 }
 
 SUBOOL
 suscan_inspsched_sync(suscan_inspsched_t *sched)
 {
+  struct suscan_inspsched_queue *queue;
   unsigned int i;
 
+  if (suscan_inspsched_is_pipelined(sched)) {
+    /* Release the source reference. Workers will release the rest. */
+    if (sched->curr_window != NULL) {
+      suscan_inspsched_release_window(sched, sched->curr_window);
+      sched->curr_window = NULL;
+    }
+
+    goto done;
+  }
+
   /* Queue barriers */
   for (i = 0; i < sched->worker_count; ++i)
     SU_TRYCATCH(
@@ -238,9 +755,20 @@ suscan_inspsched_sync(suscan_inspsched_t *sched)
   /* Wait for all threads */
   pthread_barrier_wait(&sched->barrier);
 
+done:
   /* Reset date */
   sched->have_time = SU_FALSE;
 
+  /* Close the load window */
+  if (sched->queue_list != NULL)
+    for (i = 0; i < sched->worker_count; ++i) {
+      queue = sched->queue_list + i;
+      suscan_inspsched_store_cost(
+          &queue->last_load,
+          suscan_inspsched_load_cost(&queue->window_load));
+      suscan_inspsched_store_cost(&queue->window_load, 0);
+    }
+
   return SU_TRUE;
 }
 
@@ -263,6 +791,14 @@ suscan_inspsched_destroy(suscan_inspsched_t *self)
   if (self->worker_list != NULL)
     free(self->worker_list);
 
+  if (self->queue_list != NULL) {
+    for (i = 0; i < self->worker_count; ++i)
+      if (self->queue_list[i].mutex_init)
+        pthread_mutex_destroy(&self->queue_list[i].mutex);
+
+    free(self->queue_list);
+  }
+
   /*
    * All workers halted, source worker must be finished by now
    * it is safe to go on with the object destruction. We basically
@@ -284,6 +820,14 @@ suscan_inspsched_destroy(suscan_inspsched_t *self)
   if (self->barrier_init)
     pthread_barrier_destroy(&self->barrier);
 
+  if (self->window_init) {
+    pthread_mutex_destroy(&self->window_mutex);
+    pthread_cond_destroy(&self->window_cond);
+  }
+
+  if (self->window_list != NULL)
+    free(self->window_list);
+
   free(self);
 
   return SU_TRUE;
@@ -291,7 +835,10 @@ suscan_inspsched_destroy(suscan_inspsched_t *self)
 
 
 suscan_inspsched_t *
-suscan_inspsched_new(struct suscan_mq *ctl_mq)
+suscan_inspsched_new_ex(
+    struct suscan_mq *ctl_mq,
+    enum suscan_inspsched_policy policy,
+    unsigned int pipeline_depth)
 {
   suscan_inspsched_t *new = NULL;
   suscan_worker_t *worker = NULL;
@@ -301,7 +848,9 @@ suscan_inspsched_new(struct suscan_mq *ctl_mq)
   SU_TRYCATCH(new = calloc(1, sizeof(suscan_inspsched_t)), goto fail);
 
   new->ctl_mq = ctl_mq;
-  
+  new->policy = policy;
+  new->pipeline_depth = pipeline_depth;
+
   count = suscan_inspsched_get_min_workers();
 
   for (i = 0; i < count; ++i) {
@@ -322,6 +871,38 @@ suscan_inspsched_new(struct suscan_mq *ctl_mq)
     goto fail);
   new->barrier_init = SU_TRUE;
 
+  if (policy == SUSCAN_INSPSCHED_POLICY_WORK_STEALING) {
+    SU_TRYCATCH(
+      new->queue_list = calloc(
+        new->worker_count,
+        sizeof(struct suscan_inspsched_queue)),
+      goto fail);
+
+    for (i = 0; i < new->worker_count; ++i) {
+      new->queue_list[i].index = i;
+      SU_TRYCATCH(
+        pthread_mutex_init(&new->queue_list[i].mutex, NULL) == 0,
+        goto fail);
+      new->queue_list[i].mutex_init = SU_TRUE;
+    }
+  }
+
+  if (pipeline_depth > 0) {
+    SU_TRYCATCH(
+      new->window_list = calloc(
+        pipeline_depth,
+        sizeof(struct suscan_inspsched_window)),
+      goto fail);
+
+    SU_TRYCATCH(pthread_mutex_init(&new->window_mutex, NULL) == 0, goto fail);
+    if (pthread_cond_init(&new->window_cond, NULL) != 0) {
+      pthread_mutex_destroy(&new->window_mutex);
+      SU_ERROR("Failed to initialize window condition variable\n");
+      goto fail;
+    }
+    new->window_init = SU_TRUE;
+  }
+
   return new;
 
 fail:
@@ -337,3 +918,12 @@ fail:
 
   return NULL;
 }
+
+suscan_inspsched_t *
+suscan_inspsched_new(struct suscan_mq *ctl_mq)
+{
+  return suscan_inspsched_new_ex(
+      ctl_mq,
+      SUSCAN_INSPSCHED_POLICY_ROUND_ROBIN,
+      0);
+}
@@ -29,10 +29,33 @@
 #include "worker.h"
 #include "list.h"
 
+/* Smoothing factor of the measured per-inspector processing cost */
+#define SUSCAN_INSPSCHED_COST_ALPHA       .125
+
+/*
+ * An inspector is only migrated if the load of its worker exceeds that of
+ * the least loaded worker by this factor of its own cost.
+ */
+#define SUSCAN_INSPSCHED_MIGRATION_FACTOR 2
+
 struct suscan_inspector;
 struct suscan_inspsched;
+struct suscan_inspsched_queue;
+struct suscan_inspsched_window;
 struct suscan_inspector_factory;
 
+/*!
+ * \brief Inspector scheduling policy
+ *
+ * Describes how inspector tasks are distributed among the inspector
+ * scheduler workers.
+ * \author Gonzalo José Carracedo Carballal
+ */
+enum suscan_inspsched_policy {
+  SUSCAN_INSPSCHED_POLICY_ROUND_ROBIN,  /*!< Rotatory dispatch (default) */
+  SUSCAN_INSPSCHED_POLICY_WORK_STEALING /*!< Per-worker queues with stealing */
+};
+
 /* TODO: Turn this into an object pool */
 struct suscan_inspector_task_info {
   LINKED_LIST;
@@ -41,12 +64,65 @@ struct suscan_inspector_task_info {
   struct suscan_inspector *inspector;
   const SUCOMPLEX *data;
   SUSCOUNT size;
+
+  /* Work queue links (work-stealing policy only) */
+  struct suscan_inspector_task_info *wq_next;
+  struct suscan_inspector_task_info *wq_prev;
+  struct suscan_inspsched_queue     *queue; /* Queue it was taken from */
+
+  /* Private copy of the channel data (pipelined mode only) */
+  struct suscan_inspsched_window *window;
+  SUCOMPLEX *buffer;
+  SUSCOUNT   buffer_alloc;
+};
+
+/*
+ * Per-worker task queue. Workers take the oldest runnable task of their
+ * own queue, or steal it from other queues when theirs is empty. A task
+ * is runnable if no other task of the same inspector is being processed.
+ */
+struct suscan_inspsched_queue {
+  unsigned int    index;
+  pthread_mutex_t mutex;
+  SUBOOL          mutex_init;
+
+  struct suscan_inspector_task_info *head;
+  struct suscan_inspector_task_info *tail;
+  unsigned int size;
+  SUBOOL       running;
+
+  /* Placement information (estimated processing cost, in ns) */
+  SUFLOAT window_load; /* Cost of the tasks queued in this window */
+  SUFLOAT last_load;   /* Cost of the tasks queued in the previous window */
+
+  /* Statistics */
+  uint64_t tasks;
+  uint64_t stolen;
+  uint64_t samples;
+  uint64_t busy_ns;
+};
+
+struct suscan_inspsched_worker_stats {
+  uint64_t tasks;   /* Tasks executed by this worker */
+  uint64_t stolen;  /* Tasks stolen from other workers */
+  uint64_t samples; /* Samples processed */
+  uint64_t busy_ns; /* Time spent processing tasks */
+};
+
+/*
+ * In pipelined mode, every spectral tuner window is backed by one of
+ * these. Its reference counter is held by the source while the window
+ * is being filled, and by every task that was queued from it.
+ */
+struct suscan_inspsched_window {
+  unsigned int refcnt;
 };
 
 struct suscan_local_analyzer;
 
 struct suscan_inspsched {
   struct suscan_mq *ctl_mq;
+  enum suscan_inspsched_policy policy;
 
   SUBOOL have_time;
 
@@ -60,6 +136,19 @@ struct suscan_inspsched {
   unsigned int last_worker; /* Used as rotatory index */
   pthread_barrier_t  barrier; /* Inspector barrier */
   SUBOOL barrier_init;
+
+  /* Work-stealing state (one queue per worker) */
+  struct suscan_inspsched_queue *queue_list;
+  unsigned int pending; /* Queued tasks not yet taken by any worker */
+
+  /* Pipelined mode: no barrier between windows */
+  unsigned int pipeline_depth; /* 0 means synchronous mode */
+  struct suscan_inspsched_window *window_list;
+  struct suscan_inspsched_window *curr_window;
+  pthread_mutex_t window_mutex;
+  pthread_cond_t  window_cond;
+  SUBOOL          window_init;
+  uint64_t        backpressure_count; /* Waits for a free window */
 };
 
 typedef struct suscan_inspsched suscan_inspsched_t;
@@ -70,6 +159,24 @@ suscan_inspsched_get_num_workers(const suscan_inspsched_t *sched)
   return sched->worker_count;
 }
 
+SUINLINE enum suscan_inspsched_policy
+suscan_inspsched_get_policy(const suscan_inspsched_t *sched)
+{
+  return sched->policy;
+}
+
+SUINLINE SUBOOL
+suscan_inspsched_is_pipelined(const suscan_inspsched_t *sched)
+{
+  return sched->pipeline_depth > 0;
+}
+
+SUINLINE uint64_t
+suscan_inspsched_get_backpressure_count(const suscan_inspsched_t *sched)
+{
+  return sched->backpressure_count;
+}
+
 struct suscan_inspector_task_info *suscan_inspsched_acquire_task_info(
   suscan_inspsched_t *self,
   struct suscan_inspector *insp);
@@ -82,12 +189,32 @@ SUBOOL suscan_inspsched_queue_task(
     suscan_inspsched_t *sched,
     struct suscan_inspector_task_info *task_info);
 
+/*
+ * Mark the end of a spectral tuner window. In synchronous mode, this waits
+ * for all inspectors to consume the window. In pipelined mode, the window
+ * is released and processed asynchronously.
+ */
 SUBOOL suscan_inspsched_sync(suscan_inspsched_t *sched);
 
+/*
+ * Retrieve the processing statistics of a given worker. Only available
+ * under the work-stealing policy.
+ */
+SUBOOL suscan_inspsched_get_worker_stats(
+    suscan_inspsched_t *sched,
+    unsigned int worker,
+    struct suscan_inspsched_worker_stats *stats);
+
 /*
  * ctl_mq: where worker messages go (i.e. halt messages)
  * insp_mq: where inspector result messages go (i.e. stuff forwarder to the user)
+ * pipeline_depth: number of windows in flight (0 for synchronous mode)
  */
+suscan_inspsched_t *suscan_inspsched_new_ex(
+    struct suscan_mq *ctl_mq,
+    enum suscan_inspsched_policy policy,
+    unsigned int pipeline_depth);
+
 suscan_inspsched_t *suscan_inspsched_new(struct suscan_mq *ctl_mq);
 
 SUBOOL suscan_inspsched_destroy(suscan_inspsched_t *sched);
@@ -23,6 +23,7 @@
 #include <ctype.h>
 #include <libgen.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
 
 #include "mq.h"
@@ -47,20 +48,141 @@ suscan_msg_pool_leave(void)
   (void) pthread_mutex_unlock(&g_msg_pool_mutex);
 }
 
-SUPRIVATE struct suscan_msg *
-suscan_mq_alloc_msg(void)
+/*
+ * Messages are usually allocated by one thread and released by another.
+ * In order to keep threads from fighting for the pool mutex, every
+ * thread keeps a small cache of free messages, and exchanges them with
+ * the global pool in batches.
+ */
+struct suscan_msg_cache {
+  struct suscan_msg *head;
+  unsigned int count;
+};
+
+SUPRIVATE pthread_once_t g_msg_cache_once = PTHREAD_ONCE_INIT;
+SUPRIVATE pthread_key_t  g_msg_cache_key;
+SUPRIVATE SUBOOL         g_msg_cache_key_init = SU_FALSE;
+
+SUPRIVATE void
+suscan_msg_cache_flush(struct suscan_msg_cache *cache, unsigned int keep)
 {
-  struct suscan_msg *msg = NULL;
+  struct suscan_msg *msg, *overflow = NULL;
+  int msg_pool_peak_copy = -1;
+
+  suscan_msg_pool_enter();
+
+  while (cache->count > keep) {
+    msg = cache->head;
+    cache->head = msg->free_next;
+    --cache->count;
+
+    if (g_msg_pool_size < SUSCAN_MQ_POOL_OVERFLOW_THRESHOLD) {
+      msg->free_next = g_msg_pool;
+      g_msg_pool = msg;
+
+      ++g_msg_pool_size;
+      if (g_msg_pool_size > g_msg_pool_peak) {
+        g_msg_pool_peak    = g_msg_pool_size;
+        msg_pool_peak_copy = g_msg_pool_peak;
+      }
+    } else {
+      msg->free_next = overflow;
+      overflow = msg;
+    }
+  }
+
+  suscan_msg_pool_leave();
+
+  /* Pool is full. Just free these messages. */
+  while (overflow != NULL) {
+    msg = overflow;
+    overflow = msg->free_next;
+    free(msg);
+  }
+
+  if (msg_pool_peak_copy > 0
+      && (msg_pool_peak_copy % SUSCAN_MQ_POOL_WARNING_THRESHOLD) == 0)
+    SU_WARNING(
+        "Message pool freelist grew to %d elements!\n",
+        msg_pool_peak_copy);
+}
+
+SUPRIVATE void
+suscan_msg_cache_refill(struct suscan_msg_cache *cache)
+{
+  struct suscan_msg *msg;
+
   suscan_msg_pool_enter();
 
-  if (g_msg_pool != NULL) {
+  while (g_msg_pool != NULL
+      && cache->count < SUSCAN_MQ_THREAD_CACHE_SIZE / 2) {
     msg = g_msg_pool;
     g_msg_pool = msg->free_next;
-
     --g_msg_pool_size;
+
+    msg->free_next = cache->head;
+    cache->head = msg;
+    ++cache->count;
   }
 
   suscan_msg_pool_leave();
+}
+
+SUPRIVATE void
+suscan_msg_cache_dtor(void *data)
+{
+  struct suscan_msg_cache *cache = (struct suscan_msg_cache *) data;
+
+  suscan_msg_cache_flush(cache, 0);
+
+  free(cache);
+}
+
+SUPRIVATE void
+suscan_msg_cache_init_key(void)
+{
+  g_msg_cache_key_init =
+    pthread_key_create(&g_msg_cache_key, suscan_msg_cache_dtor) == 0;
+}
+
+SUPRIVATE struct suscan_msg_cache *
+suscan_msg_cache_get(void)
+{
+  struct suscan_msg_cache *cache;
+
+  (void) pthread_once(&g_msg_cache_once, suscan_msg_cache_init_key);
+
+  if (!g_msg_cache_key_init)
+    return NULL;
+
+  if ((cache = pthread_getspecific(g_msg_cache_key)) == NULL) {
+    if ((cache = calloc(1, sizeof(struct suscan_msg_cache))) == NULL)
+      return NULL;
+
+    if (pthread_setspecific(g_msg_cache_key, cache) != 0) {
+      free(cache);
+      return NULL;
+    }
+  }
+
+  return cache;
+}
+
+SUPRIVATE struct suscan_msg *
+suscan_mq_alloc_msg(void)
+{
+  struct suscan_msg_cache *cache;
+  struct suscan_msg *msg = NULL;
+
+  if ((cache = suscan_msg_cache_get()) != NULL) {
+    if (cache->head == NULL)
+      suscan_msg_cache_refill(cache);
+
+    if ((msg = cache->head) != NULL) {
+      cache->head = msg->free_next;
+      --cache->count;
+    }
+  }
 
   /* Fallback to malloc. TODO: add a message limit here */
   if (msg == NULL)
@@ -72,34 +194,24 @@ suscan_mq_alloc_msg(void)
 SUPRIVATE void
 suscan_mq_return_msg(struct suscan_msg *msg)
 {
-  int msg_pool_peak_copy = -1;
-  SUBOOL in_pool = SU_FALSE;
-
-  suscan_msg_pool_enter();
-
-  if (g_msg_pool_size < SUSCAN_MQ_POOL_OVERFLOW_THRESHOLD) {
-    msg->free_next = g_msg_pool;
-    g_msg_pool = msg;
+  struct suscan_msg_cache *cache;
+  struct suscan_msg_cache tmp;
 
-    ++g_msg_pool_size;
-    if (g_msg_pool_size > g_msg_pool_peak) {
-      g_msg_pool_peak    = g_msg_pool_size;
-      msg_pool_peak_copy = g_msg_pool_peak;
-    }
+  if ((cache = suscan_msg_cache_get()) == NULL) {
+    /* No thread cache available. Return it directly to the pool. */
+    msg->free_next = NULL;
+    tmp.head  = msg;
+    tmp.count = 1;
 
-    in_pool = SU_TRUE;
+    suscan_msg_cache_flush(&tmp, 0);
+    return;
   }
 
-  suscan_msg_pool_leave();
+  msg->free_next = cache->head;
+  cache->head = msg;
 
-  if (!in_pool) {
-    /* Pool is full. Just free the message. */
-    free(msg);
-  } else if ((msg_pool_peak_copy % SUSCAN_MQ_POOL_WARNING_THRESHOLD) == 0) {
-    SU_WARNING(
-        "Message pool freelist grew to %d elements!\n",
-        msg_pool_peak_copy);
-  }
+  if (++cache->count > SUSCAN_MQ_THREAD_CACHE_SIZE)
+    suscan_msg_cache_flush(cache, SUSCAN_MQ_THREAD_CACHE_SIZE / 2);
 }
 
 #else
@@ -151,12 +263,21 @@ suscan_mq_timedwait_unsafe(
       ts) == 0;
 }
 
+SUPRIVATE SUBOOL suscan_mq_lf_wait_unsafe(
+    struct suscan_mq *mq,
+    const struct timespec *ts);
+
 void
 suscan_mq_wait(struct suscan_mq *mq)
 {
   suscan_mq_enter(mq);
 
-  suscan_mq_wait_unsafe(mq);
+  if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE) {
+    if (mq->head == NULL)
+      (void) suscan_mq_lf_wait_unsafe(mq, NULL);
+  } else {
+    suscan_mq_wait_unsafe(mq);
+  }
 
   suscan_mq_leave(mq);
 }
@@ -164,11 +285,16 @@ suscan_mq_wait(struct suscan_mq *mq)
 SUBOOL
 suscan_mq_timedwait(struct suscan_mq *mq, const struct timespec *ts)
 {
-  SUBOOL result;
+  SUBOOL result = SU_TRUE;
 
   suscan_mq_enter(mq);
 
-  result = suscan_mq_timedwait_unsafe(mq, ts);
+  if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE) {
+    if (mq->head == NULL)
+      result = suscan_mq_lf_wait_unsafe(mq, ts);
+  } else {
+    result = suscan_mq_timedwait_unsafe(mq, ts);
+  }
 
   suscan_mq_leave(mq);
 
@@ -285,7 +411,7 @@ suscan_mq_push_front(struct suscan_mq *mq, struct suscan_msg *msg)
 }
 
 SUPRIVATE void
-suscan_mq_push(struct suscan_mq *mq, struct suscan_msg *msg)
+suscan_mq_append(struct suscan_mq *mq, struct suscan_msg *msg)
 {
   if (mq->tail != NULL)
     mq->tail->next = msg;
@@ -296,6 +422,12 @@ suscan_mq_push(struct suscan_mq *mq, struct suscan_msg *msg)
     mq->head = msg;
 
   ++mq->count;
+}
+
+SUPRIVATE void
+suscan_mq_push(struct suscan_mq *mq, struct suscan_msg *msg)
+{
+  suscan_mq_append(mq, msg);
   suscan_mq_cleanup_if_needed(mq);
 }
 
@@ -352,6 +484,172 @@ suscan_mq_pop_w_type(struct suscan_mq *mq, uint32_t type)
   return this;
 }
 
+/*************************** Lock-free backend ******************************/
+/*
+ * This is an intrusive multiple-producer, single-consumer list (the
+ * consumer being whoever holds acquire_lock). Writers never take a lock:
+ * they just exchange the list head and link the previous one to the
+ * new message.
+ */
+SUPRIVATE void
+suscan_mq_lf_push(struct suscan_mq *mq, struct suscan_msg *msg)
+{
+  struct suscan_msg *prev;
+
+  __atomic_store_n(&msg->next, NULL, __ATOMIC_RELAXED);
+  prev = __atomic_exchange_n(&mq->lf_head, msg, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&prev->next, msg, __ATOMIC_RELEASE);
+}
+
+/* Whether messages were pushed, even if they are not completely linked */
+SUPRIVATE SUBOOL
+suscan_mq_lf_pending_unsafe(struct suscan_mq *mq)
+{
+  return mq->lf_tail != &mq->lf_stub
+    || __atomic_load_n(&mq->lf_head, __ATOMIC_SEQ_CST) != &mq->lf_stub;
+}
+
+SUPRIVATE struct suscan_msg *
+suscan_mq_lf_pop_unsafe(struct suscan_mq *mq)
+{
+  struct suscan_msg *tail = mq->lf_tail;
+  struct suscan_msg *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+  if (tail == &mq->lf_stub) {
+    if (next == NULL)
+      return NULL;
+
+    mq->lf_tail = next;
+    tail = next;
+    next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+  }
+
+  if (next == NULL) {
+    /* A writer is in the middle of a push */
+    if (tail != __atomic_load_n(&mq->lf_head, __ATOMIC_SEQ_CST))
+      return NULL;
+
+    /* This is the last message. Put the stub behind it. */
+    suscan_mq_lf_push(mq, &mq->lf_stub);
+
+    if ((next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE)) == NULL)
+      return NULL;
+  }
+
+  mq->lf_tail = next;
+  tail->next = NULL;
+
+  (void) __atomic_sub_fetch(&mq->lf_count, 1, __ATOMIC_RELAXED);
+
+  return tail;
+}
+
+/* Move all linked messages to the locked list, keeping their order */
+SUPRIVATE void
+suscan_mq_lf_drain_unsafe(struct suscan_mq *mq)
+{
+  struct suscan_msg *msg;
+
+  while ((msg = suscan_mq_lf_pop_unsafe(mq)) != NULL)
+    suscan_mq_append(mq, msg);
+}
+
+SUPRIVATE struct suscan_msg *
+suscan_mq_lf_take_unsafe(struct suscan_mq *mq, SUBOOL with_type, uint32_t type)
+{
+  struct suscan_msg *msg;
+
+  /* Messages in the locked list are always older (or urgent) */
+  if (with_type) {
+    suscan_mq_lf_drain_unsafe(mq);
+    msg = suscan_mq_pop_w_type(mq, type);
+  } else if ((msg = suscan_mq_pop(mq)) == NULL) {
+    msg = suscan_mq_lf_pop_unsafe(mq);
+  }
+
+  return msg;
+}
+
+/*
+ * Sleep until something is written to the queue. Writers only notify the
+ * queue if there are readers waiting, so we must announce ourselves before
+ * checking whether the queue is empty.
+ */
+SUPRIVATE SUBOOL
+suscan_mq_lf_wait_unsafe(struct suscan_mq *mq, const struct timespec *ts)
+{
+  SUBOOL ok = SU_TRUE;
+
+  (void) __atomic_add_fetch(&mq->lf_waiters, 1, __ATOMIC_SEQ_CST);
+
+  if (!suscan_mq_lf_pending_unsafe(mq)) {
+    if (ts == NULL)
+      pthread_cond_wait(&mq->acquire_cond, &mq->acquire_lock);
+    else
+      ok = pthread_cond_timedwait(
+        &mq->acquire_cond,
+        &mq->acquire_lock,
+        ts) == 0;
+  } else {
+    /* Message not completely linked yet. Give the writer some time. */
+    suscan_mq_leave(mq);
+    sched_yield();
+    suscan_mq_enter(mq);
+  }
+
+  (void) __atomic_sub_fetch(&mq->lf_waiters, 1, __ATOMIC_SEQ_CST);
+
+  return ok;
+}
+
+/* Push a list of already linked messages with a single exchange */
+SUPRIVATE void
+suscan_mq_lf_push_chain(
+    struct suscan_mq *mq,
+    struct suscan_msg *first,
+    struct suscan_msg *last)
+{
+  struct suscan_msg *prev;
+
+  __atomic_store_n(&last->next, NULL, __ATOMIC_RELAXED);
+  prev = __atomic_exchange_n(&mq->lf_head, last, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&prev->next, first, __ATOMIC_RELEASE);
+}
+
+SUPRIVATE void
+suscan_mq_lf_write_chain(
+    struct suscan_mq *mq,
+    struct suscan_msg *first,
+    struct suscan_msg *last,
+    unsigned int len)
+{
+  unsigned int count;
+
+  suscan_mq_lf_push_chain(mq, first, last);
+  count = __atomic_add_fetch(&mq->lf_count, len, __ATOMIC_RELAXED);
+
+  if (mq->cleanup_watermark > 0
+    && count + __atomic_load_n(&mq->count, __ATOMIC_RELAXED)
+      >= mq->cleanup_watermark) {
+    suscan_mq_enter(mq);
+    suscan_mq_lf_drain_unsafe(mq);
+    suscan_mq_cleanup_if_needed(mq);
+    suscan_mq_leave(mq);
+  }
+
+  if (__atomic_load_n(&mq->lf_waiters, __ATOMIC_SEQ_CST) > 0) {
+    suscan_mq_enter(mq);
+    suscan_mq_notify(mq);
+    suscan_mq_leave(mq);
+  }
+}
+
+SUPRIVATE void
+suscan_mq_lf_write(struct suscan_mq *mq, struct suscan_msg *msg)
+{
+  suscan_mq_lf_write_chain(mq, msg, msg, 1);
+}
+
 SUPRIVATE struct suscan_msg *
 suscan_mq_read_msg_internal(
     struct suscan_mq *mq,
@@ -378,7 +676,11 @@ suscan_mq_read_msg_internal(
      */
     suscan_mq_enter(mq);
 
-    if (with_type) {
+    if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE) {
+      while ((msg = suscan_mq_lf_take_unsafe(mq, with_type, type)) == NULL)
+        if (!suscan_mq_lf_wait_unsafe(mq, &ts))
+          break;
+    } else if (with_type) {
       while ((msg = suscan_mq_pop_w_type(mq, type)) == NULL)
         if (!suscan_mq_timedwait_unsafe(mq, &ts)) {
           msg = NULL;
@@ -396,7 +698,10 @@ suscan_mq_read_msg_internal(
   } else {
     suscan_mq_enter(mq);
 
-    if (with_type)
+    if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE)
+      while ((msg = suscan_mq_lf_take_unsafe(mq, with_type, type)) == NULL)
+        (void) suscan_mq_lf_wait_unsafe(mq, NULL);
+    else if (with_type)
       while ((msg = suscan_mq_pop_w_type(mq, type)) == NULL)
         suscan_mq_wait_unsafe(mq);
     else
@@ -409,6 +714,68 @@ suscan_mq_read_msg_internal(
   return msg;
 }
 
+SUPRIVATE unsigned int
+suscan_mq_pop_batch_unsafe(
+    struct suscan_mq *mq,
+    struct suscan_msg **msgs,
+    unsigned int max)
+{
+  unsigned int count = 0;
+
+  while (count < max && (msgs[count] = suscan_mq_pop(mq)) != NULL)
+    ++count;
+
+  if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE)
+    while (count < max
+      && (msgs[count] = suscan_mq_lf_pop_unsafe(mq)) != NULL)
+      ++count;
+
+  return count;
+}
+
+unsigned int
+suscan_mq_read_batch(
+    struct suscan_mq *mq,
+    struct suscan_msg **msgs,
+    unsigned int max,
+    const struct timeval *timeout)
+{
+  unsigned int count = 0;
+  struct timespec ts;
+  struct timeval now;
+  struct timeval future;
+
+  if (max == 0)
+    return 0;
+
+  if (timeout != NULL) {
+    gettimeofday(&now, NULL);
+
+    timeradd(&now, timeout, &future);
+
+    ts.tv_sec  = future.tv_sec;
+    ts.tv_nsec = future.tv_usec * 1000;
+  }
+
+  suscan_mq_enter(mq);
+
+  while ((count = suscan_mq_pop_batch_unsafe(mq, msgs, max)) == 0) {
+    if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE) {
+      if (!suscan_mq_lf_wait_unsafe(mq, timeout != NULL ? &ts : NULL))
+        break;
+    } else if (timeout != NULL) {
+      if (!suscan_mq_timedwait_unsafe(mq, &ts))
+        break;
+    } else {
+      suscan_mq_wait_unsafe(mq);
+    }
+  }
+
+  suscan_mq_leave(mq);
+
+  return count;
+}
+
 SUPRIVATE void *
 suscan_mq_read_internal(
     struct suscan_mq *mq,
@@ -501,7 +868,9 @@ suscan_mq_poll_msg_internal(struct suscan_mq *mq, SUBOOL with_type, uint32_t typ
 
   suscan_mq_enter(mq);
 
-  if (with_type)
+  if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE)
+    msg = suscan_mq_lf_take_unsafe(mq, with_type, type);
+  else if (with_type)
     msg = suscan_mq_pop_w_type(mq, type);
   else
     msg = suscan_mq_pop(mq);
@@ -563,6 +932,11 @@ suscan_mq_poll_msg_w_type(struct suscan_mq *mq, uint32_t type)
 void
 suscan_mq_write_msg(struct suscan_mq *mq, struct suscan_msg *msg)
 {
+  if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE) {
+    suscan_mq_lf_write(mq, msg);
+    return;
+  }
+
   suscan_mq_enter(mq);
 
   suscan_mq_push(mq, msg);
@@ -572,6 +946,50 @@ suscan_mq_write_msg(struct suscan_mq *mq, struct suscan_msg *msg)
   suscan_mq_leave(mq);
 }
 
+SUPRIVATE void
+suscan_mq_write_chain(
+    struct suscan_mq *mq,
+    struct suscan_msg *first,
+    struct suscan_msg *last,
+    unsigned int count)
+{
+  struct suscan_msg *msg, *next;
+
+  if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE) {
+    suscan_mq_lf_write_chain(mq, first, last, count);
+    return;
+  }
+
+  suscan_mq_enter(mq);
+
+  for (msg = first; count-- > 0; msg = next) {
+    next = msg->next;
+    msg->next = NULL;
+    suscan_mq_push(mq, msg);
+  }
+
+  suscan_mq_notify(mq);
+
+  suscan_mq_leave(mq);
+}
+
+void
+suscan_mq_write_msg_batch(
+    struct suscan_mq *mq,
+    struct suscan_msg **msgs,
+    unsigned int count)
+{
+  unsigned int i;
+
+  if (count == 0)
+    return;
+
+  for (i = 1; i < count; ++i)
+    msgs[i - 1]->next = msgs[i];
+
+  suscan_mq_write_chain(mq, msgs[0], msgs[count - 1], count);
+}
+
 void
 suscan_mq_write_msg_urgent(struct suscan_mq *mq, struct suscan_msg *msg)
 {
@@ -597,6 +1015,46 @@ suscan_mq_write(struct suscan_mq *mq, uint32_t type, void *private)
   return SU_TRUE;
 }
 
+SUBOOL
+suscan_mq_write_batch(
+    struct suscan_mq *mq,
+    const uint32_t *types,
+    void *const *privdata,
+    unsigned int count)
+{
+  struct suscan_msg *first = NULL, *last = NULL, *msg;
+  unsigned int i;
+
+  if (count == 0)
+    return SU_TRUE;
+
+  /* Allocate everything first, so that either all or none are queued */
+  for (i = 0; i < count; ++i) {
+    if ((msg = suscan_msg_new(types[i], privdata[i])) == NULL)
+      goto fail;
+
+    if (last != NULL)
+      last->next = msg;
+    else
+      first = msg;
+
+    last = msg;
+  }
+
+  suscan_mq_write_chain(mq, first, last, count);
+
+  return SU_TRUE;
+
+fail:
+  while (first != NULL) {
+    msg = first;
+    first = msg->next;
+    suscan_msg_destroy(msg);
+  }
+
+  return SU_FALSE;
+}
+
 void
 suscan_mq_write_msg_urgent_unsafe(struct suscan_mq *mq, struct suscan_msg *msg)
 {
@@ -656,18 +1114,25 @@ suscan_mq_finalize(struct suscan_mq *mq)
   if (pthread_cond_destroy(&mq->acquire_cond) == 0) {
     pthread_mutex_destroy(&mq->acquire_lock);
 
+    if (mq->backend == SUSCAN_MQ_BACKEND_LOCKFREE)
+      suscan_mq_lf_drain_unsafe(mq);
+
     while ((msg = suscan_mq_pop(mq)) != NULL)
       suscan_msg_destroy(msg);
   }
 }
 
 SUBOOL
-suscan_mq_init(struct suscan_mq *mq)
+suscan_mq_init_ex(struct suscan_mq *mq, enum suscan_mq_backend backend)
 {
   SUBOOL ok = SU_FALSE;
   SUBOOL mutex_init = SU_FALSE;
 
   memset(mq, 0, sizeof(struct suscan_mq));
+
+  mq->backend = backend;
+  mq->lf_head = &mq->lf_stub;
+  mq->lf_tail = &mq->lf_stub;
   
   SU_TRYZ(pthread_mutex_init(&mq->acquire_lock, NULL));
   mutex_init = SU_TRUE;
@@ -683,3 +1148,8 @@ done:
   return ok;
 }
 
+SUBOOL
+suscan_mq_init(struct suscan_mq *mq)
+{
+  return suscan_mq_init_ex(mq, SUSCAN_MQ_BACKEND_LOCKED);
+}
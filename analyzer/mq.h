@@ -33,6 +33,9 @@ extern "C" {
 #define SUSCAN_MQ_POOL_WARNING_THRESHOLD  100
 #define SUSCAN_MQ_POOL_OVERFLOW_THRESHOLD 300
 
+/* Free messages kept by every thread before returning them to the pool */
+#define SUSCAN_MQ_THREAD_CACHE_SIZE       64
+
 struct suscan_msg {
   uint32_t type;
   void *privdata;
@@ -45,6 +48,18 @@ struct suscan_msg {
 
 struct suscan_mq;
 
+/*
+ * Message queue backends. The locked backend protects the whole queue with
+ * a mutex. The lock-free backend lets writers enqueue messages without
+ * taking any lock (readers are still serialized by the queue mutex, which
+ * is uncontended if there is only one reader) and only wakes up readers
+ * if they are actually waiting for messages.
+ */
+enum suscan_mq_backend {
+  SUSCAN_MQ_BACKEND_LOCKED,
+  SUSCAN_MQ_BACKEND_LOCKFREE
+};
+
 struct suscan_mq_callbacks {
   void    *userdata;
   void  *(*pre_cleanup)  (struct suscan_mq *, void *);
@@ -61,6 +76,7 @@ struct suscan_mq_callbacks {
 }
 
 struct suscan_mq {
+  enum suscan_mq_backend backend;
   pthread_mutex_t acquire_lock;
   pthread_cond_t  acquire_cond;
 
@@ -69,10 +85,22 @@ struct suscan_mq {
   unsigned int count;
   unsigned int cleanup_watermark;
   struct suscan_mq_callbacks callbacks;
+
+  /*
+   * Lock-free backend: intrusive MPSC list. Writers append to lf_head,
+   * the reader owning acquire_lock pops from lf_tail. Urgent messages and
+   * messages skipped by typed reads are kept in the list above.
+   */
+  struct suscan_msg *lf_head;
+  struct suscan_msg *lf_tail;
+  struct suscan_msg  lf_stub;
+  unsigned int       lf_count;
+  unsigned int       lf_waiters;
 };
 
 /*************************** Message queue API *******************************/
 SUBOOL suscan_mq_init(struct suscan_mq *mq);
+SUBOOL suscan_mq_init_ex(struct suscan_mq *mq, enum suscan_mq_backend backend);
 void   suscan_mq_set_cleanup_watermark(struct suscan_mq *mq, unsigned int);
 void   suscan_mq_set_callbacks(
   struct suscan_mq *mq,
@@ -103,6 +131,17 @@ struct suscan_msg *suscan_mq_read_msg_w_type_timeout(
     uint32_t type,
     const struct timeval *timeout);
 
+/*
+ * Read up to max messages in a single critical section. Blocks until at
+ * least one message is available or the timeout (if not NULL) expires.
+ * Returns the number of messages read.
+ */
+unsigned int suscan_mq_read_batch(
+    struct suscan_mq *mq,
+    struct suscan_msg **msgs,
+    unsigned int max,
+    const struct timeval *timeout);
+
 SUBOOL suscan_mq_poll(struct suscan_mq *mq, uint32_t *type, void **privdata);
 SUBOOL suscan_mq_poll_w_type(struct suscan_mq *mq, uint32_t type, void **privdata);
 struct suscan_msg *suscan_mq_poll_msg(struct suscan_mq *mq);
@@ -112,6 +151,21 @@ void   suscan_mq_wait(struct suscan_mq *mq);
 SUBOOL suscan_mq_write_urgent(struct suscan_mq *mq, uint32_t type, void *privdata);
 SUBOOL suscan_mq_write_urgent_unsafe(struct suscan_mq *mq, uint32_t type, void *privdata);
 void suscan_mq_write_msg(struct suscan_mq *mq, struct suscan_msg *msg);
+
+/*
+ * Queue several messages in a single critical section. Either all of
+ * them are queued or none.
+ */
+SUBOOL suscan_mq_write_batch(
+    struct suscan_mq *mq,
+    const uint32_t *types,
+    void *const *privdata,
+    unsigned int count);
+void suscan_mq_write_msg_batch(
+    struct suscan_mq *mq,
+    struct suscan_msg **msgs,
+    unsigned int count);
+
 void suscan_mq_write_msg_urgent(struct suscan_mq *mq, struct suscan_msg *msg);
 void suscan_msg_destroy(struct suscan_msg *msg);
 
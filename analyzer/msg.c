@@ -27,6 +27,7 @@
 
 #define SU_LOG_DOMAIN "msg"
 
+#include "bufpool.h"
 #include "mq.h"
 #include "msg.h"
 #include "source.h"
@@ -172,8 +173,18 @@ suscan_analyzer_psd_msg_take_psd(struct suscan_analyzer_psd_msg *msg)
 {
   SUFLOAT *result = msg->psd_data;
 
+  /* The caller expects a malloc'd buffer, so pool buffers must be copied */
+  if (msg->pooled && result != NULL) {
+    if ((result = malloc(msg->psd_size * sizeof(SUFLOAT))) == NULL)
+      return NULL;
+
+    memcpy(result, msg->psd_data, msg->psd_size * sizeof(SUFLOAT));
+    suscan_bufpool_return(msg->psd_data);
+  }
+
   msg->psd_data = NULL;
   msg->psd_size = 0;
+  msg->pooled   = SU_FALSE;
 
   return result;
 }
@@ -249,8 +260,12 @@ SUSCAN_DESERIALIZER_PROTO(suscan_analyzer_psd_msg)
 void
 suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg)
 {
-  if (msg->psd_data != NULL)
-    free(msg->psd_data);
+  if (msg->psd_data != NULL) {
+    if (msg->pooled)
+      suscan_bufpool_return(msg->psd_data);
+    else
+      free(msg->psd_data);
+  }
 
   free(msg);
 }
@@ -273,8 +288,9 @@ suscan_analyzer_psd_msg_new_from_data(
   new->fc = 0;
 
   SU_TRYCATCH(
-      new->psd_data = malloc(sizeof(SUFLOAT) * new->psd_size),
+      new->psd_data = suscan_bufpool_alloc(sizeof(SUFLOAT) * new->psd_size),
       goto fail);
+  new->pooled = SU_TRUE;
 
   memcpy(new->psd_data, psd_data, psd_size * sizeof(SUFLOAT));
 
@@ -309,8 +325,9 @@ suscan_analyzer_psd_msg_new(const su_channel_detector_t *cd)
     new->fc = 0;
 
     SU_TRYCATCH(
-        new->psd_data = malloc(sizeof(SUFLOAT) * new->psd_size),
+        new->psd_data = suscan_bufpool_alloc(sizeof(SUFLOAT) * new->psd_size),
         goto fail);
+    new->pooled = SU_TRUE;
 
     switch (cd->params.mode) {
       case SU_CHANNEL_DETECTOR_MODE_AUTOCORRELATION:
@@ -664,6 +681,40 @@ suscan_analyzer_inspector_msg_deserialize_set_watermark(
   SUSCAN_UNPACK_BOILERPLATE_END;
 }
 
+SUPRIVATE SUBOOL
+suscan_analyzer_inspector_msg_serialize_gate(
+    grow_buf_t *buffer,
+    const struct suscan_analyzer_inspector_msg *self)
+{
+  SUSCAN_PACK_BOILERPLATE_START;
+
+  SUSCAN_PACK(float, self->gate_threshold);
+  SUSCAN_PACK(uint,  self->gate_policy);
+  SUSCAN_PACK(bool,  self->gate_suspended);
+  SUSCAN_PACK(float, self->gate_power);
+  SUSCAN_PACK(uint,  self->gate_skipped);
+  SUSCAN_PACK(uint,  self->gate_saved_ns);
+
+  SUSCAN_PACK_BOILERPLATE_END;
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_inspector_msg_deserialize_gate(
+    grow_buf_t *buffer,
+    struct suscan_analyzer_inspector_msg *self)
+{
+  SUSCAN_UNPACK_BOILERPLATE_START;
+
+  SUSCAN_UNPACK(float,  self->gate_threshold);
+  SUSCAN_UNPACK(uint32, self->gate_policy);
+  SUSCAN_UNPACK(bool,   self->gate_suspended);
+  SUSCAN_UNPACK(float,  self->gate_power);
+  SUSCAN_UNPACK(uint64, self->gate_skipped);
+  SUSCAN_UNPACK(uint64, self->gate_saved_ns);
+
+  SUSCAN_UNPACK_BOILERPLATE_END;
+}
+
 SUPRIVATE SUBOOL
 suscan_analyzer_inspector_msg_serialize_set_tle(
     grow_buf_t *buffer,
@@ -825,6 +876,13 @@ SUSCAN_SERIALIZER_PROTO(suscan_analyzer_inspector_msg)
           goto fail);
       break;
 
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_GATE:
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_GATE_REPORT:
+      SU_TRYCATCH(
+          suscan_analyzer_inspector_msg_serialize_gate(buffer, self),
+          goto fail);
+      break;
+
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_TLE:
       SU_TRYCATCH(
           suscan_analyzer_inspector_msg_serialize_set_tle(buffer, self),
@@ -919,6 +977,13 @@ SUSCAN_DESERIALIZER_PROTO(suscan_analyzer_inspector_msg)
           goto fail);
       break;
 
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_GATE:
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_GATE_REPORT:
+      SU_TRYCATCH(
+          suscan_analyzer_inspector_msg_deserialize_gate(buffer, self),
+          goto fail);
+      break;
+
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_TLE:
       SU_TRYCATCH(
           suscan_analyzer_inspector_msg_deserialize_set_tle(buffer, self),
@@ -1064,9 +1129,8 @@ suscan_analyzer_sample_batch_msg_new(
       goto fail);
 
   if (samples != NULL && count > 0) {
-    SU_TRYCATCH(
-          new->samples = malloc(count * sizeof(SUCOMPLEX)),
-          goto fail);
+    SU_TRYCATCH(new->samples = suscan_buffer_alloc(count), goto fail);
+    new->pooled = SU_TRUE;
 
     memcpy(new->samples, samples, count * sizeof(SUCOMPLEX));
   }
@@ -1083,12 +1147,36 @@ fail:
   return NULL;
 }
 
+struct suscan_analyzer_sample_batch_msg *
+suscan_analyzer_sample_batch_msg_new_from_pool(
+    uint32_t inspector_id,
+    SUCOMPLEX *samples,
+    SUSCOUNT count)
+{
+  struct suscan_analyzer_sample_batch_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_sample_batch_msg)),
+      return NULL);
+
+  new->samples      = samples;
+  new->sample_count = count;
+  new->inspector_id = inspector_id;
+  new->pooled       = SU_TRUE;
+
+  return new;
+}
+
 void
 suscan_analyzer_sample_batch_msg_destroy(
     struct suscan_analyzer_sample_batch_msg *msg)
 {
-  if (msg->samples != NULL)
-    free(msg->samples);
+  if (msg->samples != NULL) {
+    if (msg->pooled)
+      suscan_buffer_return(msg->samples);
+    else
+      free(msg->samples);
+  }
 
   free(msg);
 }
@@ -1139,6 +1227,60 @@ SUSCAN_DESERIALIZER_PROTO(suscan_analyzer_seek_msg)
   SUSCAN_UNPACK_BOILERPLATE_END;
 }
 
+/************************** Sweep band message ********************************/
+SUSCAN_SERIALIZER_PROTO(suscan_analyzer_sweep_band_msg)
+{
+  SUSCAN_PACK_BOILERPLATE_START;
+
+  SUSCAN_PACK(freq,  self->min_freq);
+  SUSCAN_PACK(freq,  self->max_freq);
+  SUSCAN_PACK(float, self->revisit);
+
+  SUSCAN_PACK_BOILERPLATE_END;
+}
+
+SUSCAN_DESERIALIZER_PROTO(suscan_analyzer_sweep_band_msg)
+{
+  SUSCAN_UNPACK_BOILERPLATE_START;
+
+  SUSCAN_UNPACK(freq,  self->min_freq);
+  SUSCAN_UNPACK(freq,  self->max_freq);
+  SUSCAN_UNPACK(float, self->revisit);
+
+  SUSCAN_UNPACK_BOILERPLATE_END;
+}
+
+/************************** Sweep stats message *******************************/
+SUSCAN_SERIALIZER_PROTO(suscan_analyzer_sweep_stats_msg)
+{
+  SUSCAN_PACK_BOILERPLATE_START;
+
+  SUSCAN_PACK(uint,  self->strategy);
+  SUSCAN_PACK(uint,  self->partitions);
+  SUSCAN_PACK(uint,  self->visited);
+  SUSCAN_PACK(float, self->sweep_rate);
+  SUSCAN_PACK(float, self->mean_age);
+  SUSCAN_PACK(float, self->max_age);
+  SUSCAN_PACK(float, self->max_lateness);
+
+  SUSCAN_PACK_BOILERPLATE_END;
+}
+
+SUSCAN_DESERIALIZER_PROTO(suscan_analyzer_sweep_stats_msg)
+{
+  SUSCAN_UNPACK_BOILERPLATE_START;
+
+  SUSCAN_UNPACK(uint32, self->strategy);
+  SUSCAN_UNPACK(uint32, self->partitions);
+  SUSCAN_UNPACK(uint32, self->visited);
+  SUSCAN_UNPACK(float,  self->sweep_rate);
+  SUSCAN_UNPACK(float,  self->mean_age);
+  SUSCAN_UNPACK(float,  self->max_age);
+  SUSCAN_UNPACK(float,  self->max_lateness);
+
+  SUSCAN_UNPACK_BOILERPLATE_END;
+}
+
 /*********************** Generic message serialization ************************/
 SUBOOL
 suscan_analyzer_msg_serialize(
@@ -1160,6 +1302,7 @@ suscan_analyzer_msg_serialize(
     case SUSCAN_ANALYZER_MESSAGE_TYPE_READ_ERROR:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
       SU_TRYCATCH(
           suscan_analyzer_status_msg_serialize(ptr, buffer),
           goto fail);
@@ -1205,6 +1348,18 @@ suscan_analyzer_msg_serialize(
           goto fail);
       break;
 
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_BAND:
+      SU_TRYCATCH(
+          suscan_analyzer_sweep_band_msg_serialize(ptr, buffer),
+          goto fail);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_STATS:
+      SU_TRYCATCH(
+          suscan_analyzer_sweep_stats_msg_serialize(ptr, buffer),
+          goto fail);
+      break;
+
     case SUSCAN_ANALYZER_MESSAGE_TYPE_GET_PARAMS:
       break;
   }
@@ -1243,6 +1398,7 @@ suscan_analyzer_msg_deserialize(uint32_t *type, void **ptr, grow_buf_t *buffer)
     case SUSCAN_ANALYZER_MESSAGE_TYPE_READ_ERROR:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
       SU_TRYCATCH(
           msgptr = suscan_analyzer_status_msg_new(0, NULL),
           goto fail);
@@ -1309,6 +1465,24 @@ suscan_analyzer_msg_deserialize(uint32_t *type, void **ptr, grow_buf_t *buffer)
           goto fail);
       break;
 
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_BAND:
+      SU_TRYCATCH(
+          msgptr = calloc(1, sizeof (struct suscan_analyzer_sweep_band_msg)),
+          goto fail);
+      SU_TRYCATCH(
+          suscan_analyzer_sweep_band_msg_deserialize(msgptr, buffer),
+          goto fail);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_STATS:
+      SU_TRYCATCH(
+          msgptr = calloc(1, sizeof (struct suscan_analyzer_sweep_stats_msg)),
+          goto fail);
+      SU_TRYCATCH(
+          suscan_analyzer_sweep_stats_msg_deserialize(msgptr, buffer),
+          goto fail);
+      break;
+
     case SUSCAN_ANALYZER_MESSAGE_TYPE_GET_PARAMS:
       msgptr = "REMOTE";
       break;
@@ -1342,6 +1516,7 @@ suscan_analyzer_dispose_message(uint32_t type, void *ptr)
     case SUSCAN_ANALYZER_MESSAGE_TYPE_READ_ERROR:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
       suscan_analyzer_status_msg_destroy(ptr);
       break;
 
@@ -1363,6 +1538,8 @@ suscan_analyzer_dispose_message(uint32_t type, void *ptr)
 
     case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_THROTTLE:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_BAND:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_STATS:
       free(ptr);
       break;
   }
@@ -1497,6 +1674,25 @@ SUBOOL
 suscan_analyzer_send_psd(
     suscan_analyzer_t *self,
     const su_channel_detector_t *detector)
+{
+  struct timeval timestamp;
+
+  suscan_analyzer_get_source_time(self, &timestamp);
+
+  /* In wide spectrum mode, frequency is given by curr_freq */
+  return suscan_analyzer_send_psd_ex(
+      self,
+      detector,
+      suscan_analyzer_get_source_info(self)->frequency,
+      &timestamp);
+}
+
+SUBOOL
+suscan_analyzer_send_psd_ex(
+    suscan_analyzer_t *self,
+    const su_channel_detector_t *detector,
+    SUFREQ fc,
+    const struct timeval *timestamp)
 {
   struct suscan_analyzer_psd_msg *msg = NULL;
   SUBOOL ok = SU_FALSE;
@@ -1511,11 +1707,10 @@ suscan_analyzer_send_psd(
     goto done;
   }
 
-  /* In wide spectrum mode, frequency is given by curr_freq */
-  msg->fc = suscan_analyzer_get_source_info(self)->frequency;
+  msg->fc = fc;
   msg->samp_rate = suscan_analyzer_get_source_info(self)->source_samp_rate;
   msg->measured_samp_rate = suscan_analyzer_get_measured_samp_rate(self);
-  suscan_analyzer_get_source_time(self, &msg->timestamp);
+  msg->timestamp = *timestamp;
   msg->N0 = detector->N0;
 
   if (!suscan_mq_write(
@@ -1547,7 +1742,8 @@ SUBOOL
 suscan_analyzer_send_psd_from_smoothpsd(
     suscan_analyzer_t *self,
     const su_smoothpsd_t *smoothpsd,
-    SUBOOL looped)
+    SUBOOL looped,
+    const struct timeval *timestamp)
 {
   struct suscan_analyzer_psd_msg *msg = NULL;
   SUBOOL ok = SU_FALSE;
@@ -1568,7 +1764,10 @@ suscan_analyzer_send_psd_from_smoothpsd(
   /* In wide spectrum mode, frequency is given by curr_freq */
   msg->fc = suscan_analyzer_get_source_info(self)->frequency;
   msg->measured_samp_rate = suscan_analyzer_get_measured_samp_rate(self);
-  suscan_analyzer_get_source_time(self, &msg->timestamp);
+  if (timestamp != NULL)
+    msg->timestamp = *timestamp;
+  else
+    suscan_analyzer_get_source_time(self, &msg->timestamp);
   msg->looped = looped;
   msg->N0 = 0;
 
@@ -46,6 +46,8 @@ extern "C" {
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS        0xb /* Analyzer params */
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_GET_PARAMS    0xc
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_SEEK          0xd
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_BAND    0xe /* Revisit priority */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_STATS   0xf /* Sweep coverage */
 
 /* Invalid message. No one should even send this. */
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_INVALID       0x8000000
@@ -89,6 +91,28 @@ SUSCAN_SERIALIZABLE(suscan_analyzer_seek_msg) {
   struct timeval position;
 };
 
+/* Revisit priority of a band, for scheduled sweeps */
+SUSCAN_SERIALIZABLE(suscan_analyzer_sweep_band_msg) {
+  SUFREQ  min_freq;
+  SUFREQ  max_freq;
+  SUFLOAT revisit; /* Target revisit time (s). 0: remove all bands */
+};
+
+/*
+ * Statistics of a wide spectrum sweep. The sweep rate is sent for every
+ * strategy. Coverage and revisit fields are only filled by the scheduled
+ * strategy, and are zero otherwise.
+ */
+SUSCAN_SERIALIZABLE(suscan_analyzer_sweep_stats_msg) {
+  uint32_t strategy;
+  uint32_t partitions;   /* Partitions of the hop range */
+  uint32_t visited;      /* Partitions visited at least once */
+  SUFLOAT  sweep_rate;   /* GHz/s */
+  SUFLOAT  mean_age;     /* Mean time since the last visit (s) */
+  SUFLOAT  max_age;      /* Largest time since the last visit (s) */
+  SUFLOAT  max_lateness; /* Largest age / target revisit ratio */
+};
+
 /* Channel spectrum message */
 SUSCAN_SERIALIZABLE(suscan_analyzer_psd_msg) {
   int64_t fc;
@@ -101,6 +125,7 @@ SUSCAN_SERIALIZABLE(suscan_analyzer_psd_msg) {
   SUFLOAT  N0;
   SUSCOUNT psd_size;
   SUFLOAT *psd_data;
+  SUBOOL   pooled; /* PSD data belongs to the buffer pool (not serialized) */
 };
 
 /* These messages allow partial deserialization */
@@ -111,6 +136,7 @@ SUSCAN_SERIALIZABLE(suscan_analyzer_sample_batch_msg) {
   uint32_t   inspector_id;
   SUCOMPLEX *samples;
   SUSCOUNT   sample_count;
+  SUBOOL     pooled; /* Samples belong to the buffer pool (not serialized) */
 };
 
 /*
@@ -138,6 +164,8 @@ enum suscan_analyzer_inspector_msgkind {
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_TLE,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_ORBIT_REPORT,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_CORRECTION,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_GATE,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_GATE_REPORT,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_COUNT
 };
 
@@ -166,6 +194,8 @@ suscan_analyzer_inspector_msgkind_to_string(
     SUSCAN_COMP_MSGKIND(INVALID_ARGUMENT);
     SUSCAN_COMP_MSGKIND(WRONG_KIND);
     SUSCAN_COMP_MSGKIND(INVALID_CHANNEL);
+    SUSCAN_COMP_MSGKIND(SET_GATE);
+    SUSCAN_COMP_MSGKIND(GATE_REPORT);
 
     default:
       return "UNKNOWN";
@@ -221,6 +251,15 @@ SUSCAN_SERIALIZABLE(suscan_analyzer_inspector_msg) {
 
     struct suscan_orbit_report orbit_report;
 
+    struct {
+      SUFLOAT  gate_threshold;  /* Mean channel power. 0: disabled */
+      uint32_t gate_policy;     /* enum suscan_inspector_gate_policy */
+      SUBOOL   gate_suspended;
+      SUFLOAT  gate_power;      /* Power of the last window */
+      uint64_t gate_skipped;    /* Windows not processed */
+      uint64_t gate_saved_ns;   /* Estimated processing time saved */
+    };
+
     SUSCOUNT watermark;
   };
 };
@@ -245,10 +284,19 @@ SUBOOL suscan_analyzer_send_psd(
     suscan_analyzer_t *analyzer,
     const su_channel_detector_t *detector);
 
+/* For spectra computed after the source moved to a different frequency */
+SUBOOL suscan_analyzer_send_psd_ex(
+    suscan_analyzer_t *analyzer,
+    const su_channel_detector_t *detector,
+    SUFREQ fc,
+    const struct timeval *timestamp);
+
+/* timestamp: time of the data. NULL: current source time */
 SUBOOL suscan_analyzer_send_psd_from_smoothpsd(
     suscan_analyzer_t *self,
     const su_smoothpsd_t *smoothpsd,
-    SUBOOL looped);
+    SUBOOL looped,
+    const struct timeval *timestamp);
 
 SUBOOL suscan_analyzer_send_source_info(
     suscan_analyzer_t *self,
@@ -306,6 +354,16 @@ struct suscan_analyzer_sample_batch_msg *suscan_analyzer_sample_batch_msg_new(
     const SUCOMPLEX *samples,
     SUSCOUNT count);
 
+/*
+ * Zero-copy variant: the message takes ownership of a buffer allocated
+ * with suscan_buffer_alloc, which is returned to the pool on destroy.
+ */
+struct suscan_analyzer_sample_batch_msg *
+suscan_analyzer_sample_batch_msg_new_from_pool(
+    uint32_t inspector_id,
+    SUCOMPLEX *samples,
+    SUSCOUNT count);
+
 void suscan_analyzer_sample_batch_msg_destroy(
     struct suscan_analyzer_sample_batch_msg *msg);
 
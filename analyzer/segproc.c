@@ -0,0 +1,508 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "segproc"
+
+#include <sigutils/log.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "segproc.h"
+#include "msg.h"
+
+/***************************** Segment outputs *******************************/
+SUPRIVATE void
+suscan_segproc_dispose_output(
+  const suscan_segproc_t *self,
+  uint32_t type,
+  void *ptr)
+{
+  if (self->params.dispose != NULL)
+    (self->params.dispose) (type, ptr);
+  else
+    suscan_analyzer_dispose_message(type, ptr);
+}
+
+SUPRIVATE void
+suscan_segproc_segment_clear_outputs(struct suscan_segproc_segment *seg)
+{
+  unsigned int i;
+
+  for (i = 0; i < seg->output_count; ++i)
+    if (seg->output_list[i] != NULL) {
+      if (seg->output_list[i]->ptr != NULL)
+        suscan_segproc_dispose_output(
+          seg->owner,
+          seg->output_list[i]->type,
+          seg->output_list[i]->ptr);
+      free(seg->output_list[i]);
+    }
+
+  if (seg->output_list != NULL)
+    free(seg->output_list);
+
+  seg->output_list  = NULL;
+  seg->output_count = 0;
+}
+
+SUBOOL
+suscan_segproc_segment_emit(
+  struct suscan_segproc_segment *seg,
+  uint32_t type,
+  void *ptr)
+{
+  struct suscan_segproc_output *output = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  /* Warm-up outputs are discarded */
+  if (suscan_segproc_segment_is_warming_up(seg)) {
+    suscan_segproc_dispose_output(seg->owner, type, ptr);
+    return SU_TRUE;
+  }
+
+  SU_ALLOCATE(output, struct suscan_segproc_output);
+
+  output->type = type;
+  output->ptr  = ptr;
+
+  SU_TRYC(PTR_LIST_APPEND_CHECK(seg->output, output));
+  output = NULL;
+  ptr    = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (output != NULL)
+    free(output);
+
+  if (ptr != NULL)
+    suscan_segproc_dispose_output(seg->owner, type, ptr);
+
+  return ok;
+}
+
+/****************************** Worker threads *******************************/
+SUPRIVATE SUBOOL
+suscan_segproc_process_segment(
+  suscan_segproc_t *self,
+  struct suscan_segproc_worker *wk,
+  struct suscan_segproc_segment *seg)
+{
+  SUSCOUNT limit, max, decim;
+  SUSDIFF got;
+  SUBOOL opened = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  seg->source = wk->source;
+  decim = wk->source->decim > 1 ? wk->source->decim : 1;
+
+  if (!suscan_source_seek(wk->source, seg->warmup)) {
+    SU_ERROR("Cannot seek to sample %lu\n", (unsigned long) seg->warmup);
+    goto done;
+  }
+
+  seg->pos = seg->warmup;
+
+  if (self->params.open != NULL) {
+    SU_TRY(seg->privdata = (self->params.open) (self->params.userdata, seg));
+    opened = SU_TRUE;
+  }
+
+  while (seg->pos < seg->end
+    && !__atomic_load_n(&self->cancelled, __ATOMIC_RELAXED)) {
+    /* Blocks do not cross the end of the warm-up */
+    limit = seg->pos < seg->start ? seg->start : seg->end;
+    max   = (limit - seg->pos) / decim;
+
+    if (max == 0)
+      max = 1;
+    else if (max > self->params.block_size)
+      max = self->params.block_size;
+
+    if ((got = suscan_source_read(wk->source, wk->buffer, max)) < 0) {
+      SU_ERROR(
+        "Read error in segment %u at sample %lu\n",
+        seg->index,
+        (unsigned long) seg->pos);
+      goto done;
+    }
+
+    /* End of file (i.e. less than one decimated sample left) */
+    if (got == 0)
+      break;
+
+    SU_TRY(
+      (self->params.feed) (self->params.userdata, seg, wk->buffer, got));
+
+    seg->pos = suscan_source_get_consumed_samples(wk->source);
+  }
+
+  /* A cancelled segment is incomplete, and must not be delivered */
+  if (__atomic_load_n(&self->cancelled, __ATOMIC_RELAXED)) {
+    seg->cancelled = SU_TRUE;
+    goto done;
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (opened && self->params.close != NULL)
+    (self->params.close) (self->params.userdata, seg);
+
+  seg->privdata = NULL;
+  seg->source   = NULL;
+
+  return ok;
+}
+
+SUPRIVATE void *
+suscan_segproc_worker_thread(void *userdata)
+{
+  struct suscan_segproc_worker *wk = (struct suscan_segproc_worker *) userdata;
+  suscan_segproc_t *self = wk->owner;
+  struct suscan_segproc_segment *seg;
+  unsigned int index;
+  SUBOOL ok;
+
+  for (;;) {
+    /* Wait for delivery to catch up before running further ahead */
+    (void) pthread_mutex_lock(&self->mutex);
+    while (self->next_segment < self->segment_count
+      && self->next_segment >= self->delivered + self->max_ahead
+      && !__atomic_load_n(&self->cancelled, __ATOMIC_RELAXED))
+      (void) pthread_cond_wait(&self->cond, &self->mutex);
+
+    index = self->next_segment;
+    if (index < self->segment_count)
+      ++self->next_segment;
+    (void) pthread_mutex_unlock(&self->mutex);
+
+    if (index >= self->segment_count
+      || __atomic_load_n(&self->cancelled, __ATOMIC_RELAXED))
+      break;
+
+    seg = self->segment_list + index;
+    ok  = suscan_segproc_process_segment(self, wk, seg);
+
+    (void) pthread_mutex_lock(&self->mutex);
+    seg->failed = !ok && !seg->cancelled;
+    seg->done   = SU_TRUE;
+    (void) pthread_cond_broadcast(&self->cond);
+    (void) pthread_mutex_unlock(&self->mutex);
+
+    if (seg->failed)
+      suscan_segproc_cancel(self);
+  }
+
+  return NULL;
+}
+
+/***************************** Segment processor *****************************/
+SUPRIVATE SUBOOL
+suscan_segproc_init_segments(suscan_segproc_t *self)
+{
+  struct suscan_segproc_segment *seg;
+  SUSCOUNT size = self->params.segment_size;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  if (size == 0)
+    size =
+      (self->total + self->params.threads * SUSCAN_SEGPROC_SEGMENTS_PER_THREAD
+        - 1)
+      / (self->params.threads * SUSCAN_SEGPROC_SEGMENTS_PER_THREAD);
+
+  if (size < self->params.block_size)
+    size = self->params.block_size;
+
+  self->segment_count = (self->total + size - 1) / size;
+
+  SU_ALLOCATE_MANY(
+    self->segment_list,
+    self->segment_count,
+    struct suscan_segproc_segment);
+
+  for (i = 0; i < self->segment_count; ++i) {
+    seg = self->segment_list + i;
+
+    seg->owner  = self;
+    seg->index  = i;
+    seg->start  = i * size;
+    seg->end    = MIN(seg->start + size, self->total);
+    seg->warmup =
+      seg->start > self->params.overlap ? seg->start - self->params.overlap : 0;
+  }
+
+  ok = SU_TRUE;
+
+done:
+  return ok;
+}
+
+SU_INSTANCER(
+  suscan_segproc,
+  suscan_source_config_t *config,
+  const struct suscan_segproc_params *params)
+{
+  suscan_segproc_t *new = NULL;
+  suscan_source_config_t *copy = NULL;
+  struct suscan_segproc_worker *wk;
+  SUSDIFF max_size;
+  unsigned int i;
+  long count;
+
+  if (params->feed == NULL) {
+    SU_ERROR("Segment processor requires a feed() callback\n");
+    goto fail;
+  }
+
+  if (params->on_output == NULL) {
+    SU_ERROR("Segment processor requires an on_output() callback\n");
+    goto fail;
+  }
+
+  if (suscan_source_config_get_type(config) != SUSCAN_SOURCE_TYPE_FILE) {
+    SU_ERROR("Segment processing is only supported by file sources\n");
+    goto fail;
+  }
+
+  SU_ALLOCATE_FAIL(new, suscan_segproc_t);
+
+  new->params = *params;
+
+  if (new->params.block_size == 0)
+    new->params.block_size = SUSCAN_SEGPROC_DEFAULT_BLOCK_SIZE;
+
+  if (new->params.threads == 0) {
+    if ((count = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+      count = 1;
+    new->params.threads = count;
+  }
+
+  SU_TRY_FAIL(pthread_mutex_init(&new->mutex, NULL) == 0);
+  if (pthread_cond_init(&new->cond, NULL) != 0) {
+    pthread_mutex_destroy(&new->mutex);
+    goto fail;
+  }
+  new->sync_init = SU_TRUE;
+
+  /* Segments must end where they are told to. No looping. */
+  SU_TRY_FAIL(copy = suscan_source_config_clone(config));
+  suscan_source_config_set_loop(copy, SU_FALSE);
+
+  /* One source per worker. They all read the same file, independently. */
+  SU_ALLOCATE_MANY_FAIL(
+    new->worker_list,
+    new->params.threads,
+    struct suscan_segproc_worker);
+
+  for (i = 0; i < new->params.threads; ++i) {
+    wk = new->worker_list + i;
+    wk->owner = new;
+    SU_TRY_FAIL(wk->source = suscan_source_new(copy));
+    SU_TRY_FAIL(suscan_source_start_capture(wk->source));
+    SU_ALLOCATE_MANY_FAIL(wk->buffer, new->params.block_size, SUCOMPLEX);
+    ++new->worker_count;
+  }
+
+  if ((max_size = suscan_source_get_max_size(new->worker_list[0].source))
+    <= 0) {
+    SU_ERROR("Segment processing requires a seekable, non-empty source\n");
+    goto fail;
+  }
+
+  new->total = max_size;
+
+  SU_TRY_FAIL(suscan_segproc_init_segments(new));
+
+  /* Do not keep idle workers around */
+  while (new->worker_count > new->segment_count) {
+    wk = new->worker_list + --new->worker_count;
+    suscan_source_destroy(wk->source);
+    free(wk->buffer);
+    wk->source = NULL;
+    wk->buffer = NULL;
+  }
+
+  suscan_source_config_destroy(copy);
+
+  return new;
+
+fail:
+  if (copy != NULL)
+    suscan_source_config_destroy(copy);
+
+  if (new != NULL)
+    suscan_segproc_destroy(new);
+
+  return NULL;
+}
+
+SU_METHOD(suscan_segproc, void, cancel)
+{
+  __atomic_store_n(&self->cancelled, SU_TRUE, __ATOMIC_RELAXED);
+}
+
+/*
+ * cancel() may be called from a signal handler, so it cannot touch the
+ * condition variable. Workers waiting for delivery to catch up are woken
+ * up here, before joining them.
+ */
+SUPRIVATE void
+suscan_segproc_cancel_and_wake(suscan_segproc_t *self)
+{
+  suscan_segproc_cancel(self);
+
+  (void) pthread_mutex_lock(&self->mutex);
+  (void) pthread_cond_broadcast(&self->cond);
+  (void) pthread_mutex_unlock(&self->mutex);
+}
+
+SUPRIVATE SUBOOL
+suscan_segproc_deliver_segment(
+  suscan_segproc_t *self,
+  struct suscan_segproc_segment *seg)
+{
+  struct suscan_segproc_output *output;
+  unsigned int i;
+  void *ptr;
+
+  for (i = 0; i < seg->output_count; ++i) {
+    output      = seg->output_list[i];
+    ptr         = output->ptr;
+    output->ptr = NULL;
+
+    if (!(self->params.on_output) (
+      self->params.userdata,
+      seg,
+      output->type,
+      ptr))
+      return SU_FALSE;
+  }
+
+  suscan_segproc_segment_clear_outputs(seg);
+
+  return SU_TRUE;
+}
+
+SU_METHOD(suscan_segproc, SUBOOL, run)
+{
+  struct suscan_segproc_segment *seg;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  self->next_segment = 0;
+  self->delivered    = 0;
+  self->max_ahead    =
+    self->worker_count * SUSCAN_SEGPROC_MAX_AHEAD_PER_THREAD;
+
+  for (i = 0; i < self->worker_count; ++i) {
+    SU_TRY(
+      pthread_create(
+        &self->worker_list[i].thread,
+        NULL,
+        suscan_segproc_worker_thread,
+        self->worker_list + i) == 0);
+    self->worker_list[i].thread_running = SU_TRUE;
+  }
+
+  /* Deliver outputs in segment order, as segments complete */
+  for (i = 0; i < self->segment_count; ++i) {
+    seg = self->segment_list + i;
+
+    (void) pthread_mutex_lock(&self->mutex);
+    while (!seg->done && !__atomic_load_n(&self->cancelled, __ATOMIC_RELAXED))
+      (void) pthread_cond_wait(&self->cond, &self->mutex);
+    (void) pthread_mutex_unlock(&self->mutex);
+
+    if (!seg->done || seg->cancelled)
+      break;
+
+    if (seg->failed) {
+      SU_ERROR("Segment %u failed\n", i);
+      goto done;
+    }
+
+    SU_TRY(suscan_segproc_deliver_segment(self, seg));
+
+    (void) pthread_mutex_lock(&self->mutex);
+    self->delivered = i + 1;
+    (void) pthread_cond_broadcast(&self->cond);
+    (void) pthread_mutex_unlock(&self->mutex);
+  }
+
+  if (i < self->segment_count) {
+    SU_WARNING("Segment processing cancelled\n");
+    goto done;
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (!ok)
+    suscan_segproc_cancel_and_wake(self);
+
+  for (i = 0; i < self->worker_count; ++i)
+    if (self->worker_list[i].thread_running) {
+      pthread_join(self->worker_list[i].thread, NULL);
+      self->worker_list[i].thread_running = SU_FALSE;
+    }
+
+  return ok;
+}
+
+SU_COLLECTOR(suscan_segproc)
+{
+  unsigned int i;
+
+  if (self->worker_list != NULL) {
+    if (self->sync_init)
+      suscan_segproc_cancel_and_wake(self);
+    else
+      suscan_segproc_cancel(self);
+
+    for (i = 0; i < self->params.threads; ++i) {
+      if (self->worker_list[i].thread_running)
+        pthread_join(self->worker_list[i].thread, NULL);
+
+      if (self->worker_list[i].source != NULL)
+        suscan_source_destroy(self->worker_list[i].source);
+
+      if (self->worker_list[i].buffer != NULL)
+        free(self->worker_list[i].buffer);
+    }
+
+    free(self->worker_list);
+  }
+
+  if (self->segment_list != NULL) {
+    for (i = 0; i < self->segment_count; ++i)
+      suscan_segproc_segment_clear_outputs(self->segment_list + i);
+
+    free(self->segment_list);
+  }
+
+  if (self->sync_init) {
+    pthread_mutex_destroy(&self->mutex);
+    pthread_cond_destroy(&self->cond);
+  }
+
+  free(self);
+}
@@ -0,0 +1,188 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _SUSCAN_SEGPROC_H
+#define _SUSCAN_SEGPROC_H
+
+#include <sigutils/sigutils.h>
+#include <pthread.h>
+#include <util/util.h>
+#include "source.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The segment processor splits a seekable source (i.e. a recording) into
+ * time segments and runs each of them through its own pipeline, in a pool
+ * of worker threads. Every segment is preceded by a few warm-up samples
+ * (the overlap with the previous segment) so that filters and estimators
+ * settle before the segment begins. Outputs emitted during the warm-up are
+ * discarded, and the rest are delivered to the user in segment order.
+ */
+
+#define SUSCAN_SEGPROC_DEFAULT_BLOCK_SIZE     65536
+#define SUSCAN_SEGPROC_SEGMENTS_PER_THREAD    4
+
+/*
+ * Workers do not start a segment more than this many segments (per
+ * worker) past the last one delivered, so that the outputs waiting for
+ * an earlier, slower segment do not pile up without bound.
+ */
+#define SUSCAN_SEGPROC_MAX_AHEAD_PER_THREAD   2
+
+struct suscan_segproc;
+
+struct suscan_segproc_output {
+  uint32_t type;
+  void    *ptr;
+};
+
+struct suscan_segproc_segment {
+  struct suscan_segproc *owner;
+  unsigned int     index;
+  SUSCOUNT         warmup;   /* First sample read (start - overlap) */
+  SUSCOUNT         start;    /* First sample whose outputs are kept */
+  SUSCOUNT         end;      /* One past the last sample of the segment */
+  SUSCOUNT         pos;      /* Position of the block being fed */
+  suscan_source_t *source;   /* Source of the worker processing it */
+  void            *privdata; /* As returned by open() */
+
+  PTR_LIST(struct suscan_segproc_output, output);
+
+  SUBOOL done;
+  SUBOOL failed;
+  SUBOOL cancelled; /* Stopped before its end. Never delivered. */
+};
+
+struct suscan_segproc_params {
+  unsigned int threads;      /* 0: as many as online CPUs */
+  SUSCOUNT     segment_size; /* In samples. 0: choose automatically */
+  SUSCOUNT     overlap;      /* Warm-up samples before each segment */
+  SUSCOUNT     block_size;   /* Samples per read */
+  void        *userdata;
+
+  /* Per-segment pipeline. Called from the worker threads. */
+  void  *(*open)  (void *userdata, struct suscan_segproc_segment *seg);
+  SUBOOL (*feed)  (
+    void *userdata,
+    struct suscan_segproc_segment *seg,
+    const SUCOMPLEX *data,
+    SUSCOUNT size);
+  void   (*close) (void *userdata, struct suscan_segproc_segment *seg);
+
+  /*
+   * Merged outputs, called from the thread running the segment processor.
+   * The callback takes ownership of the output.
+   */
+  SUBOOL (*on_output) (
+    void *userdata,
+    const struct suscan_segproc_segment *seg,
+    uint32_t type,
+    void *ptr);
+
+  /* Disposes undelivered outputs. NULL: suscan_analyzer_dispose_message */
+  void   (*dispose) (uint32_t type, void *ptr);
+};
+
+#define suscan_segproc_params_INITIALIZER         \
+{                                                 \
+  0,    /* threads */                             \
+  0,    /* segment_size */                        \
+  0,    /* overlap */                             \
+  SUSCAN_SEGPROC_DEFAULT_BLOCK_SIZE, /* block */  \
+  NULL, /* userdata */                            \
+  NULL, /* open */                                \
+  NULL, /* feed */                                \
+  NULL, /* close */                               \
+  NULL, /* on_output */                           \
+  NULL, /* dispose */                             \
+}
+
+struct suscan_segproc_worker {
+  struct suscan_segproc *owner;
+  suscan_source_t *source;
+  SUCOMPLEX       *buffer;
+  pthread_t        thread;
+  SUBOOL           thread_running;
+};
+
+struct suscan_segproc {
+  struct suscan_segproc_params params;
+  SUSCOUNT     total;           /* Samples in the recording */
+
+  struct suscan_segproc_segment *segment_list;
+  unsigned int segment_count;
+  unsigned int next_segment;    /* Next segment to be picked by a worker */
+  unsigned int delivered;       /* Segments delivered to on_output */
+  unsigned int max_ahead;       /* Limit of next_segment - delivered */
+
+  struct suscan_segproc_worker  *worker_list;
+  unsigned int worker_count;
+
+  pthread_mutex_t mutex;        /* Protects segment picking and completion */
+  pthread_cond_t  cond;
+  SUBOOL          sync_init;
+  SUBOOL          cancelled;
+};
+
+typedef struct suscan_segproc suscan_segproc_t;
+
+SUINLINE SUBOOL
+suscan_segproc_segment_is_warming_up(const struct suscan_segproc_segment *seg)
+{
+  return seg->pos < seg->start;
+}
+
+SUINLINE unsigned int
+suscan_segproc_get_segment_count(const suscan_segproc_t *self)
+{
+  return self->segment_count;
+}
+
+SUINLINE unsigned int
+suscan_segproc_get_worker_count(const suscan_segproc_t *self)
+{
+  return self->worker_count;
+}
+
+/* To be called by the pipeline (from feed). Takes ownership of ptr. */
+SUBOOL suscan_segproc_segment_emit(
+  struct suscan_segproc_segment *seg,
+  uint32_t type,
+  void *ptr);
+
+SU_INSTANCER(
+  suscan_segproc,
+  suscan_source_config_t *config,
+  const struct suscan_segproc_params *params);
+SU_COLLECTOR(suscan_segproc);
+
+/* Blocks until all segments were processed and delivered */
+SU_METHOD(suscan_segproc, SUBOOL, run);
+
+/* Safe to call from any thread (or signal handler) */
+SU_METHOD(suscan_segproc, void, cancel);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _SUSCAN_SEGPROC_H */
@@ -430,6 +430,7 @@ suscan_local_analyzer_set_inspector_freq_cb(
   return SU_FALSE;
 }
 
+/* Runs in the PSD worker, between PSD blocks */
 SUPRIVATE SUBOOL
 suscan_local_analyzer_set_psd_params_cb(
     struct suscan_mq *mq_out,
@@ -565,7 +566,7 @@ suscan_local_analyzer_set_analyzer_params_overridable(
   self->psd_params_req = SU_TRUE;
 
   return suscan_worker_push(
-      self->slow_wk,
+      self->psd_wk,
       suscan_local_analyzer_set_psd_params_cb,
       NULL);
 }
@@ -583,7 +584,7 @@ suscan_local_analyzer_set_psd_samp_rate_overridable(
   self->psd_params_req = SU_TRUE;
 
   return suscan_worker_push(
-      self->slow_wk,
+      self->psd_wk,
       suscan_local_analyzer_set_psd_params_cb,
       NULL);
 }
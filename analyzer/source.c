@@ -23,6 +23,7 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <libgen.h>
 
 #define SU_LOG_DOMAIN "source"
@@ -52,6 +53,13 @@
 #  define SUSCAN_SOAPY_SAMPFMT SOAPY_SDR_CF64
 #endif
 
+#if !defined(_WIN32) && defined(__BYTE_ORDER__) \
+  && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define SUSCAN_SOURCE_USE_MMAP
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif /* Little-endian, POSIX */
+
 #ifdef bool /* Someone is using this for whatever reason */
 #  undef bool
 #endif /* bool */
@@ -1606,13 +1614,605 @@ fail:
   return NULL;
 }
 
+/************************* Stream format conversion **************************/
+/*
+ * Integer samples are converted, scaled, DC-corrected and (optionally)
+ * conjugated in a single pass over the buffer. Loops are kept free of
+ * branches so that the compiler can vectorize them.
+ */
+#define SUSCAN_SOURCE_CONVERT_LOOP(type, bias, scale)                   \
+  do {                                                                  \
+    const type *x = (const type *) data;                                \
+    SUFLOAT re, im;                                                     \
+    for (i = 0; i < n; i += 2) {                                        \
+      re = (scale) * ((SUFLOAT) x[i]     - (bias));                     \
+      im = (scale) * ((SUFLOAT) x[i + 1] - (bias));                     \
+      sum_i += re;                                                      \
+      sum_q += im;                                                      \
+      out[i]     = re - dc_i;                                           \
+      out[i + 1] = qsign * (im - dc_q);                                 \
+    }                                                                   \
+  } while (0)
+
+SUINLINE SUBOOL
+suscan_source_needs_conversion(const suscan_source_t *self)
+{
+  return self->stream_format != SUSCAN_SOURCE_STREAM_FORMAT_FLOAT
+    || self->iq_rev
+    || self->soft_dc_correction;
+}
+
+/* data and buf may point to the same buffer if the format is FLOAT */
+SUPRIVATE void
+suscan_source_convert_samples(
+  suscan_source_t *self,
+  SUCOMPLEX *buf,
+  const void *data,
+  SUSCOUNT size)
+{
+  SUFLOAT *out = (SUFLOAT *) buf;
+  SUFLOAT scale = self->stream_scale;
+  SUFLOAT qsign = self->iq_rev ? -1 : 1;
+  SUFLOAT dc_i = 0, dc_q = 0;
+  SUFLOAT sum_i = 0, sum_q = 0;
+  SUSCOUNT i, n = size << 1;
+
+  if (size == 0)
+    return;
+
+  if (self->soft_dc_correction) {
+    dc_i = SU_C_REAL(self->dc_offset);
+    dc_q = SU_C_IMAG(self->dc_offset);
+  }
+
+  switch (self->stream_format) {
+    case SUSCAN_SOURCE_STREAM_FORMAT_CF32:
+      SUSCAN_SOURCE_CONVERT_LOOP(float, 0, 1);
+      break;
+
+    case SUSCAN_SOURCE_STREAM_FORMAT_CS16:
+      SUSCAN_SOURCE_CONVERT_LOOP(int16_t, 0, scale);
+      break;
+
+    case SUSCAN_SOURCE_STREAM_FORMAT_CS8:
+      SUSCAN_SOURCE_CONVERT_LOOP(int8_t, 0, scale);
+      break;
+
+    case SUSCAN_SOURCE_STREAM_FORMAT_CU8:
+      SUSCAN_SOURCE_CONVERT_LOOP(uint8_t, 128, scale);
+      break;
+
+    default:
+      SUSCAN_SOURCE_CONVERT_LOOP(SUFLOAT, 0, 1);
+  }
+
+  /* Block-wise DC tracker: the estimate is applied to the next block */
+  if (self->soft_dc_correction)
+    self->dc_offset += SUSCAN_SOURCE_DC_REMOVE_ALPHA 
+      * ((sum_i + I * sum_q) / size - self->dc_offset);
+}
+
+#undef SUSCAN_SOURCE_CONVERT_LOOP
+
+SUINLINE void
+suscan_source_import_samples(
+  suscan_source_t *self,
+  SUCOMPLEX *buf,
+  const void *data,
+  SUSCOUNT size)
+{
+  if (suscan_source_needs_conversion(self))
+    suscan_source_convert_samples(self, buf, data, size);
+  else if ((const void *) buf != data)
+    memcpy(buf, data, size * sizeof(SUCOMPLEX));
+}
+
+/***************************** SDR stream clock ******************************/
+/*
+ * Samples by which the system time runs ahead of the stream clock. Only
+ * meaningful without hardware timestamps, as the epoch was taken from the
+ * system time too.
+ */
+SUPRIVATE int64_t
+suscan_source_clock_wall_offset(const suscan_source_t *self)
+{
+  struct timeval now, elapsed;
+  SUFLOAT seconds;
+
+  gettimeofday(&now, NULL);
+  timersub(&now, &self->clock_epoch, &elapsed);
+
+  seconds = elapsed.tv_sec + 1e-6 * elapsed.tv_usec
+    - 1e-9 * self->clock_skew_ns;
+
+  return (int64_t) (seconds * self->samp_rate) - (int64_t) self->clock_samples;
+}
+
+/*
+ * Without hardware timestamps, the device and system oscillators drift
+ * apart. Once they differ by more than the read latency, the difference is
+ * folded into the epoch correction.
+ */
+SUPRIVATE void
+suscan_source_clock_realign(suscan_source_t *self)
+{
+  int64_t offset = suscan_source_clock_wall_offset(self);
+  SUFLOAT tolerance = SUSCAN_SOURCE_CLOCK_WALL_TOLERANCE * self->samp_rate;
+
+  if (offset > tolerance || offset < -tolerance)
+    __atomic_store_n(
+      &self->clock_skew_ns,
+      self->clock_skew_ns + (long long) (offset * 1e9 / self->samp_rate),
+      __ATOMIC_RELAXED);
+
+  self->clock_aligned = self->clock_samples;
+}
+
+/*
+ * Called with the readStream flags and timestamp of every chunk of device
+ * samples, before accounting its samples. The first chunk anchors the clock
+ * to the system time. For the next ones, hardware timestamps (or, if not
+ * available, the samples dropped by the capture thread) reveal gaps in the
+ * stream, which are skipped by the clock. Overflows without timestamps
+ * lose an unknown number of samples, which is estimated from the system
+ * time.
+ */
+SUPRIVATE void
+suscan_source_clock_update(
+  suscan_source_t *self,
+  int flags,
+  long long time_ns,
+  SUSCOUNT dropped,
+  SUBOOL overflow)
+{
+  SUBOOL has_time = (flags & SOAPY_SDR_HAS_TIME) != 0;
+  uint64_t samples = self->clock_samples;
+  long long expected;
+  int64_t gap;
+
+  if (!self->clock_anchored) {
+    gettimeofday(&self->clock_epoch, NULL);
+    self->clock_hw       = has_time;
+    self->clock_epoch_ns = time_ns;
+    self->clock_aligned  = 0;
+    __atomic_store_n(&self->clock_skew_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&self->clock_samples, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&self->clock_anchored, SU_TRUE, __ATOMIC_RELEASE);
+    return;
+  }
+
+  if (self->clock_hw && has_time) {
+    expected = self->clock_epoch_ns
+      + (long long) (samples * 1e9 / self->samp_rate);
+    gap = (int64_t) ((time_ns - expected) * 1e-9 * self->samp_rate);
+
+    if (gap < -SUSCAN_SOURCE_CLOCK_TOLERANCE) {
+      /* Device clock went backwards (reset?). Follow it from here. */
+      self->clock_epoch_ns += time_ns - expected;
+      return;
+    }
+  } else {
+    gap = dropped;
+
+    if (overflow) {
+      /* Whatever the system time says beyond the read latency was lost */
+      gap = suscan_source_clock_wall_offset(self)
+        - SUSCAN_SOURCE_CLOCK_WALL_TOLERANCE * self->samp_rate;
+      if (gap < (int64_t) dropped)
+        gap = dropped;
+    }
+  }
+
+  if (gap > SUSCAN_SOURCE_CLOCK_TOLERANCE) {
+    samples += gap;
+    __atomic_store_n(&self->clock_samples, samples, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&self->samples_lost, gap, __ATOMIC_RELAXED);
+  }
+
+  if (!self->clock_hw
+    && samples - self->clock_aligned
+      >= SUSCAN_SOURCE_CLOCK_ALIGN_INTERVAL * self->samp_rate)
+    suscan_source_clock_realign(self);
+}
+
+SUINLINE void
+suscan_source_clock_advance(suscan_source_t *self, SUSCOUNT samples)
+{
+  if (self->clock_anchored)
+    __atomic_store_n(
+      &self->clock_samples,
+      self->clock_samples + samples,
+      __ATOMIC_RELAXED);
+}
+
+SUPRIVATE void
+suscan_source_clock_reset(suscan_source_t *self)
+{
+  self->clock_anchored = SU_FALSE;
+  self->clock_samples  = 0;
+  self->clock_aligned  = 0;
+  self->clock_skew_ns  = 0;
+  self->samples_lost   = 0;
+  self->retune_sample  = 0;
+  self->retune_timed   = SU_FALSE;
+}
+
+/*
+ * Called right after the device was retuned. Samples whose timestamps
+ * are earlier than the current hardware time were captured at the old
+ * frequency.
+ */
+SUPRIVATE void
+suscan_source_clock_mark_retune(suscan_source_t *self)
+{
+  long long now_ns;
+
+  self->retune_sample = self->clock_samples;
+  self->retune_timed  = SU_FALSE;
+
+  if (self->clock_anchored && self->clock_hw) {
+    now_ns = SoapySDRDevice_getHardwareTime(self->sdr, NULL);
+
+    /* Some drivers timestamp samples but cannot tell the current time */
+    if (now_ns > self->clock_epoch_ns) {
+      self->retune_sample =
+        (now_ns - self->clock_epoch_ns) * 1e-9 * self->samp_rate;
+      self->retune_timed  = SU_TRUE;
+    }
+  }
+}
+
+/************************** SDR capture thread *******************************/
+SUINLINE void
+suscan_source_flush_capture_ring(suscan_source_t *self)
+{
+  if (self->ring != NULL)
+    __atomic_add_fetch(&self->ring_epoch, 1, __ATOMIC_RELEASE);
+}
+
+SUPRIVATE void
+suscan_source_wake_capture_consumer(suscan_source_t *self)
+{
+  if (__atomic_load_n(&self->ring_waiting, __ATOMIC_SEQ_CST)) {
+    (void) pthread_mutex_lock(&self->ring_mutex);
+    (void) pthread_cond_broadcast(&self->ring_cond);
+    (void) pthread_mutex_unlock(&self->ring_mutex);
+  }
+}
+
+SUPRIVATE void *
+suscan_source_capture_thread(void *userdata)
+{
+  suscan_source_t *self = (suscan_source_t *) userdata;
+  struct suscan_source_capture_block *block;
+  void *buf;
+  unsigned int head, used;
+  SUSCOUNT dropped = 0;
+  SUBOOL overflow = SU_FALSE;
+  SUBOOL full;
+  int result;
+  int flags;
+  long long timeNs;
+
+  while (!__atomic_load_n(&self->capture_cancelled, __ATOMIC_ACQUIRE)) {
+    head = self->ring_head;
+    used = head - __atomic_load_n(&self->ring_tail, __ATOMIC_ACQUIRE);
+    full = used >= self->ring_depth;
+
+    /* Keep the device drained even if the consumer is lagging behind */
+    if (full) {
+      block = NULL;
+      buf   = self->ring_scratch;
+    } else {
+      block = self->ring + head % self->ring_depth;
+      buf   = block->data;
+    }
+
+    result = SoapySDRDevice_readStream(
+        self->sdr,
+        self->rx_stream,
+        (void * const*) &buf,
+        self->ring_block_size,
+        &flags,
+        &timeNs,
+        SUSCAN_SOURCE_DEFAULT_READ_TIMEOUT);
+
+    if (result == SOAPY_SDR_OVERFLOW) {
+      __atomic_add_fetch(&self->capture_overflows, 1, __ATOMIC_RELAXED);
+      overflow = SU_TRUE;
+      continue;
+    } else if (result == SOAPY_SDR_TIMEOUT || result == SOAPY_SDR_UNDERFLOW) {
+      continue;
+    } else if (result < 0) {
+      SU_ERROR(
+          "Capture thread: failed to read samples from stream: %s (result %d)\n",
+          SoapySDR_errToStr(result),
+          result);
+      __atomic_store_n(&self->capture_error, result, __ATOMIC_SEQ_CST);
+      suscan_source_wake_capture_consumer(self);
+      break;
+    } else if (result == 0) {
+      continue;
+    }
+
+    if (full) {
+      __atomic_add_fetch(&self->capture_dropped, result, __ATOMIC_RELAXED);
+      dropped += result;
+      continue;
+    }
+
+    block->size    = result;
+    block->epoch   = __atomic_load_n(&self->ring_epoch, __ATOMIC_ACQUIRE);
+    block->flags   = flags;
+    block->time_ns = timeNs;
+    block->dropped  = dropped;
+    block->overflow = overflow;
+    dropped         = 0;
+    overflow        = SU_FALSE;
+
+    __atomic_store_n(&self->ring_head, head + 1, __ATOMIC_SEQ_CST);
+
+    if (used + 1 > self->ring_high_water)
+      __atomic_store_n(&self->ring_high_water, used + 1, __ATOMIC_RELAXED);
+
+    suscan_source_wake_capture_consumer(self);
+  }
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+suscan_source_capture_wait(suscan_source_t *self)
+{
+  struct timespec ts;
+  struct timeval now, timeout, future;
+  SUBOOL ok = SU_FALSE;
+
+  timeout.tv_sec  = 0;
+  timeout.tv_usec = SUSCAN_SOURCE_DEFAULT_READ_TIMEOUT;
+
+  gettimeofday(&now, NULL);
+  timeradd(&now, &timeout, &future);
+  ts.tv_sec  = future.tv_sec;
+  ts.tv_nsec = future.tv_usec * 1000;
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->ring_mutex) == 0, return SU_FALSE);
+
+  __atomic_store_n(&self->ring_waiting, SU_TRUE, __ATOMIC_SEQ_CST);
+
+  /* Check again, the capture thread may have published a block meanwhile */
+  if (__atomic_load_n(&self->ring_head, __ATOMIC_SEQ_CST) == self->ring_tail
+      && __atomic_load_n(&self->capture_error, __ATOMIC_SEQ_CST) == 0)
+    (void) pthread_cond_timedwait(&self->ring_cond, &self->ring_mutex, &ts);
+
+  __atomic_store_n(&self->ring_waiting, SU_FALSE, __ATOMIC_SEQ_CST);
+
+  ok = SU_TRUE;
+
+  (void) pthread_mutex_unlock(&self->ring_mutex);
+
+  return ok;
+}
+
+SUPRIVATE SUSDIFF
+suscan_source_read_sdr_ring(suscan_source_t *self, SUCOMPLEX *buf, SUSCOUNT max)
+{
+  struct suscan_source_capture_block *block;
+  unsigned int tail;
+  SUSCOUNT avail;
+  int error;
+
+  for (;;) {
+    if (self->force_eos)
+      return 0;
+
+    tail = self->ring_tail;
+
+    if (__atomic_load_n(&self->ring_head, __ATOMIC_ACQUIRE) != tail) {
+      block = self->ring + tail % self->ring_depth;
+
+      if (self->ring_offset == 0)
+        suscan_source_clock_update(
+          self,
+          block->flags,
+          block->time_ns,
+          block->dropped,
+          block->overflow);
+
+      if (block->epoch 
+        != __atomic_load_n(&self->ring_epoch, __ATOMIC_ACQUIRE)) {
+        /* Captured before a retune. Discard. */
+        suscan_source_clock_advance(self, block->size - self->ring_offset);
+        self->ring_offset = 0;
+        __atomic_store_n(&self->ring_tail, tail + 1, __ATOMIC_RELEASE);
+        continue;
+      }
+
+      avail = block->size - self->ring_offset;
+      if (max > avail)
+        max = avail;
+
+      suscan_source_import_samples(
+        self,
+        buf,
+        (const uint8_t *) block->data 
+          + self->ring_offset * self->stream_sample_size,
+        max);
+
+      suscan_source_clock_advance(self, max);
+
+      self->ring_offset += max;
+      if (self->ring_offset == block->size) {
+        self->ring_offset = 0;
+        __atomic_store_n(&self->ring_tail, tail + 1, __ATOMIC_RELEASE);
+      }
+
+      return max;
+    }
+
+    if ((error = __atomic_load_n(&self->capture_error, __ATOMIC_ACQUIRE)) != 0)
+      return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+
+    SU_TRYCATCH(
+      suscan_source_capture_wait(self),
+      return SU_BLOCK_PORT_READ_ERROR_ACQUIRE);
+  }
+}
+
+SUPRIVATE void
+suscan_source_release_capture_ring(suscan_source_t *self)
+{
+  if (self->ring_sync_init) {
+    pthread_mutex_destroy(&self->ring_mutex);
+    pthread_cond_destroy(&self->ring_cond);
+    self->ring_sync_init = SU_FALSE;
+  }
+
+  if (self->ring_alloc != NULL)
+    free(self->ring_alloc);
+
+  if (self->ring != NULL)
+    free(self->ring);
+
+  self->ring_alloc   = NULL;
+  self->ring_scratch = NULL;
+  self->ring         = NULL;
+}
+
+SUBOOL
+suscan_source_set_capture_ring(suscan_source_t *self, unsigned int depth)
+{
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  if (self->config->type != SUSCAN_SOURCE_TYPE_SDR) {
+    SU_ERROR("Capture threads are only supported by SDR sources\n");
+    goto done;
+  }
+
+  if (self->capturing) {
+    SU_ERROR("Cannot set up a capture ring while capturing\n");
+    goto done;
+  }
+
+  if (depth < SUSCAN_SOURCE_CAPTURE_RING_MIN_DEPTH) {
+    SU_ERROR(
+      "Capture ring too small (at least %d blocks are required)\n",
+      SUSCAN_SOURCE_CAPTURE_RING_MIN_DEPTH);
+    goto done;
+  }
+
+  suscan_source_release_capture_ring(self);
+
+  self->ring_block_size = 
+    self->mtu > 0 ? self->mtu : SUSCAN_SOURCE_DEFAULT_BUFSIZ;
+  self->ring_depth = depth;
+
+  /* One extra block, for samples that do not fit in the ring */
+  SU_TRYCATCH(
+    self->ring_alloc = malloc(
+      (depth + 1) * self->ring_block_size * self->stream_sample_size),
+    goto done);
+
+  SU_TRYCATCH(
+    self->ring = calloc(depth, sizeof(struct suscan_source_capture_block)),
+    goto done);
+
+  for (i = 0; i < depth; ++i)
+    self->ring[i].data = 
+      self->ring_alloc + i * self->ring_block_size * self->stream_sample_size;
+
+  self->ring_scratch = 
+    self->ring_alloc + depth * self->ring_block_size * self->stream_sample_size;
+
+  SU_TRYCATCH(pthread_mutex_init(&self->ring_mutex, NULL) == 0, goto done);
+  if (pthread_cond_init(&self->ring_cond, NULL) != 0) {
+    pthread_mutex_destroy(&self->ring_mutex);
+    goto done;
+  }
+  self->ring_sync_init = SU_TRUE;
+
+  self->read = suscan_source_read_sdr_ring;
+
+  ok = SU_TRUE;
+
+done:
+  if (!ok)
+    suscan_source_release_capture_ring(self);
+
+  return ok;
+}
+
+void
+suscan_source_get_capture_stats(
+  const suscan_source_t *self,
+  struct suscan_source_capture_stats *stats)
+{
+  memset(stats, 0, sizeof(struct suscan_source_capture_stats));
+
+  if (self->ring == NULL)
+    return;
+
+  stats->depth      = self->ring_depth;
+  stats->used       = 
+      __atomic_load_n(&self->ring_head, __ATOMIC_ACQUIRE) 
+    - __atomic_load_n(&self->ring_tail, __ATOMIC_ACQUIRE);
+  stats->high_water = 
+    __atomic_load_n(&self->ring_high_water, __ATOMIC_RELAXED);
+  stats->block_size = self->ring_block_size;
+  stats->overflows  = 
+    __atomic_load_n(&self->capture_overflows, __ATOMIC_RELAXED);
+  stats->dropped    = 
+    __atomic_load_n(&self->capture_dropped, __ATOMIC_RELAXED);
+}
+
+SUPRIVATE SUBOOL
+suscan_source_start_capture_thread(suscan_source_t *self)
+{
+  self->ring_head   = 0;
+  self->ring_tail   = 0;
+  self->ring_offset = 0;
+  self->capture_error     = 0;
+  self->capture_cancelled = SU_FALSE;
+
+  SU_TRYCATCH(
+    pthread_create(
+      &self->capture_thread,
+      NULL,
+      suscan_source_capture_thread,
+      self) == 0,
+    return SU_FALSE);
+
+  self->capture_running = SU_TRUE;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_source_stop_capture_thread(suscan_source_t *self)
+{
+  if (self->capture_running) {
+    __atomic_store_n(&self->capture_cancelled, SU_TRUE, __ATOMIC_RELEASE);
+    (void) pthread_join(self->capture_thread, NULL);
+    self->capture_running = SU_FALSE;
+  }
+}
+
 /****************************** Source API ***********************************/
 void
 suscan_source_destroy(suscan_source_t *source)
 {
+  suscan_source_stop_capture_thread(source);
+  suscan_source_release_capture_ring(source);
+
   if (source->sf != NULL)
     sf_close(source->sf);
 
+#ifdef SUSCAN_SOURCE_USE_MMAP
+  if (source->map != NULL)
+    munmap((void *) source->map, source->map_size);
+#endif /* SUSCAN_SOURCE_USE_MMAP */
+
   if (source->rx_stream != NULL)
     SoapySDRDevice_closeStream(source->sdr, source->rx_stream);
 
@@ -1622,109 +2222,296 @@ suscan_source_destroy(suscan_source_t *source)
   if (source->config != NULL)
     suscan_source_config_destroy(source->config);
 
-  if (source->antialias_alloc != NULL)
-    free(source->antialias_alloc);
+  suscan_source_decimator_finalize(&source->decimator);
 
-  if (source->decim_buf != NULL)
-    free(source->decim_buf);
+  if (source->native_buf != NULL)
+    free(source->native_buf);
 
   free(source);
 }
 
-/*********************** Decimator configuration *****************************/
-SUPRIVATE SUBOOL
-suscan_source_configure_decimation(
-    suscan_source_t *self,
-    int decim)
+/*************************** Antialias decimator *****************************/
+/*
+ * Taps are stored duplicated (one per I/Q component) and zero-padded to a
+ * multiple of SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN, so that the dot product
+ * reduces to a fixed-width float loop the compiler can vectorize.
+ */
+SUBOOL
+suscan_source_decimator_init(struct suscan_source_decimator *self, int decim)
 {
-  int i;
-  SUFLOAT *antialias;
+  int i, length;
+  SUFLOAT *taps = NULL;
+  SUBOOL ok = SU_FALSE;
 
-  /* Decim is M: Compute an antialias filter of M * SUSCAN_SOURCE_POLYPHASE_BANK_SIZE */
+  memset(self, 0, sizeof(struct suscan_source_decimator));
 
-  SU_TRYCATCH(decim > 0, return SU_FALSE);
+  SU_TRYCATCH(decim > 0, goto done);
 
-  self->decim = decim;
-  self->decim_length = decim * SUSCAN_SOURCE_ANTIALIAS_REL_SIZE;
+  length = decim * SUSCAN_SOURCE_ANTIALIAS_REL_SIZE;
 
-  /* Pointers are initialized in 0, -decim, -2 * decim, -3 * decim... */
+  self->decim  = decim;
+  self->length =
+    SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN
+    * ((length + SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN - 1)
+      / SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN);
 
-  for (i = 0; i < SUSCAN_SOURCE_ANTIALIAS_REL_SIZE; ++i)
-    self->ptrs[i] = -i * decim;
+  SU_TRYCATCH(taps = malloc(length * sizeof(SUFLOAT)), goto done);
 
-  /*
-   * 1 filter:  [DECIM]
-   * 2 filters: [NULLS][DECIM][DECIM]
-   * 3 filters: [NULLS][NULLS][DECIM][DECIM][DECIM]
-   */
   SU_TRYCATCH(
-      self->antialias_alloc = calloc(
-          2 * SUSCAN_SOURCE_ANTIALIAS_REL_SIZE - 1,
-          decim * sizeof(SUFLOAT)),
-      return SU_FALSE);
+      self->taps = calloc(2 * self->length, sizeof(SUFLOAT)),
+      goto done);
 
   SU_TRYCATCH(
-      self->decim_buf = malloc(
-          SUSCAN_SOURCE_DECIMATOR_BUFFER_SIZE * sizeof(SUCOMPLEX)),
-      return SU_FALSE);
-
-  antialias = self->antialias_alloc
-      + (SUSCAN_SOURCE_ANTIALIAS_REL_SIZE - 1) * decim;
-  self->antialias = antialias;
+      self->hist = malloc(
+          (self->length - 1 + SUSCAN_SOURCE_DECIMATOR_CHUNK_SIZE)
+          * sizeof(SUCOMPLEX)),
+      goto done);
 
   /*
    * Decim 1: Filter cutoff: 1
    * Decim 2: Filter cutoff: .5
    * Decim 3: Filter cutoff: .3333...
    */
-  su_taps_brickwall_lp_init(
-      antialias,
-      1 / (SUFLOAT) decim,
-      self->decim_length);
+  su_taps_brickwall_lp_init(taps, 1 / (SUFLOAT) decim, length);
 
-  return SU_TRUE;
+  for (i = 0; i < length; ++i)
+    self->taps[2 * i] = self->taps[2 * i + 1] = taps[i];
+
+  ok = SU_TRUE;
+
+done:
+  if (taps != NULL)
+    free(taps);
+
+  if (!ok)
+    suscan_source_decimator_finalize(self);
+
+  return ok;
 }
 
-#define ACCUMULATE(val) \
-  self->accums[val] += data[i] * (self->antialias[self->ptrs[val]++])
-#define IF_DONE_PRODUCE_SAMPLE(val) \
-    if (self->ptrs[val] == self->decim_length) { \
-      self->decim_buf[samples++] = self->accums[val]; \
-      self->accums[val] = self->ptrs[val] = 0; \
-      if (samples >= SUSCAN_SOURCE_DECIMATOR_BUFFER_SIZE) \
-        break; \
-    }
+void
+suscan_source_decimator_finalize(struct suscan_source_decimator *self)
+{
+  if (self->taps != NULL)
+    free(self->taps);
+
+  if (self->hist != NULL)
+    free(self->hist);
 
-SUPRIVATE SUSCOUNT
-suscan_source_feed_decimator(
-    suscan_source_t *self,
-    const SUCOMPLEX *data,
+  memset(self, 0, sizeof(struct suscan_source_decimator));
+}
+
+SUINLINE SUCOMPLEX
+suscan_source_decimator_dot(
+    const SUFLOAT *taps,
+    const SUCOMPLEX *window,
+    int length)
+{
+  const SUFLOAT *x = (const SUFLOAT *) window;
+  SUFLOAT acc[2 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN] = {0};
+  int i, j;
+
+  for (i = 0; i < 2 * length; i += 2 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN)
+    for (j = 0; j < 2 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN; ++j)
+      acc[j] += taps[i + j] * x[i + j];
+
+  for (j = 2; j < 2 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN; j += 2) {
+    acc[0] += acc[j];
+    acc[1] += acc[j + 1];
+  }
+
+  return acc[0] + I * acc[1];
+}
+
+/*
+ * Always inlined with a constant length for the short filters of small
+ * decimations, where setting up and reducing the accumulators would
+ * otherwise cost as much as the dot product itself.
+ */
+SUINLINE SUSCOUNT
+suscan_source_decimator_run(
+    const struct suscan_source_decimator *self,
+    const SUCOMPLEX *hist,
+    SUSCOUNT hist_len,
+    int length,
+    SUCOMPLEX *out,
+    SUSCOUNT *next)
+{
+  SUSCOUNT i, samples = 0;
+
+  for (i = 0; i + length <= hist_len; i += self->decim)
+    out[samples++] = suscan_source_decimator_dot(self->taps, hist + i, length);
+
+  *next = i;
+
+  return samples;
+}
+
+/*
+ * Decimates len samples from data, in place. Returns the number of
+ * output samples left at the beginning of data.
+ */
+SUSCOUNT
+suscan_source_decimator_feed(
+    struct suscan_source_decimator *self,
+    SUCOMPLEX *data,
     SUSCOUNT len)
 {
-  SUSCOUNT samples = 0;
-  SUSCOUNT i;
+  SUCOMPLEX *hist = self->hist;
+  SUSCOUNT hist_len = self->hist_len;
+  SUSCOUNT chunk, next, i = 0, samples = 0;
+
+  while (i < len) {
+    chunk = MIN(len - i, SUSCAN_SOURCE_DECIMATOR_CHUNK_SIZE);
+    memcpy(hist + hist_len, data + i, chunk * sizeof(SUCOMPLEX));
+    hist_len += chunk;
+    i += chunk;
+
+    /*
+     * Outputs never overtake the input: there are at most (i - 1) / decim
+     * + 1 outputs so far, all of them stored below data + i.
+     */
+    switch (self->length) {
+      case 3 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN: /* Decim 2 */
+        samples += suscan_source_decimator_run(
+          self,
+          hist,
+          hist_len,
+          3 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN,
+          data + samples,
+          &next);
+        break;
 
-  /* Loop unrolling. I'm sorry. */
+      case 4 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN: /* Decim 3 */
+        samples += suscan_source_decimator_run(
+          self,
+          hist,
+          hist_len,
+          4 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN,
+          data + samples,
+          &next);
+        break;
+
+      case 5 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN: /* Decim 4 */
+        samples += suscan_source_decimator_run(
+          self,
+          hist,
+          hist_len,
+          5 * SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN,
+          data + samples,
+          &next);
+        break;
 
-  for (i = 0; i < len; ++i) {
-    ACCUMULATE(0);
-    ACCUMULATE(1);
-    ACCUMULATE(2);
-    ACCUMULATE(3);
-    ACCUMULATE(4);
+      default:
+        samples += suscan_source_decimator_run(
+          self,
+          hist,
+          hist_len,
+          self->length,
+          data + samples,
+          &next);
+    }
 
-    IF_DONE_PRODUCE_SAMPLE(0)
-    else IF_DONE_PRODUCE_SAMPLE(1)
-    else IF_DONE_PRODUCE_SAMPLE(2)
-    else IF_DONE_PRODUCE_SAMPLE(3)
-    else IF_DONE_PRODUCE_SAMPLE(4)
+    /* Keep the part of the delay line the next window starts at */
+    hist_len -= next;
+    memmove(hist, hist + next, hist_len * sizeof(SUCOMPLEX));
   }
 
+  self->hist_len = hist_len;
+
   return samples;
 }
 
-#undef ACCUMULATE
-#undef IF_DONE_PRODUCE_SAMPLE
+#ifdef SUSCAN_SOURCE_USE_MMAP
+/*
+ * Raw IQ recordings are little-endian interleaved samples with no header,
+ * so once libsndfile told us the format, we can map the file and convert
+ * samples straight from the page cache.
+ */
+SUPRIVATE SUBOOL
+suscan_source_open_file_mmap(suscan_source_t *self)
+{
+  struct stat sbuf;
+  void *map = MAP_FAILED;
+  int fd = -1;
+  SUBOOL ok = SU_FALSE;
+
+  if ((self->sf_info.format & SF_FORMAT_TYPEMASK) != SF_FORMAT_RAW
+      || self->sf_info.channels != 2)
+    return SU_FALSE;
+
+  /* Same normalization as libsndfile */
+  switch (self->sf_info.format & SF_FORMAT_SUBMASK) {
+    case SF_FORMAT_FLOAT:
+#ifdef _SU_SINGLE_PRECISION
+      self->stream_format    = SUSCAN_SOURCE_STREAM_FORMAT_FLOAT;
+#else
+      self->stream_format    = SUSCAN_SOURCE_STREAM_FORMAT_CF32;
+#endif /* _SU_SINGLE_PRECISION */
+      self->stream_sample_size = 2 * sizeof(float);
+      self->stream_scale       = 1;
+      break;
+
+    case SF_FORMAT_PCM_16:
+      self->stream_format      = SUSCAN_SOURCE_STREAM_FORMAT_CS16;
+      self->stream_sample_size = 2 * sizeof(int16_t);
+      self->stream_scale       = 1. / 32768;
+      break;
+
+    case SF_FORMAT_PCM_S8:
+      self->stream_format      = SUSCAN_SOURCE_STREAM_FORMAT_CS8;
+      self->stream_sample_size = 2 * sizeof(int8_t);
+      self->stream_scale       = 1. / 128;
+      break;
+
+    case SF_FORMAT_PCM_U8:
+      self->stream_format      = SUSCAN_SOURCE_STREAM_FORMAT_CU8;
+      self->stream_sample_size = 2 * sizeof(uint8_t);
+      self->stream_scale       = 1. / 128;
+      break;
+
+    default:
+      return SU_FALSE;
+  }
+
+  if ((fd = open(self->config->path, O_RDONLY)) == -1)
+    goto done;
+
+  if (fstat(fd, &sbuf) == -1 
+    || (size_t) sbuf.st_size < self->stream_sample_size)
+    goto done;
+
+  if ((map = mmap(NULL, sbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) 
+    == MAP_FAILED) {
+    SU_WARNING(
+      "Cannot map %s (%s), falling back to libsndfile\n",
+      self->config->path,
+      strerror(errno));
+    goto done;
+  }
+
+  (void) madvise(map, sbuf.st_size, MADV_SEQUENTIAL);
+
+  self->map         = map;
+  self->map_size    = sbuf.st_size;
+  self->map_samples = self->map_size / self->stream_sample_size;
+  self->map_pos     = 0;
+
+  ok = SU_TRUE;
+
+done:
+  if (fd != -1)
+    close(fd);
+
+  if (!ok) {
+    self->stream_format      = SUSCAN_SOURCE_STREAM_FORMAT_FLOAT;
+    self->stream_sample_size = sizeof(SUCOMPLEX);
+    self->stream_scale       = 1;
+  }
+
+  return ok;
+}
+#endif /* SUSCAN_SOURCE_USE_MMAP */
 
 SUPRIVATE SUBOOL
 suscan_source_open_file(suscan_source_t *self)
@@ -1734,6 +2521,14 @@ suscan_source_open_file(suscan_source_t *self)
     &self->sf_info)) != NULL) {
     self->config->samp_rate = self->samp_rate = self->sf_info.samplerate;
     self->iq_file   = self->sf_info.channels == 2;
+
+#ifdef SUSCAN_SOURCE_USE_MMAP
+    if (suscan_source_open_file_mmap(self)) {
+      sf_close(self->sf);
+      self->sf = NULL;
+      return SU_TRUE;
+    }
+#endif /* SUSCAN_SOURCE_USE_MMAP */
   }
 
   return self->sf != NULL;
@@ -1783,11 +2578,66 @@ done:
   return ok;
 }
 
+/*
+ * Request the native sample format of the device if it is one of the
+ * integer formats we know how to convert. This saves the driver-side
+ * conversion and halves (or quarters) the memory traffic of the stream.
+ */
+SUPRIVATE const char *
+suscan_source_negotiate_stream_format(suscan_source_t *source)
+{
+  char *native;
+  double full_scale = 0;
+  const char *fmt = SUSCAN_SOAPY_SAMPFMT;
+
+  source->stream_format      = SUSCAN_SOURCE_STREAM_FORMAT_FLOAT;
+  source->stream_sample_size = sizeof(SUCOMPLEX);
+  source->stream_scale       = 1;
+
+  native = SoapySDRDevice_getNativeStreamFormat(
+    source->sdr,
+    SOAPY_SDR_RX,
+    source->config->channel,
+    &full_scale);
+
+  if (native == NULL)
+    return fmt;
+
+  if (full_scale > 0) {
+    if (strcmp(native, SOAPY_SDR_CS16) == 0) {
+      source->stream_format      = SUSCAN_SOURCE_STREAM_FORMAT_CS16;
+      source->stream_sample_size = 2 * sizeof(int16_t);
+      fmt = SOAPY_SDR_CS16;
+    } else if (strcmp(native, SOAPY_SDR_CS8) == 0) {
+      source->stream_format      = SUSCAN_SOURCE_STREAM_FORMAT_CS8;
+      source->stream_sample_size = 2 * sizeof(int8_t);
+      fmt = SOAPY_SDR_CS8;
+    } else if (strcmp(native, SOAPY_SDR_CU8) == 0) {
+      source->stream_format      = SUSCAN_SOURCE_STREAM_FORMAT_CU8;
+      source->stream_sample_size = 2 * sizeof(uint8_t);
+      fmt = SOAPY_SDR_CU8;
+    }
+
+    if (source->stream_format != SUSCAN_SOURCE_STREAM_FORMAT_FLOAT) {
+      source->stream_scale = 1. / full_scale;
+      SU_INFO(
+        "Using native stream format %s (full scale: %g)\n",
+        native,
+        full_scale);
+    }
+  }
+
+  free(native);
+
+  return fmt;
+}
+
 SUPRIVATE SUBOOL
 suscan_source_open_sdr(suscan_source_t *source)
 {
   unsigned int i;
   char *antenna = NULL;
+  const char *fmt;
 
   if ((source->sdr = SoapySDRDevice_make(source->config->soapy_args)) == NULL) {
     SU_ERROR("Failed to open SDR device: %s\n", SoapySDRDevice_lastError());
@@ -1888,12 +2738,14 @@ suscan_source_open_sdr(suscan_source_t *source)
   /* All set: open SoapySDR stream */
   source->chan_array[0] = source->config->channel;
 
+  fmt = suscan_source_negotiate_stream_format(source);
+
 #if SOAPY_SDR_API_VERSION < 0x00080000
   if (SoapySDRDevice_setupStream(
       source->sdr,
       &source->rx_stream,
       SOAPY_SDR_RX,
-      SUSCAN_SOAPY_SAMPFMT,
+      fmt,
       source->chan_array,
       1,
       NULL) != 0) {
@@ -1901,7 +2753,7 @@ suscan_source_open_sdr(suscan_source_t *source)
   if ((source->rx_stream = SoapySDRDevice_setupStream(
       source->sdr,
       SOAPY_SDR_RX,
-      SUSCAN_SOAPY_SAMPFMT,
+      fmt,
       source->chan_array,
       1,
       NULL)) == NULL) {
@@ -1916,6 +2768,14 @@ suscan_source_open_sdr(suscan_source_t *source)
       source->sdr,
       source->rx_stream);
 
+  if (source->mtu == 0)
+    source->mtu = SUSCAN_SOURCE_DEFAULT_BUFSIZ;
+
+  if (source->stream_format != SUSCAN_SOURCE_STREAM_FORMAT_FLOAT)
+    SU_TRYCATCH(
+      source->native_buf = malloc(source->mtu * source->stream_sample_size),
+      return SU_FALSE);
+
   source->samp_rate = SoapySDRDevice_getSampleRate(
       source->sdr,
       SOAPY_SDR_RX,
@@ -1969,6 +2829,9 @@ suscan_source_read_file(suscan_source_t *self, SUCOMPLEX *buf, SUSCOUNT max)
     } else {
       got >>= 1;
     }
+
+    if (self->iq_rev)
+      suscan_source_convert_samples(self, buf, buf, got);
   }
 
   return got;
@@ -2027,14 +2890,78 @@ suscan_source_max_size_file(const struct suscan_source *self)
   return self->sf_info.frames;
 }
 
+#ifdef SUSCAN_SOURCE_USE_MMAP
+SUPRIVATE SUSDIFF
+suscan_source_read_mmap(suscan_source_t *self, SUCOMPLEX *buf, SUSCOUNT max)
+{
+  SUSCOUNT avail;
+
+  if (self->force_eos)
+    return 0;
+
+  if (self->map_pos >= self->map_samples) {
+    if (!self->config->loop)
+      return 0;
+
+    self->map_pos       = 0;
+    self->looped        = SU_TRUE;
+    self->total_samples = 0;
+  }
+
+  avail = self->map_samples - self->map_pos;
+  if (max > avail)
+    max = avail;
+
+  suscan_source_import_samples(
+    self,
+    buf,
+    self->map + self->map_pos * self->stream_sample_size,
+    max);
+
+  self->map_pos += max;
+
+  return max;
+}
+
+SUPRIVATE SUBOOL
+suscan_source_seek_mmap(struct suscan_source *self, SUSCOUNT pos)
+{
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t offset, length;
+
+  if (pos > self->map_samples)
+    return SU_FALSE;
+
+  self->map_pos       = pos;
+  self->total_samples = pos;
+
+  /* Start reading ahead from the new position */
+  offset = (pos * self->stream_sample_size) & ~(page - 1);
+  length = MIN(self->map_size - offset, SUSCAN_SOURCE_MMAP_READAHEAD);
+  if (length > 0)
+    (void) madvise((void *) (self->map + offset), length, MADV_WILLNEED);
+
+  return SU_TRUE;
+}
+#endif /* SUSCAN_SOURCE_USE_MMAP */
+
 SUPRIVATE SUSDIFF
 suscan_source_read_sdr(suscan_source_t *source, SUCOMPLEX *buf, SUSCOUNT max)
 {
+  void *data = buf;
   int result;
   int flags;
   long long timeNs;
+  SUBOOL overflow = SU_FALSE;
   SUBOOL retry;
 
+  /* Integer formats are read first into the native buffer */
+  if (source->native_buf != NULL) {
+    data = source->native_buf;
+    if (max > source->mtu)
+      max = source->mtu;
+  }
+
   do {
     retry = SU_FALSE;
     if (source->force_eos)
@@ -2043,7 +2970,7 @@ suscan_source_read_sdr(suscan_source_t *source, SUCOMPLEX *buf, SUSCOUNT max)
       result = SoapySDRDevice_readStream(
           source->sdr,
           source->rx_stream,
-          (void * const*) &buf,
+          (void * const*) &data,
           max,
           &flags,
           &timeNs,
@@ -2053,6 +2980,8 @@ suscan_source_read_sdr(suscan_source_t *source, SUCOMPLEX *buf, SUSCOUNT max)
         || result == SOAPY_SDR_OVERFLOW
         || result == SOAPY_SDR_UNDERFLOW) {
       /* We should use this statuses as quality indicators */
+      if (result == SOAPY_SDR_OVERFLOW)
+        overflow = SU_TRUE;
       retry = SU_TRUE;
     }
   } while (retry);
@@ -2065,14 +2994,52 @@ suscan_source_read_sdr(suscan_source_t *source, SUCOMPLEX *buf, SUSCOUNT max)
     return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
   }
 
+  if (result > 0) {
+    suscan_source_clock_update(source, flags, timeNs, 0, overflow);
+    suscan_source_clock_advance(source, result);
+  }
+
+  suscan_source_import_samples(source, buf, data, result);
+
   return result;
 }
 
+/*
+ * Time of the next sample to be read. This is pure arithmetic on the
+ * stream clock, so it is safe to call it from the processing threads as
+ * often as needed.
+ */
 SUPRIVATE void
 suscan_source_time_sdr(struct suscan_source *source, struct timeval *tv)
 {
-  /* TODO: Adjust sampling delay? */
-  gettimeofday(tv, NULL);
+  struct timeval elapsed, skew;
+  uint64_t samples;
+  long long skew_ns;
+  SUFLOAT  residual;
+
+  if (!__atomic_load_n(&source->clock_anchored, __ATOMIC_ACQUIRE)) {
+    gettimeofday(tv, NULL);
+    return;
+  }
+
+  samples = __atomic_load_n(&source->clock_samples, __ATOMIC_RELAXED);
+
+  elapsed.tv_sec  = samples / source->samp_rate;
+  residual        = samples - elapsed.tv_sec * (double) source->samp_rate;
+  elapsed.tv_usec = 1e6 * residual / source->samp_rate;
+
+  timeradd(&source->clock_epoch, &elapsed, tv);
+
+  skew_ns = __atomic_load_n(&source->clock_skew_ns, __ATOMIC_RELAXED);
+  if (skew_ns != 0) {
+    skew.tv_sec  = llabs(skew_ns) / 1000000000;
+    skew.tv_usec = (llabs(skew_ns) % 1000000000) / 1000;
+
+    if (skew_ns > 0)
+      timeradd(tv, &skew, tv);
+    else
+      timersub(tv, &skew, tv);
+  }
 }
 
 SUSDIFF
@@ -2090,17 +3057,12 @@ suscan_source_read(suscan_source_t *self, SUCOMPLEX *buffer, SUSCOUNT max)
   }
 
   if (self->decim > 1) {
-    if (max > SUSCAN_SOURCE_DECIMATOR_BUFFER_SIZE)
-      max = SUSCAN_SOURCE_DECIMATOR_BUFFER_SIZE;
-
     do {
       if ((got = (self->read) (self, buffer, max)) < 1)
         return got;
       self->total_samples += got;
-      result = suscan_source_feed_decimator(self, buffer, got);
+      result = suscan_source_decimator_feed(&self->decimator, buffer, got);
     } while (result == 0);
-
-    memcpy(buffer, self->decim_buf, result * sizeof(SUCOMPLEX));
   } else {
     result = (self->read) (self, buffer, max);
     if (result > 0)
@@ -2155,6 +3117,8 @@ suscan_source_start_capture(suscan_source_t *source)
   }
 
   if (source->config->type == SUSCAN_SOURCE_TYPE_SDR) {
+    suscan_source_clock_reset(source);
+
     if (SoapySDRDevice_activateStream(
         source->sdr,
         source->rx_stream,
@@ -2164,6 +3128,15 @@ suscan_source_start_capture(suscan_source_t *source)
       SU_ERROR("Failed to activate stream: %s\n", SoapySDRDevice_lastError());
       return SU_FALSE;
     }
+
+    if (source->ring != NULL && !suscan_source_start_capture_thread(source)) {
+      (void) SoapySDRDevice_deactivateStream(
+        source->sdr,
+        source->rx_stream,
+        0,
+        0);
+      return SU_FALSE;
+    }
   }
 
   source->capturing = SU_TRUE;
@@ -2180,6 +3153,8 @@ suscan_source_stop_capture(suscan_source_t *source)
   }
 
   if (source->config->type == SUSCAN_SOURCE_TYPE_SDR) {
+    suscan_source_stop_capture_thread(source);
+
     if (SoapySDRDevice_deactivateStream(
         source->sdr,
         source->rx_stream,
@@ -2227,7 +3202,13 @@ suscan_source_set_dc_remove(suscan_source_t *source, SUBOOL remove)
   if (source->config->type == SUSCAN_SOURCE_TYPE_FILE)
     return SU_FALSE;
 
-  if (SoapySDRDevice_setDCOffsetMode(
+  if (!SoapySDRDevice_hasDCOffsetMode(
+      source->sdr,
+      SOAPY_SDR_RX,
+      source->config->channel)) {
+    source->soft_dc_correction = remove;
+    source->dc_offset = 0;
+  } else if (SoapySDRDevice_setDCOffsetMode(
       source->sdr,
       SOAPY_SDR_RX,
       0,
@@ -2235,10 +3216,18 @@ suscan_source_set_dc_remove(suscan_source_t *source, SUBOOL remove)
       != 0) {
     SU_ERROR("Failed to set DC mode\n");
     return SU_FALSE;
-  } else {
-    source->config->dc_remove = remove;
   }
 
+  source->config->dc_remove = remove;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_source_set_iq_reverse(suscan_source_t *source, SUBOOL rev)
+{
+  source->iq_rev = rev;
+
   return SU_TRUE;
 }
 
@@ -2363,6 +3352,10 @@ suscan_source_set_freq(suscan_source_t *source, SUFREQ freq)
     return SU_FALSE;
   }
 
+  /* Samples captured before the retune are no longer interesting */
+  suscan_source_flush_capture_ring(source);
+  suscan_source_clock_mark_retune(source);
+
   return SU_TRUE;
 }
 
@@ -2424,6 +3417,10 @@ suscan_source_set_lnb_freq(suscan_source_t *source, SUFREQ freq)
     return SU_FALSE;
   }
 
+  /* Samples captured before the retune are no longer interesting */
+  suscan_source_flush_capture_ring(source);
+  suscan_source_clock_mark_retune(source);
+
   return SU_TRUE;
 }
 
@@ -2453,6 +3450,10 @@ suscan_source_set_freq2(suscan_source_t *source, SUFREQ freq, SUFREQ lnb)
     return SU_FALSE;
   }
 
+  /* Samples captured before the retune are no longer interesting */
+  suscan_source_flush_capture_ring(source);
+  suscan_source_clock_mark_retune(source);
+
   return SU_TRUE;
 }
 
@@ -2495,10 +3496,12 @@ suscan_source_new(suscan_source_config_t *config)
 
   new->decim = 1;
 
-  if (config->average > 1)
+  if (config->average > 1) {
+    new->decim = config->average;
     SU_TRYCATCH(
-        suscan_source_configure_decimation(new, config->average),
+        suscan_source_decimator_init(&new->decimator, config->average),
         goto fail);
+  }
 
   switch (new->config->type) {
     case SUSCAN_SOURCE_TYPE_FILE:
@@ -2507,6 +3510,12 @@ suscan_source_new(suscan_source_config_t *config)
       new->get_time = suscan_source_get_time_file;
       new->seek     = suscan_source_seek_file;
       new->max_size = suscan_source_max_size_file;
+#ifdef SUSCAN_SOURCE_USE_MMAP
+      if (new->map != NULL) {
+        new->read = suscan_source_read_mmap;
+        new->seek = suscan_source_seek_mmap;
+      }
+#endif /* SUSCAN_SOURCE_USE_MMAP */
       break;
 
     case SUSCAN_SOURCE_TYPE_SDR:
@@ -26,6 +26,7 @@ extern "C" {
 
 #include <sndfile.h>
 #include <string.h>
+#include <pthread.h>
 #include <sigutils/sigutils.h>
 #include <SoapySDR/Device.h>
 #include <SoapySDR/Formats.h>
@@ -49,7 +50,9 @@ extern "C" {
 #define SUSCAN_SOURCE_DEFAULT_BANDWIDTH SUSCAN_SOURCE_DEFAULT_SAMP_RATE
 #define SUSCAN_SOURCE_DEFAULT_READ_TIMEOUT 100000 /* 100 ms */
 #define SUSCAN_SOURCE_ANTIALIAS_REL_SIZE    5
-#define SUSCAN_SOURCE_DECIMATOR_BUFFER_SIZE 512
+#define SUSCAN_SOURCE_DECIMATOR_CHUNK_SIZE  4096
+#define SUSCAN_SOURCE_DECIMATOR_TAP_ALIGN   4 /* Taps per kernel iteration */
+#define SUSCAN_SOURCE_CAPTURE_RING_MIN_DEPTH 2
 
 /************************** Source config API ********************************/
 struct suscan_source_gain_desc {
@@ -474,12 +477,83 @@ SUBOOL suscan_source_config_unregister(suscan_source_config_t *config);
 
 void suscan_source_config_destroy(suscan_source_config_t *);
 
+/**************************** Antialias decimator ****************************/
+/*
+ * Block FIR decimator of the source. Only the outputs it keeps are
+ * computed: every decim input samples, one dot product of the whole
+ * antialias filter against a contiguous window of the delay line.
+ */
+struct suscan_source_decimator {
+  SUFLOAT   *taps;     /* Interleaved (I/Q) taps, zero-padded */
+  SUCOMPLEX *hist;     /* Delay line followed by an input chunk */
+  SUSCOUNT   hist_len; /* Samples in the delay line */
+  int        decim;
+  int        length;   /* Padded filter length */
+};
+
+SUBOOL suscan_source_decimator_init(
+  struct suscan_source_decimator *self,
+  int decim);
+
+SUSCOUNT suscan_source_decimator_feed(
+  struct suscan_source_decimator *self,
+  SUCOMPLEX *data,
+  SUSCOUNT len);
+
+void suscan_source_decimator_finalize(struct suscan_source_decimator *self);
+
 /****************************** Source API ***********************************/
+/*
+ * SDR sources may run an optional capture thread that does nothing but
+ * calling readStream into a ring of MTU-sized blocks. The analyzer
+ * consumes samples from the ring, so that DSP hiccups do not stall the
+ * device reader.
+ */
+struct suscan_source_capture_block {
+  void        *data;    /* Samples, in the stream format of the source */
+  SUSCOUNT     size;
+  unsigned int epoch;   /* Blocks from older epochs are discarded */
+  int          flags;   /* As returned by readStream */
+  long long    time_ns; /* Hardware timestamp (if SOAPY_SDR_HAS_TIME) */
+  SUSCOUNT     dropped; /* Samples dropped right before this block */
+  SUBOOL       overflow; /* Driver overflowed right before this block */
+};
+
+struct suscan_source_capture_stats {
+  unsigned int depth;      /* Ring size, in blocks */
+  unsigned int used;       /* Blocks waiting to be consumed */
+  unsigned int high_water; /* Largest number of blocks ever waiting */
+  SUSCOUNT     block_size; /* Samples per block */
+  uint64_t     overflows;  /* Overflows reported by the device */
+  uint64_t     dropped;    /* Samples dropped because the ring was full */
+};
+
+/*
+ * Sample formats in which SDR streams can be opened. Integer formats are
+ * requested when the device advertises them as native, and are converted
+ * to SUCOMPLEX by the source itself (along with DC removal and IQ
+ * reversal, in the same pass).
+ */
+enum suscan_source_stream_format {
+  SUSCAN_SOURCE_STREAM_FORMAT_FLOAT,
+  SUSCAN_SOURCE_STREAM_FORMAT_CF32,  /* Only if SUFLOAT is not float */
+  SUSCAN_SOURCE_STREAM_FORMAT_CS16,
+  SUSCAN_SOURCE_STREAM_FORMAT_CS8,
+  SUSCAN_SOURCE_STREAM_FORMAT_CU8
+};
+
+#define SUSCAN_SOURCE_DC_REMOVE_ALPHA 1e-2
+#define SUSCAN_SOURCE_MMAP_READAHEAD  (4 << 20) /* Bytes, after seeking */
+#define SUSCAN_SOURCE_CLOCK_TOLERANCE 2 /* Samples of timestamp jitter */
+#define SUSCAN_SOURCE_CLOCK_WALL_TOLERANCE 5e-3 /* Seconds of read latency */
+#define SUSCAN_SOURCE_CLOCK_ALIGN_INTERVAL 10   /* Seconds of stream */
+
 struct suscan_source {
   suscan_source_config_t *config; /* Source may alter configuration! */
   SUBOOL   capturing;
   SUBOOL   soft_dc_correction;
   SUBOOL   soft_iq_balance;
+  SUBOOL   iq_rev;
   SUBOOL   looped;
   SUSCOUNT total_samples;
   SUSCOUNT seek_request;
@@ -504,6 +578,12 @@ struct suscan_source {
   SF_INFO sf_info;
   SUBOOL iq_file;
 
+  /* Raw IQ files are memory-mapped if possible, bypassing libsndfile */
+  const uint8_t *map;
+  size_t         map_size;    /* In bytes */
+  SUSCOUNT       map_samples;
+  SUSCOUNT       map_pos;
+
   /* SDR sources are accessed through SoapySDR */
   SoapySDRDevice *sdr;
   SoapySDRStream *rx_stream;
@@ -511,17 +591,60 @@ struct suscan_source {
   SUFLOAT samp_rate; /* Actual sample rate */
   size_t mtu;
 
+  /* Stream format and conversion state */
+  enum suscan_source_stream_format stream_format;
+  size_t    stream_sample_size; /* Bytes per complex sample */
+  SUFLOAT   stream_scale;       /* Inverse of the device full scale */
+  void     *native_buf;         /* Integer samples, before conversion */
+  SUCOMPLEX dc_offset;          /* Software DC removal estimate */
+
+  /* Capture thread (SDR sources only, optional) */
+  struct suscan_source_capture_block *ring;
+  uint8_t        *ring_alloc;
+  void           *ring_scratch;     /* Where samples go when the ring is full */
+  unsigned int    ring_depth;
+  SUSCOUNT        ring_block_size;
+  unsigned int    ring_head;        /* Written by the capture thread only */
+  unsigned int    ring_tail;        /* Written by the consumer only */
+  unsigned int    ring_high_water;
+  SUSCOUNT        ring_offset;      /* Consumed samples of the tail block */
+  unsigned int    ring_epoch;
+  SUBOOL          ring_waiting;
+  pthread_mutex_t ring_mutex;
+  pthread_cond_t  ring_cond;
+  SUBOOL          ring_sync_init;
+  uint64_t        capture_overflows;
+  uint64_t        capture_dropped;
+  int             capture_error;
+  SUBOOL          capture_cancelled;
+  SUBOOL          capture_running;
+  pthread_t       capture_thread;
+
+  /*
+   * Stream clock (SDR sources only). The source time is derived from the
+   * number of device samples elapsed since the first read. Hardware
+   * timestamps, if provided by the driver, are used to find gaps in the
+   * stream, which advance the clock and are accounted as lost samples.
+   * Without them, the clock is periodically re-aligned against the system
+   * time, which is also used to estimate the samples lost in overflows.
+   */
+  SUBOOL         clock_anchored;
+  SUBOOL         clock_hw;       /* Driver provides timestamps */
+  struct timeval clock_epoch;    /* Wall time of the first sample */
+  long long      clock_epoch_ns; /* Hardware time of the first sample */
+  long long      clock_skew_ns;  /* Correction of clock_epoch (no clock_hw) */
+  uint64_t       clock_samples;  /* Device samples since the first one */
+  uint64_t       clock_aligned;  /* clock_samples at the last re-alignment */
+  uint64_t       samples_lost;
+  uint64_t       retune_sample;  /* First sample after the last retune */
+  SUBOOL         retune_timed;   /* retune_sample comes from hardware time */
+
   /* To prevent source from looping forever */
   SUBOOL force_eos;
 
   /* Downsampling members */
-  SUFLOAT *antialias_alloc;
-  const SUFLOAT *antialias;
-  SUCOMPLEX accums[SUSCAN_SOURCE_ANTIALIAS_REL_SIZE];
-  SUCOMPLEX *decim_buf;
-  int ptrs[SUSCAN_SOURCE_ANTIALIAS_REL_SIZE];
   int decim;
-  int decim_length;
+  struct suscan_source_decimator decimator;
 };
 
 typedef struct suscan_source suscan_source_t;
@@ -531,6 +654,7 @@ SUBOOL suscan_source_start_capture(suscan_source_t *source);
 
 SUBOOL suscan_source_set_agc(suscan_source_t *source, SUBOOL set);
 SUBOOL suscan_source_set_dc_remove(suscan_source_t *source, SUBOOL remove);
+SUBOOL suscan_source_set_iq_reverse(suscan_source_t *source, SUBOOL rev);
 SUBOOL suscan_source_set_freq(suscan_source_t *source, SUFREQ freq);
 SUBOOL suscan_source_set_ppm(suscan_source_t *source, SUFLOAT ppm);
 SUBOOL suscan_source_set_lnb_freq(suscan_source_t *source, SUFREQ freq);
@@ -680,6 +804,60 @@ suscan_source_is_capturing(const suscan_source_t *src)
   return src->capturing;
 }
 
+SUINLINE SUBOOL
+suscan_source_has_capture_thread(const suscan_source_t *src)
+{
+  return src->ring != NULL;
+}
+
+SUINLINE enum suscan_source_stream_format
+suscan_source_get_stream_format(const suscan_source_t *src)
+{
+  return src->stream_format;
+}
+
+SUINLINE SUBOOL
+suscan_source_has_hw_time(const suscan_source_t *src)
+{
+  return src->clock_anchored && src->clock_hw;
+}
+
+/* Device samples elapsed since capture started (gaps included) */
+SUINLINE uint64_t
+suscan_source_get_clock_samples(const suscan_source_t *src)
+{
+  return __atomic_load_n(&src->clock_samples, __ATOMIC_RELAXED);
+}
+
+/*
+ * Device sample from which the stream reflects the last retune. If the
+ * device has no hardware clock, this is the position of the stream at the
+ * time of the retune (and samples still buffered by the driver may be
+ * stale). Returns SU_TRUE only if the sample was found by hardware time.
+ */
+SUINLINE SUBOOL
+suscan_source_get_retune_sample(const suscan_source_t *src, uint64_t *sample)
+{
+  *sample = src->retune_sample;
+  return src->retune_timed;
+}
+
+/* Samples found missing in the stream since capture started */
+SUINLINE uint64_t
+suscan_source_get_samples_lost(const suscan_source_t *src)
+{
+  return __atomic_load_n(&src->samples_lost, __ATOMIC_RELAXED);
+}
+
+/* Must be called before suscan_source_start_capture */
+SUBOOL suscan_source_set_capture_ring(
+  suscan_source_t *source,
+  unsigned int depth);
+
+void suscan_source_get_capture_stats(
+  const suscan_source_t *source,
+  struct suscan_source_capture_stats *stats);
+
 void suscan_source_destroy(suscan_source_t *config);
 
 SUBOOL suscan_source_config_register(suscan_source_config_t *config);
@@ -22,6 +22,7 @@
 #define SU_LOG_DOMAIN "spectsrc"
 
 #include "spectsrc.h"
+#include "bufpool.h"
 #include <sigutils/taps.h>
 
 PTR_LIST_CONST(struct suscan_spectsrc_class, spectsrc_class);
@@ -112,7 +113,7 @@ suscan_spectsrc_new(
   new->userdata = userdata;
 
   if (classdef->preproc != NULL) {
-    SU_TRYCATCH(new->buffer = malloc(size * sizeof(SUCOMPLEX)), goto fail);
+    SU_TRYCATCH(new->buffer = suscan_buffer_alloc(size), goto fail);
     new->buffer_size = size;
   }
 
@@ -186,7 +187,7 @@ suscan_spectsrc_destroy(suscan_spectsrc_t *self)
     (self->classptr->dtor) (self->privdata);
 
   if (self->buffer != NULL)
-    free(self->buffer);
+    suscan_buffer_return(self->buffer);
 
   if (self->smooth_psd != NULL)
     su_smoothpsd_destroy(self->smooth_psd);
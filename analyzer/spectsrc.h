@@ -89,6 +89,47 @@ SUSCOUNT suscan_spectsrc_feed(
 
 void suscan_spectsrc_destroy(suscan_spectsrc_t *src);
 
+/* Preprocessing kernels (in place). Stateful ones return the new state */
+void suscan_spectsrc_kernel_exp(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    unsigned int order_log2,
+    SUFLOAT gain);
+
+SUCOMPLEX suscan_spectsrc_kernel_diff(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUCOMPLEX prev);
+
+SUCOMPLEX suscan_spectsrc_kernel_absdiff(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUCOMPLEX prev);
+
+SUCOMPLEX suscan_spectsrc_kernel_conjmul(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUCOMPLEX prev,
+    SUFLOAT gain);
+
+SUCOMPLEX suscan_spectsrc_kernel_phasediff(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUCOMPLEX prev,
+    SUFLOAT gain);
+
+void suscan_spectsrc_kernel_arg(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUFLOAT gain);
+
+/* Expects a real buffer (i.e. the output of phasediff) */
+SUFLOAT suscan_spectsrc_kernel_realdiff(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUFLOAT prev,
+    SUFLOAT gain);
+
 SUBOOL suscan_spectsrc_psd_register(void);
 SUBOOL suscan_spectsrc_cyclo_register(void);
 SUBOOL suscan_spectsrc_fmcyclo_register(void);
@@ -39,17 +39,8 @@ suscan_spectsrc_cyclo_preproc(
     SUSCOUNT size)
 {
   SUCOMPLEX *last = (SUCOMPLEX *) private;
-  SUCOMPLEX prev = *last;
-  SUCOMPLEX diff;
-  SUSCOUNT i;
 
-  for (i = 0; i < size; ++i) {
-    diff = buffer[i] * SU_C_CONJ(prev);
-    prev = buffer[i];
-    buffer[i] = SU_CYCLO_GAIN * diff;
-  }
-
-  *last = prev;
+  *last = suscan_spectsrc_kernel_conjmul(buffer, size, *last, SU_CYCLO_GAIN);
 
   return SU_TRUE;
 }
@@ -36,10 +36,7 @@ suscan_spectsrc_exp_4_preproc(
     SUCOMPLEX *buffer,
     SUSCOUNT size)
 {
-  SUSCOUNT i;
-
-  for (i = 0; i < size; ++i)
-    buffer[i] = cpow(buffer[i] / (SU_C_ABS(buffer[i]) + 1e-8), 4) / size;
+  suscan_spectsrc_kernel_exp(buffer, size, 2, 1. / size);
 
   return SU_TRUE;
 }
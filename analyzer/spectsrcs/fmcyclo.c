@@ -44,20 +44,18 @@ suscan_spectsrc_fmcyclo_preproc(
     SUSCOUNT size)
 {
   struct fmcyclo_ctx *ctx = (struct fmcyclo_ctx *) private;
-  SUCOMPLEX fm_prev = ctx->fm_prev;
-  SUFLOAT   pd_prev = ctx->pd_prev;
-  SUFLOAT   phase_diff;
-  SUSCOUNT i;
-
-  for (i = 0; i < size; ++i) {
-    phase_diff = SU_C_ARG(buffer[i] * SU_C_CONJ(fm_prev));
-    fm_prev = buffer[i];
-    buffer[i] = FMCYCLO_GAIN * SU_ABS(phase_diff - pd_prev);
-    pd_prev = phase_diff;
-  }
-
-  ctx->fm_prev = fm_prev;
-  ctx->pd_prev = pd_prev;
+
+  ctx->fm_prev = suscan_spectsrc_kernel_phasediff(
+    buffer,
+    size,
+    ctx->fm_prev,
+    1);
+
+  ctx->pd_prev = suscan_spectsrc_kernel_realdiff(
+    buffer,
+    size,
+    ctx->pd_prev,
+    FMCYCLO_GAIN);
 
   return SU_TRUE;
 }
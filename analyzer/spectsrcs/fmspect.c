@@ -39,17 +39,8 @@ suscan_spectsrc_fmspect_preproc(
     SUSCOUNT size)
 {
   SUCOMPLEX *last = (SUCOMPLEX *) private;
-  SUCOMPLEX prev = *last;
-  SUCOMPLEX diff;
-  SUSCOUNT i;
 
-  for (i = 0; i < size; ++i) {
-    diff = SU_C_ARG(buffer[i] * SU_C_CONJ(prev));
-    prev = buffer[i];
-    buffer[i] = FMSPECT_GAIN * diff;
-  }
-
-  *last = prev;
+  *last = suscan_spectsrc_kernel_phasediff(buffer, size, *last, FMSPECT_GAIN);
 
   return SU_TRUE;
 }
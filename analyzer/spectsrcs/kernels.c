@@ -0,0 +1,293 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "spectsrc-kernels"
+
+#include "spectsrc.h"
+
+/*
+ * Preprocessing kernels shared by the spectrum sources. They work on the
+ * buffer as interleaved real / imaginary pairs, with no calls to libm and
+ * no branches in the loop bodies, so that the compiler can vectorize them
+ * for the target ISA. Kernels that depend on the previous sample walk the
+ * buffer backwards, so they can work in place without a carried value.
+ */
+
+#define SUSCAN_SPECTSRC_KERNEL_EPSILON 1e-16 /* Squared magnitude */
+
+/*
+ * Polynomial approximation of atan2. Maximum error is about 2e-6 rad
+ * (see suscli bench suite=kernels), which is well below what a spectrum
+ * display can show.
+ */
+SUINLINE SUFLOAT
+suscan_spectsrc_fast_atan2(SUFLOAT y, SUFLOAT x)
+{
+  SUFLOAT ax = SU_ABS(x);
+  SUFLOAT ay = SU_ABS(y);
+  SUFLOAT mn = ax < ay ? ax : ay;
+  SUFLOAT mx = ax < ay ? ay : ax;
+  SUFLOAT a  = mn / (mx + (SUFLOAT) 1e-30);
+  SUFLOAT s  = a * a;
+  SUFLOAT r;
+
+  r = a * (0.99997726 + s * (-0.33262347 + s * (0.19354346
+      + s * (-0.11643287 + s * (0.05265332 + s * -0.01172120)))));
+
+  r = ay > ax ? (SUFLOAT) (.5 * M_PI) - r : r;
+  r = x < 0   ? (SUFLOAT) M_PI - r : r;
+
+  return y < 0 ? -r : r;
+}
+
+/*
+ * The first squaring normalizes the sample (|z^2| = |z|^2), the rest
+ * raise it to the requested power. Always inlined with a constant order,
+ * so the inner loop is unrolled.
+ */
+SUINLINE void
+suscan_spectsrc_exp_loop(
+    SUFLOAT *x,
+    SUSCOUNT size,
+    unsigned int order_log2,
+    SUFLOAT gain)
+{
+  SUSCOUNT i;
+  unsigned int k;
+  SUFLOAT re, im, t, g;
+
+  for (i = 0; i < size; ++i) {
+    re = x[2 * i];
+    im = x[2 * i + 1];
+    g  = 1 / (re * re + im * im + SUSCAN_SPECTSRC_KERNEL_EPSILON);
+
+    t  = (re * re - im * im) * g;
+    im = 2 * re * im * g;
+    re = t;
+
+    for (k = 1; k < order_log2; ++k) {
+      t  = re * re - im * im;
+      im = 2 * re * im;
+      re = t;
+    }
+
+    x[2 * i]     = gain * re;
+    x[2 * i + 1] = gain * im;
+  }
+}
+
+void
+suscan_spectsrc_kernel_exp(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    unsigned int order_log2,
+    SUFLOAT gain)
+{
+  SUFLOAT *x = (SUFLOAT *) buffer;
+
+  switch (order_log2) {
+    case 1:
+      suscan_spectsrc_exp_loop(x, size, 1, gain);
+      break;
+
+    case 2:
+      suscan_spectsrc_exp_loop(x, size, 2, gain);
+      break;
+
+    case 3:
+      suscan_spectsrc_exp_loop(x, size, 3, gain);
+      break;
+
+    default:
+      suscan_spectsrc_exp_loop(x, size, order_log2, gain);
+  }
+}
+
+SUCOMPLEX
+suscan_spectsrc_kernel_diff(SUCOMPLEX *buffer, SUSCOUNT size, SUCOMPLEX prev)
+{
+  SUFLOAT *x = (SUFLOAT *) buffer;
+  SUCOMPLEX last;
+  SUSCOUNT i;
+
+  if (size == 0)
+    return prev;
+
+  last = buffer[size - 1];
+
+  for (i = 2 * size - 1; i > 1; --i)
+    x[i] -= x[i - 2];
+
+  buffer[0] -= prev;
+
+  return last;
+}
+
+SUCOMPLEX
+suscan_spectsrc_kernel_absdiff(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUCOMPLEX prev)
+{
+  SUFLOAT *x = (SUFLOAT *) buffer;
+  SUCOMPLEX last;
+  SUFLOAT re, im;
+  SUSCOUNT i;
+
+  if (size == 0)
+    return prev;
+
+  last = buffer[size - 1];
+
+  for (i = size - 1; i > 0; --i) {
+    re = x[2 * i]     - x[2 * i - 2];
+    im = x[2 * i + 1] - x[2 * i - 1];
+
+    x[2 * i]     = re * re + im * im;
+    x[2 * i + 1] = 0;
+  }
+
+  re = x[0] - SU_C_REAL(prev);
+  im = x[1] - SU_C_IMAG(prev);
+
+  x[0] = re * re + im * im;
+  x[1] = 0;
+
+  return last;
+}
+
+SUCOMPLEX
+suscan_spectsrc_kernel_conjmul(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUCOMPLEX prev,
+    SUFLOAT gain)
+{
+  SUFLOAT *x = (SUFLOAT *) buffer;
+  SUCOMPLEX last;
+  SUFLOAT re, im, pre, pim;
+  SUSCOUNT i;
+
+  if (size == 0)
+    return prev;
+
+  last = buffer[size - 1];
+
+  for (i = size - 1; i > 0; --i) {
+    re  = x[2 * i];
+    im  = x[2 * i + 1];
+    pre = x[2 * i - 2];
+    pim = x[2 * i - 1];
+
+    x[2 * i]     = gain * (re * pre + im * pim);
+    x[2 * i + 1] = gain * (im * pre - re * pim);
+  }
+
+  re  = x[0];
+  im  = x[1];
+  pre = SU_C_REAL(prev);
+  pim = SU_C_IMAG(prev);
+
+  x[0] = gain * (re * pre + im * pim);
+  x[1] = gain * (im * pre - re * pim);
+
+  return last;
+}
+
+SUCOMPLEX
+suscan_spectsrc_kernel_phasediff(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUCOMPLEX prev,
+    SUFLOAT gain)
+{
+  SUFLOAT *x = (SUFLOAT *) buffer;
+  SUCOMPLEX last;
+  SUFLOAT re, im, pre, pim;
+  SUSCOUNT i;
+
+  if (size == 0)
+    return prev;
+
+  last = buffer[size - 1];
+
+  for (i = size - 1; i > 0; --i) {
+    re  = x[2 * i];
+    im  = x[2 * i + 1];
+    pre = x[2 * i - 2];
+    pim = x[2 * i - 1];
+
+    x[2 * i] = gain * suscan_spectsrc_fast_atan2(
+      im * pre - re * pim,
+      re * pre + im * pim);
+    x[2 * i + 1] = 0;
+  }
+
+  re  = x[0];
+  im  = x[1];
+  pre = SU_C_REAL(prev);
+  pim = SU_C_IMAG(prev);
+
+  x[0] = gain * suscan_spectsrc_fast_atan2(
+    im * pre - re * pim,
+    re * pre + im * pim);
+  x[1] = 0;
+
+  return last;
+}
+
+/*
+ * Not used by pmspect: without -march, it is slower than the carg() loop
+ * it was meant to replace (see suscli bench suite=kernels).
+ */
+void
+suscan_spectsrc_kernel_arg(SUCOMPLEX *buffer, SUSCOUNT size, SUFLOAT gain)
+{
+  SUFLOAT *x = (SUFLOAT *) buffer;
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i) {
+    x[2 * i]     = gain * suscan_spectsrc_fast_atan2(x[2 * i + 1], x[2 * i]);
+    x[2 * i + 1] = 0;
+  }
+}
+
+SUFLOAT
+suscan_spectsrc_kernel_realdiff(
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUFLOAT prev,
+    SUFLOAT gain)
+{
+  SUFLOAT *x = (SUFLOAT *) buffer;
+  SUFLOAT last;
+  SUSCOUNT i;
+
+  if (size == 0)
+    return prev;
+
+  last = x[2 * size - 2];
+
+  for (i = size - 1; i > 0; --i)
+    x[2 * i] = gain * SU_ABS(x[2 * i] - x[2 * i - 2]);
+
+  x[0] = gain * SU_ABS(x[0] - prev);
+
+  return last;
+}
@@ -37,17 +37,8 @@ suscan_spectsrc_timediff_preproc(
     SUSCOUNT size)
 {
   SUCOMPLEX *last = (SUCOMPLEX *) private;
-  SUCOMPLEX prev = *last;
-  SUCOMPLEX diff;
-  SUSCOUNT i;
 
-  for (i = 0; i < size; ++i) {
-    diff = buffer[i] - prev;
-    prev = buffer[i];
-    buffer[i] = diff;
-  }
-
-  *last = prev;
+  *last = suscan_spectsrc_kernel_diff(buffer, size, *last);
 
   return SU_TRUE;
 }
@@ -60,17 +51,8 @@ suscan_spectsrc_abstimediff_preproc(
     SUSCOUNT size)
 {
   SUCOMPLEX *last = (SUCOMPLEX *) private;
-  SUCOMPLEX prev = *last;
-  SUCOMPLEX diff;
-  SUSCOUNT i;
-
-  for (i = 0; i < size; ++i) {
-    diff = buffer[i] - prev;
-    prev = buffer[i];
-    buffer[i] = diff * SU_C_CONJ(diff);
-  }
 
-  *last = prev;
+  *last = suscan_spectsrc_kernel_absdiff(buffer, size, *last);
 
   return SU_TRUE;
 }
@@ -85,16 +85,24 @@ SUPRIVATE void *
 suscan_worker_thread(void *data)
 {
   suscan_worker_t *worker = (suscan_worker_t *) data;
+  struct suscan_msg *batch[SUSCAN_WORKER_BATCH_SIZE];
   struct suscan_msg *msg = NULL;
   struct suscan_worker_callback *cb;
+  unsigned int i = 0, count = 0;
   SUBOOL halt_acked = SU_FALSE;
 
   while (!worker->halt_req) {
-    /* First read: blocking read of a message */
-    if ((msg = suscan_mq_read_msg(&worker->mq_in)) == NULL)
+    /* Blocking read of all pending messages (up to the batch size) */
+    if ((count = suscan_mq_read_batch(
+      &worker->mq_in,
+      batch,
+      SUSCAN_WORKER_BATCH_SIZE,
+      NULL)) == 0)
       break;
 
-    do {
+    for (i = 0; i < count && !worker->halt_req; ++i) {
+      msg = batch[i];
+
       switch (msg->type) {
         case SUSCAN_WORKER_MSG_TYPE_CALLBACK:
           cb = (struct suscan_worker_callback *) msg->privdata;
@@ -110,6 +118,7 @@ suscan_worker_thread(void *data)
 
         case SUSCAN_WORKER_MSG_TYPE_HALT:
           /* Implies halt_req = SU_TRUE */
+          ++i;
           goto done;
 
         default:
@@ -122,16 +131,19 @@ suscan_worker_thread(void *data)
        * ownership of the message anymore.
        */
       msg = NULL;
-
-      /* Next reads: until queue is empty */
-    } while (
-        !worker->halt_req
-        && (msg = suscan_mq_poll_msg(&worker->mq_in)) != NULL);
+    }
   }
 
 done:
   worker->state = SUSCAN_WORKER_STATE_HALTED;
 
+  /*
+   * Messages of this batch we did not process are put back in the queue.
+   * They will be released along with the worker.
+   */
+  if (i < count)
+    suscan_mq_write_msg_batch(&worker->mq_in, batch + i, count - i);
+
   if (worker->halt_req) {
     halt_acked = SU_TRUE;
 
@@ -250,7 +262,7 @@ suscan_worker_new_ex(
   new->mq_out = mq_out;
   new->privdata = private;
 
-  if (!suscan_mq_init(&new->mq_in))
+  if (!suscan_mq_init_ex(&new->mq_in, SUSCAN_MQ_BACKEND_LOCKFREE))
     goto fail;
 
   if (pthread_create(
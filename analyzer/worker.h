@@ -28,6 +28,8 @@
 #define SUSCAN_WORKER_MSG_TYPE_CALLBACK 0
 #define SUSCAN_WORKER_MSG_TYPE_HALT     0xffffffff
 
+#define SUSCAN_WORKER_BATCH_SIZE        32 /* Messages read at once */
+
 enum suscan_worker_state {
   SUSCAN_WORKER_STATE_CREATED,
   SUSCAN_WORKER_STATE_RUNNING,
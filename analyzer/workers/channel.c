@@ -75,6 +75,161 @@ suscan_local_analyzer_process_end(suscan_local_analyzer_t *analyzer)
   }
 }
 
+/*
+ * In free-running mode, we skip the coarse CPU usage estimation and
+ * measure instead the time spent in each stage of the pipeline.
+ */
+SUINLINE uint64_t
+suscan_local_analyzer_free_run_lap(uint64_t *stage_ns, uint64_t since)
+{
+  uint64_t now = suscan_gettime();
+
+  *stage_ns += now - since;
+
+  return now;
+}
+
+SUINLINE SUFLOAT
+suscan_local_analyzer_free_run_msps(uint64_t samples, uint64_t ns)
+{
+  return ns > 0 ? 1e3 * (SUFLOAT) samples / (SUFLOAT) ns : 0;
+}
+
+SUPRIVATE SUBOOL
+suscan_local_analyzer_report_throughput(suscan_local_analyzer_t *self, int code)
+{
+  uint64_t samples = self->free_run_samples;
+  uint64_t wall_ns = 0;
+
+  if (self->free_run_start != 0)
+    wall_ns = suscan_gettime() - self->free_run_start;
+
+  return suscan_analyzer_send_status(
+      self->parent,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
+      code,
+      "End of stream reached: %llu samples in %.3f s (%.3f Msps). "
+      "Stage throughput: read %.3f Msps, baseband %.3f Msps, "
+      "inspectors %.3f Msps (%llu PSD blocks dropped)",
+      (unsigned long long) samples,
+      wall_ns * 1e-9,
+      suscan_local_analyzer_free_run_msps(samples, wall_ns),
+      suscan_local_analyzer_free_run_msps(samples, self->free_run_read_ns),
+      suscan_local_analyzer_free_run_msps(
+        samples, 
+        self->free_run_baseband_ns),
+      suscan_local_analyzer_free_run_msps(
+        samples, 
+        self->free_run_inspector_ns),
+      (unsigned long long) self->psd_dropped);
+}
+
+/*
+ * Sources often deliver less samples than requested (MTU-sized reads,
+ * capture ring blocks, file buffers). We fill the whole block before
+ * processing it, so that the per-block bookkeeping of the channel worker
+ * runs once per block and not once per source read. Errors found after
+ * a partial read are reported in the next call.
+ */
+SUPRIVATE SUSDIFF
+suscan_local_analyzer_read_block(
+    suscan_local_analyzer_t *self,
+    SUCOMPLEX *buf,
+    SUSCOUNT size)
+{
+  SUSCOUNT got = 0;
+  SUSDIFF result;
+
+  while (got < size) {
+    result = suscan_source_read(self->source, buf + got, size - got);
+
+    if (result <= 0)
+      return got > 0 ? (SUSDIFF) got : result;
+
+    got += result;
+  }
+
+  return got;
+}
+
+/******************************* PSD worker **********************************/
+/*
+ * Only the source worker acquires blocks. As long as the pool has more
+ * blocks than the PSD queue depth, there is always a free one.
+ */
+SUPRIVATE struct suscan_local_analyzer_block *
+suscan_local_analyzer_acquire_block(suscan_local_analyzer_t *self)
+{
+  unsigned int i;
+
+  for (i = 0; i < self->block_count; ++i)
+    if (__atomic_load_n(&self->block_pool[i].refcnt, __ATOMIC_ACQUIRE) == 0) {
+      self->block_pool[i].refcnt = 1;
+      return self->block_pool + i;
+    }
+
+  return NULL;
+}
+
+SUINLINE void
+suscan_local_analyzer_release_block(struct suscan_local_analyzer_block *block)
+{
+  (void) __atomic_sub_fetch(&block->refcnt, 1, __ATOMIC_RELEASE);
+}
+
+SUPRIVATE SUBOOL
+suscan_local_analyzer_psd_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  suscan_local_analyzer_t *self = (suscan_local_analyzer_t *) wk_private;
+  struct suscan_local_analyzer_block *block =
+    (struct suscan_local_analyzer_block *) cb_private;
+
+  /* Spectra emitted while feeding this block are stamped with its time */
+  self->psd_block = block;
+
+  if (!su_smoothpsd_feed(self->smooth_psd, block->data, block->size))
+    SU_ERROR("Failed to feed PSD worker\n");
+
+  self->psd_block = NULL;
+
+  suscan_local_analyzer_release_block(block);
+  (void) __atomic_sub_fetch(&self->psd_in_flight, 1, __ATOMIC_RELEASE);
+
+  return SU_FALSE;
+}
+
+/*
+ * The source must never wait for the PSD. If the PSD worker is behind,
+ * the block is simply not queued (and the spectrum skips it).
+ */
+SUPRIVATE SUBOOL
+suscan_local_analyzer_queue_psd(
+    suscan_local_analyzer_t *self,
+    struct suscan_local_analyzer_block *block)
+{
+  if (__atomic_load_n(&self->psd_in_flight, __ATOMIC_ACQUIRE)
+    >= SUSCAN_ANALYZER_PSD_QUEUE_DEPTH) {
+    ++self->psd_dropped;
+    return SU_TRUE;
+  }
+
+  (void) __atomic_add_fetch(&block->refcnt, 1, __ATOMIC_RELAXED);
+  (void) __atomic_add_fetch(&self->psd_in_flight, 1, __ATOMIC_RELAXED);
+
+  if (!suscan_worker_push(
+      self->psd_wk,
+      suscan_local_analyzer_psd_cb,
+      block)) {
+    suscan_local_analyzer_release_block(block);
+    (void) __atomic_sub_fetch(&self->psd_in_flight, 1, __ATOMIC_RELEASE);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
 
 /********************* Related channel analyzer funcs ************************/
 SUPRIVATE SUBOOL
@@ -130,7 +285,9 @@ suscan_local_analyzer_feed_inspectors(
       /*
        * New data has been queued to the existing inspectors. We must
        * ensure that all of them are done by issuing a barrier at the end
-       * of the worker queue.
+       * of the worker queue. In pipelined mode, this just releases the
+       * current window, and we will only block here if all windows are
+       * still being processed.
        */
 
       suscan_inspector_factory_force_sync(self->insp_factory);
@@ -252,6 +409,12 @@ suscan_local_inspector_factory_ctor(suscan_inspector_factory_t *parent, va_list
 
   suscan_inspector_factory_set_mq_out(parent, self->parent->mq_out);
   suscan_inspector_factory_set_mq_ctl(parent, &self->mq_in);
+  suscan_inspector_factory_set_sched_policy(
+    parent,
+    self->parent->params.inspsched_policy);
+  suscan_inspector_factory_set_sched_pipeline_depth(
+    parent,
+    self->parent->params.inspsched_pipeline_depth);
 
   return self;
 }
@@ -487,12 +650,16 @@ suscan_local_analyzer_on_psd(
     unsigned int size)
 {
   suscan_local_analyzer_t *self = (suscan_local_analyzer_t *) userdata;
+  const struct suscan_local_analyzer_block *block = self->psd_block;
+
+  SU_TRYCATCH(block != NULL, return SU_FALSE);
 
   SU_TRYCATCH(
       suscan_analyzer_send_psd_from_smoothpsd(
         self->parent, 
         self->smooth_psd,
-        suscan_source_has_looped(self->source)),
+        block->looped,
+        &block->timestamp),
       return SU_FALSE);
 
   return SU_TRUE;
@@ -503,6 +670,8 @@ suscan_local_analyzer_init_channel_worker(suscan_local_analyzer_t *self)
 {
   struct sigutils_smoothpsd_params sp_params =
       sigutils_smoothpsd_params_INITIALIZER;
+  unsigned int i;
+
   /* Create smooth PSD */
   sp_params.fft_size     = self->parent->params.detector_params.window_size;
   sp_params.samp_rate    = self->effective_samp_rate;
@@ -517,6 +686,89 @@ suscan_local_analyzer_init_channel_worker(suscan_local_analyzer_t *self)
           self),
       return SU_FALSE);
 
+  /* One block for the source worker, the rest for the PSD queue */
+  self->block_count = SUSCAN_ANALYZER_PSD_QUEUE_DEPTH + 1;
+  SU_TRYCATCH(
+      self->block_pool = calloc(
+          self->block_count,
+          sizeof(struct suscan_local_analyzer_block)),
+      return SU_FALSE);
+
+  for (i = 0; i < self->block_count; ++i)
+    SU_TRYCATCH(
+        self->block_pool[i].data = malloc(
+            self->read_size * sizeof(SUCOMPLEX)),
+        return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+/*
+ * Samples lost are the gaps found by the stream clock of the source,
+ * either from hardware timestamps or from the samples dropped by the
+ * capture thread.
+ */
+SUPRIVATE SUBOOL
+suscan_local_analyzer_report_samples_lost(suscan_local_analyzer_t *self)
+{
+  struct suscan_source_capture_stats stats;
+  uint64_t lost, delta;
+  SUFLOAT seconds;
+
+  seconds = (self->read_start - self->last_samples_lost) * 1e-9;
+  if (seconds < SUSCAN_ANALYZER_SAMPLES_LOST_INTERVAL)
+    return SU_TRUE;
+
+  suscan_source_get_capture_stats(self->source, &stats);
+  lost = suscan_source_get_samples_lost(self->source);
+
+  if (stats.overflows == self->reported_overflows
+      && lost == self->reported_lost
+      && self->psd_dropped == self->reported_psd_dropped)
+    return SU_TRUE;
+
+  delta = lost - self->reported_lost;
+
+  if (suscan_source_has_capture_thread(self->source)) {
+    SU_TRYCATCH(
+        suscan_analyzer_send_status(
+            self->parent,
+            SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST,
+            delta > INT32_MAX ? INT32_MAX : (int) delta,
+            "Capture ring: %u/%u blocks of %lu samples in use (high-water %u), "
+            "%llu device overflows, %llu samples dropped, %llu samples lost, "
+            "%llu PSD blocks dropped",
+            stats.used,
+            stats.depth,
+            (unsigned long) stats.block_size,
+            stats.high_water,
+            (unsigned long long) stats.overflows,
+            (unsigned long long) stats.dropped,
+            (unsigned long long) lost,
+            (unsigned long long) self->psd_dropped),
+        return SU_FALSE);
+  } else {
+    SU_TRYCATCH(
+        suscan_analyzer_send_status(
+            self->parent,
+            SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST,
+            delta > INT32_MAX ? INT32_MAX : (int) delta,
+            "Stream gap: %llu samples lost (%llu since start, %s), "
+            "%llu PSD blocks dropped",
+            (unsigned long long) delta,
+            (unsigned long long) lost,
+            suscan_source_has_hw_time(self->source)
+              ? "hardware timestamps"
+              : "no timestamps",
+            (unsigned long long) self->psd_dropped),
+        return SU_FALSE);
+  }
+
+  self->reported_overflows   = stats.overflows;
+  self->reported_lost        = lost;
+  self->reported_psd_dropped = self->psd_dropped;
+  self->last_samples_lost    = self->read_start;
+
   return SU_TRUE;
 }
 
@@ -527,17 +779,19 @@ suscan_source_channel_wk_cb(
     void *cb_private)
 {
   suscan_local_analyzer_t *self = (suscan_local_analyzer_t *) wk_private;
+  struct suscan_local_analyzer_block *block = NULL;
   SUSDIFF got;
   SUSCOUNT read_size;
   SUBOOL mutex_acquired = SU_FALSE;
   SUBOOL restart = SU_FALSE;
   SUFLOAT seconds;
+  uint64_t lap = 0;
 
   SU_TRYCATCH(suscan_local_analyzer_lock_loop(self), goto done);
   mutex_acquired = SU_TRUE;
 
   /* With non-real time sources, use throttle to control CPU usage */
-  if (suscan_local_analyzer_is_real_time_ex(self)) {
+  if (suscan_local_analyzer_is_real_time_ex(self) || self->free_run) {
     read_size = self->read_size;
   } else {
     SU_TRYCATCH(
@@ -554,18 +808,32 @@ suscan_source_channel_wk_cb(
   SU_TRYCATCH(suscan_local_analyzer_parse_overridable(self), goto done);
 
   /* Ready to read */
-  suscan_local_analyzer_read_start(self);
+  if (self->free_run) {
+    lap = suscan_gettime();
+    if (self->free_run_start == 0)
+      self->free_run_start = lap;
+  } else {
+    suscan_local_analyzer_read_start(self);
+  }
 
-  if ((got = suscan_source_read(
-      self->source,
-      self->read_buf,
-      read_size)) > 0) {
-    suscan_local_analyzer_process_start(self);
+  SU_TRYCATCH(block = suscan_local_analyzer_acquire_block(self), goto done);
 
-    if (self->iq_rev)
-      suscan_analyzer_do_iq_rev(self->read_buf, got);
+  got = suscan_local_analyzer_read_block(self, block->data, read_size);
+  if (got > 0) {
+    block->size   = got;
+    block->looped = suscan_source_has_looped(self->source);
+    suscan_analyzer_get_source_time(self->parent, &block->timestamp);
+
+    if (self->free_run)
+      lap = suscan_local_analyzer_free_run_lap(&self->free_run_read_ns, lap);
+    else
+      suscan_local_analyzer_process_start(self);
 
-    if (!suscan_local_analyzer_is_real_time_ex(self)) {
+    /* Free-running analyzers report PSD drops at the end of the stream */
+    if (!self->free_run)
+      SU_TRYCATCH(suscan_local_analyzer_report_samples_lost(self), goto done);
+
+    if (!suscan_local_analyzer_is_real_time_ex(self) && !self->free_run) {
       SU_TRYCATCH(
           pthread_mutex_lock(&self->throttle_mutex) != -1,
           goto done);
@@ -578,15 +846,17 @@ suscan_source_channel_wk_cb(
     SU_TRYCATCH(
         suscan_local_analyzer_feed_baseband_filters(
             self,
-            self->read_buf,
+            block->data,
             got),
         goto done);
 
-    SU_TRYCATCH(
-        su_smoothpsd_feed(self->smooth_psd, self->read_buf, got),
-        goto done);
+    SU_TRYCATCH(suscan_local_analyzer_queue_psd(self, block), goto done);
 
-    if (SUSCAN_ANALYZER_FS_MEASURE_INTERVAL > 0) {
+    if (self->free_run)
+      lap = suscan_local_analyzer_free_run_lap(
+        &self->free_run_baseband_ns,
+        lap);
+    else if (SUSCAN_ANALYZER_FS_MEASURE_INTERVAL > 0) {
       seconds = (self->read_start - self->last_measure) * 1e-9;
 
       if (seconds >= SUSCAN_ANALYZER_FS_MEASURE_INTERVAL) {
@@ -604,20 +874,29 @@ suscan_source_channel_wk_cb(
 
     /* Feed inspectors! */
     SU_TRYCATCH(
-        suscan_local_analyzer_feed_inspectors(self, self->read_buf, got),
+        suscan_local_analyzer_feed_inspectors(self, block->data, got),
         goto done);
 
+    if (self->free_run) {
+      (void) suscan_local_analyzer_free_run_lap(
+        &self->free_run_inspector_ns,
+        lap);
+      self->free_run_samples += got;
+    }
   } else {
     self->parent->eos = SU_TRUE; /* TODO: Use force_eos? */
     self->cpu_usage = 0;
 
     switch (got) {
       case SU_BLOCK_PORT_READ_END_OF_STREAM:
-        suscan_analyzer_send_status(
-            self->parent,
-            SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
-            got,
-            "End of stream reached");
+        if (self->free_run)
+          suscan_local_analyzer_report_throughput(self, got);
+        else
+          suscan_analyzer_send_status(
+              self->parent,
+              SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
+              got,
+              "End of stream reached");
         break;
 
       case SU_BLOCK_PORT_READ_ERROR_NOT_INITIALIZED:
@@ -656,11 +935,15 @@ suscan_source_channel_wk_cb(
   }
 
   /* Finish processing */
-  suscan_local_analyzer_process_end(self);
+  if (!self->free_run)
+    suscan_local_analyzer_process_end(self);
 
   restart = !self->parent->halt_requested;
 
 done:
+  if (block != NULL)
+    suscan_local_analyzer_release_block(block);
+
   if (mutex_acquired)
     (void) suscan_local_analyzer_unlock_loop(self);
 
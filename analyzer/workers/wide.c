@@ -35,9 +35,420 @@
 #include <sigutils/detect.h>
 #include <analyzer/impl/local.h>
 
+#include "realtime.h"
 #include "mq.h"
 #include "msg.h"
 
+/************************** Overlapped sweep pipeline ************************/
+SUBOOL
+suscan_local_analyzer_init_wide_pipeline(suscan_local_analyzer_t *self)
+{
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRY(pthread_mutex_init(&self->wide_mutex, NULL) == 0);
+
+  if (pthread_cond_init(&self->wide_cond, NULL) != 0) {
+    pthread_mutex_destroy(&self->wide_mutex);
+    goto done;
+  }
+
+  self->wide_sync_init = SU_TRUE;
+
+  ok = SU_TRUE;
+
+done:
+  return ok;
+}
+
+void
+suscan_local_analyzer_finalize_wide_pipeline(suscan_local_analyzer_t *self)
+{
+  unsigned int i;
+
+  for (i = 0; i < 2; ++i)
+    if (self->wide_window[i].data != NULL)
+      free(self->wide_window[i].data);
+
+  for (i = 0; i < self->sweep_band_count; ++i)
+    free(self->sweep_band_list[i]);
+
+  if (self->sweep_band_list != NULL)
+    free(self->sweep_band_list);
+
+  if (self->sched_last_visit != NULL)
+    free(self->sched_last_visit);
+
+  if (self->sched_revisit != NULL)
+    free(self->sched_revisit);
+
+  if (self->wide_sync_init) {
+    pthread_mutex_destroy(&self->wide_mutex);
+    pthread_cond_destroy(&self->wide_cond);
+  }
+}
+
+SUBOOL
+suscan_local_analyzer_wait_wide_pipeline(suscan_local_analyzer_t *self)
+{
+  SU_TRYCATCH(pthread_mutex_lock(&self->wide_mutex) == 0, return SU_FALSE);
+
+  while (self->wide_busy)
+    (void) pthread_cond_wait(&self->wide_cond, &self->wide_mutex);
+
+  (void) pthread_mutex_unlock(&self->wide_mutex);
+
+  return SU_TRUE;
+}
+
+/* Runs in the PSD worker, which owns the detector while wide_busy is set */
+SUPRIVATE SUBOOL
+suscan_local_analyzer_wide_psd_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  suscan_local_analyzer_t *self = (suscan_local_analyzer_t *) wk_private;
+  struct suscan_local_analyzer_wide_window *window =
+    (struct suscan_local_analyzer_wide_window *) cb_private;
+
+  SU_TRYCATCH(
+      su_channel_detector_feed_bulk(
+          self->detector,
+          window->data,
+          window->size) == window->size,
+      goto done);
+
+  if (su_channel_detector_get_iters(self->detector) > 0)
+    SU_TRYCATCH(
+        suscan_analyzer_send_psd_ex(
+            self->parent,
+            self->detector,
+            window->freq,
+            &window->timestamp),
+        goto done);
+
+done:
+  su_channel_detector_rewind(self->detector);
+
+  (void) pthread_mutex_lock(&self->wide_mutex);
+  self->wide_busy = SU_FALSE;
+  (void) pthread_cond_broadcast(&self->wide_cond);
+  (void) pthread_mutex_unlock(&self->wide_mutex);
+
+  return SU_FALSE;
+}
+
+/* Hands the full window to the PSD worker and starts filling the other */
+SUPRIVATE SUBOOL
+suscan_local_analyzer_wide_submit(suscan_local_analyzer_t *self)
+{
+  struct suscan_local_analyzer_wide_window *window =
+    self->wide_window + self->wide_fill;
+
+  SU_TRYCATCH(suscan_local_analyzer_wait_wide_pipeline(self), return SU_FALSE);
+
+  self->wide_busy = SU_TRUE;
+
+  if (!suscan_worker_push(
+      self->psd_wk,
+      suscan_local_analyzer_wide_psd_cb,
+      window)) {
+    self->wide_busy = SU_FALSE;
+    return SU_FALSE;
+  }
+
+  self->wide_fill ^= 1;
+  self->wide_window[self->wide_fill].size = 0;
+
+  return SU_TRUE;
+}
+
+/****************************** Sweep scheduler ******************************/
+SUBOOL
+suscan_local_analyzer_set_sweep_band(
+  suscan_local_analyzer_t *self,
+  const struct suscan_analyzer_sweep_band_msg *msg)
+{
+  struct suscan_local_analyzer_sweep_band *band = NULL;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  if (msg->revisit <= 0) {
+    for (i = 0; i < self->sweep_band_count; ++i)
+      free(self->sweep_band_list[i]);
+
+    if (self->sweep_band_list != NULL)
+      free(self->sweep_band_list);
+
+    self->sweep_band_list  = NULL;
+    self->sweep_band_count = 0;
+  } else {
+    SU_TRY(msg->max_freq >= msg->min_freq);
+    SU_ALLOCATE(band, struct suscan_local_analyzer_sweep_band);
+
+    band->min_freq = msg->min_freq;
+    band->max_freq = msg->max_freq;
+    band->revisit  = msg->revisit;
+
+    SU_TRYC(PTR_LIST_APPEND_CHECK(self->sweep_band, band));
+    band = NULL;
+  }
+
+  self->sched_dirty = SU_TRUE;
+
+  ok = SU_TRUE;
+
+done:
+  if (band != NULL)
+    free(band);
+
+  return ok;
+}
+
+/*
+ * Rebuilds the visit table when the hop range changes, and recomputes
+ * the target revisit times when the bands change. Partitions take the
+ * most demanding revisit time of the bands they overlap with. The rest
+ * take the least demanding one.
+ */
+SUPRIVATE SUBOOL
+suscan_local_analyzer_sched_update(suscan_local_analyzer_t *self)
+{
+  SUFREQ min  = self->current_sweep_params.min_freq;
+  SUFREQ max  = self->current_sweep_params.max_freq;
+  SUFREQ step = suscan_analyzer_get_samp_rate(self->parent) / 2;
+  const struct suscan_local_analyzer_sweep_band *band;
+  uint64_t *last_visit = NULL;
+  SUFLOAT  *revisit = NULL;
+  SUFLOAT   background;
+  SUFREQ    freq;
+  unsigned int i, j, count;
+  SUBOOL ok = SU_FALSE;
+
+  if (self->sched_count == 0
+    || self->sched_min  != min
+    || self->sched_max  != max
+    || self->sched_step != step) {
+    count = max - min >= step ? (unsigned int) ((max - min) / step) + 1 : 1;
+
+    SU_ALLOCATE_MANY(last_visit, count, uint64_t);
+    SU_ALLOCATE_MANY(revisit, count, SUFLOAT);
+
+    if (self->sched_last_visit != NULL)
+      free(self->sched_last_visit);
+    if (self->sched_revisit != NULL)
+      free(self->sched_revisit);
+
+    self->sched_last_visit = last_visit;
+    self->sched_revisit    = revisit;
+    self->sched_count      = count;
+    self->sched_min        = min;
+    self->sched_max        = max;
+    self->sched_step       = step;
+    self->sched_epoch      = suscan_gettime_coarse();
+    self->sched_dirty      = SU_TRUE;
+
+    last_visit = NULL;
+    revisit    = NULL;
+  }
+
+  if (self->sched_dirty) {
+    background = self->sweep_band_count > 0
+      ? 0
+      : SUSCAN_ANALYZER_SWEEP_DEFAULT_REVISIT;
+
+    for (j = 0; j < self->sweep_band_count; ++j)
+      if (self->sweep_band_list[j]->revisit > background)
+        background = self->sweep_band_list[j]->revisit;
+
+    for (i = 0; i < self->sched_count; ++i) {
+      freq = self->sched_min + i * self->sched_step;
+      self->sched_revisit[i] = background;
+
+      /* Partition i is the spectrum seen when tuned to freq */
+      for (j = 0; j < self->sweep_band_count; ++j) {
+        band = self->sweep_band_list[j];
+        if (freq - step < band->max_freq
+          && freq + step > band->min_freq
+          && band->revisit < self->sched_revisit[i])
+          self->sched_revisit[i] = band->revisit;
+      }
+    }
+
+    self->sched_dirty = SU_FALSE;
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (last_visit != NULL)
+    free(last_visit);
+
+  if (revisit != NULL)
+    free(revisit);
+
+  return ok;
+}
+
+SUPRIVATE void
+suscan_local_analyzer_sched_visit(
+  suscan_local_analyzer_t *self,
+  SUFREQ freq,
+  uint64_t now)
+{
+  SUSDIFF ndx;
+
+  if (self->sched_count == 0)
+    return;
+
+  ndx = SU_FLOOR((freq - self->sched_min) / self->sched_step + .5);
+
+  if (ndx < 0)
+    ndx = 0;
+  else if (ndx >= (SUSDIFF) self->sched_count)
+    ndx = self->sched_count - 1;
+
+  self->sched_last_visit[ndx] = now;
+}
+
+/*
+ * Earliest-deadline hop: the partition whose time since the last visit
+ * is the largest with respect to its target revisit time goes first.
+ * With no bands, this visits all partitions in a fixed cycle, which
+ * minimizes the maximum revisit time.
+ */
+SUPRIVATE SUFREQ
+suscan_local_analyzer_sched_next(const suscan_local_analyzer_t *self)
+{
+  uint64_t now = suscan_gettime_coarse();
+  uint64_t last;
+  unsigned int i, best = 0;
+  SUFLOAT lateness, max_lateness = -1;
+
+  for (i = 0; i < self->sched_count; ++i) {
+    last = self->sched_last_visit[i];
+    if (last == 0)
+      last = self->sched_epoch;
+
+    lateness = (now - last) * 1e-9 / self->sched_revisit[i];
+    if (lateness > max_lateness) {
+      max_lateness = lateness;
+      best = i;
+    }
+  }
+
+  return self->sched_min + best * self->sched_step;
+}
+
+SUPRIVATE SUBOOL
+suscan_local_analyzer_send_sweep_stats(
+  suscan_local_analyzer_t *self,
+  uint64_t now)
+{
+  struct suscan_analyzer_sweep_stats_msg *msg = NULL;
+  unsigned int i;
+  SUFLOAT age, lateness, total = 0;
+  SUBOOL ok = SU_FALSE;
+
+  SU_ALLOCATE(msg, struct suscan_analyzer_sweep_stats_msg);
+
+  msg->strategy   = self->current_sweep_params.strategy;
+  msg->sweep_rate = self->sweep_rate * 1e-9;
+
+  /* Coverage statistics are only meaningful for the scheduled sweep */
+  if (msg->strategy != SUSCAN_ANALYZER_SWEEP_STRATEGY_SCHEDULED)
+    goto send;
+
+  msg->partitions = self->sched_count;
+
+  for (i = 0; i < self->sched_count; ++i) {
+    if (self->sched_last_visit[i] == 0)
+      continue;
+
+    age      = (now - self->sched_last_visit[i]) * 1e-9;
+    lateness = age / self->sched_revisit[i];
+    total   += age;
+
+    ++msg->visited;
+
+    if (age > msg->max_age)
+      msg->max_age = age;
+
+    if (lateness > msg->max_lateness)
+      msg->max_lateness = lateness;
+  }
+
+  if (msg->visited > 0)
+    msg->mean_age = total / msg->visited;
+
+send:
+  SU_TRY(
+    suscan_mq_write(
+      self->parent->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_STATS,
+      msg));
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    free(msg);
+
+  return ok;
+}
+
+/*
+ * Returns how many samples of the last read (got samples, covering
+ * device samples from prev to now) were captured before the current
+ * hop became usable.
+ */
+SUPRIVATE SUSCOUNT
+suscan_local_analyzer_wide_stale(
+  const suscan_local_analyzer_t *self,
+  uint64_t prev,
+  uint64_t now,
+  SUSCOUNT got)
+{
+  if (now <= self->wide_settle_until)
+    return got;
+
+  if (prev >= self->wide_settle_until)
+    return 0;
+
+  return got * (self->wide_settle_until - prev) / (now - prev);
+}
+
+SUPRIVATE SUBOOL
+suscan_local_analyzer_wide_report(
+  suscan_local_analyzer_t *self,
+  SUFREQ bw,
+  uint64_t now)
+{
+  SUFLOAT seconds;
+
+  self->wide_swept += bw;
+
+  if (self->wide_last_report == 0) {
+    self->wide_last_report = now;
+    self->wide_swept = 0;
+    return SU_TRUE;
+  }
+
+  seconds = (now - self->wide_last_report) * 1e-9;
+  if (seconds >= SUSCAN_ANALYZER_SWEEP_RATE_INTERVAL) {
+    self->sweep_rate = self->wide_swept / seconds;
+    self->wide_swept = 0;
+    self->wide_last_report = now;
+
+    SU_TRYCATCH(
+      suscan_local_analyzer_send_sweep_stats(self, now),
+      return SU_FALSE);
+  }
+
+  return SU_TRUE;
+}
+
 /*
  * TODO: Add methods to define partition bandwidth
  */
@@ -89,6 +500,14 @@ suscan_local_analyzer_hop(suscan_local_analyzer_t *self)
           self->part_ndx = 1;
         }
         break;
+
+      case SUSCAN_ANALYZER_SWEEP_STRATEGY_SCHEDULED:
+        /*
+         * Scheduled strategy: deterministic, visits the partition that is
+         * the most overdue according to the revisit time of its band.
+         */
+        next = suscan_local_analyzer_sched_next(self);
+        break;
     }
   }
 
@@ -101,6 +520,17 @@ suscan_local_analyzer_hop(suscan_local_analyzer_t *self)
     self->curr_freq = suscan_source_get_freq(self->source);
     self->source_info.frequency = self->curr_freq;
 
+    /*
+     * With hardware timestamps we know exactly which samples belong to
+     * the new frequency. Otherwise, give the driver fft_min_samples
+     * (in device samples) to flush its buffers.
+     */
+    if (!suscan_source_get_retune_sample(
+        self->source,
+        &self->wide_settle_until))
+      self->wide_settle_until +=
+        self->current_sweep_params.fft_min_samples * self->source->decim;
+
     return SU_TRUE;
   }
 
@@ -114,6 +544,9 @@ suscan_source_wide_wk_cb(
     void *cb_private)
 {
   suscan_local_analyzer_t *self = (suscan_local_analyzer_t *) wk_private;
+  struct suscan_local_analyzer_wide_window *window;
+  SUSCOUNT window_size, stale, chunk;
+  uint64_t prev, now, t;
   SUSDIFF got;
   SUBOOL mutex_acquired = SU_FALSE;
   SUBOOL restart = SU_FALSE;
@@ -129,38 +562,56 @@ suscan_source_wide_wk_cb(
     self->sweep_params_requested = SU_FALSE;
   }
 
+  /* Detector is only reconfigured with the pipeline idle */
+  window      = self->wide_window + self->wide_fill;
+  window_size = self->detector->params.window_size;
+
+  if (window->alloc < window_size) {
+    SU_TRYCATCH(
+        window->data = realloc(window->data, window_size * sizeof(SUCOMPLEX)),
+        goto done);
+    window->alloc = window_size;
+  }
+
+  prev = suscan_source_get_clock_samples(self->source);
+
   if ((got = suscan_source_read(
       self->source,
       self->read_buf,
       self->read_size)) > 0) {
+    now   = suscan_source_get_clock_samples(self->source);
+    stale = suscan_local_analyzer_wide_stale(self, prev, now, got);
 
-    if (self->iq_rev)
-      suscan_analyzer_do_iq_rev(self->read_buf, got);
-    self->fft_samples += got;
-
-    if (self->fft_samples > self->current_sweep_params.fft_min_samples) {
-      /* Feed detector (works in spectrum mode only) */
-      SU_TRYCATCH(
-          su_channel_detector_feed_bulk(
-              self->detector,
-              self->read_buf,
-              got) == got,
-          goto done);
+    if (stale < got) {
+      chunk = MIN(got - stale, window_size - window->size);
+      memcpy(
+          window->data + window->size,
+          self->read_buf + stale,
+          chunk * sizeof(SUCOMPLEX));
+      window->size += chunk;
 
       /*
-       * Reached threshold. Send message and hop. Note we do this right here,
-       * in the source worker. This way we ensure synchronous arrival
-       * of samples at the selected frequency.
+       * Window complete. Compute its PSD in the PSD worker and hop right
+       * away, so that the retune overlaps with the FFT. The rest of this
+       * read belongs to the old frequency and is discarded.
        */
-
-      if (su_channel_detector_get_iters(self->detector) > 0) {
-        SU_TRYCATCH(
-            suscan_analyzer_send_psd(self->parent, self->detector),
-            goto done);
-
-        self->fft_samples = 0;
-        su_channel_detector_rewind(self->detector);
-        (void) suscan_local_analyzer_hop(self);
+      if (window->size == window_size) {
+        window->freq = self->curr_freq;
+        suscan_source_get_time(self->source, &window->timestamp);
+
+        t = suscan_gettime_coarse();
+        SU_TRYCATCH(suscan_local_analyzer_sched_update(self), goto done);
+        suscan_local_analyzer_sched_visit(self, window->freq, t);
+
+        SU_TRYCATCH(suscan_local_analyzer_wide_submit(self), goto done);
+
+        if (suscan_local_analyzer_hop(self))
+          SU_TRYCATCH(
+              suscan_local_analyzer_wide_report(
+                  self,
+                  suscan_analyzer_get_samp_rate(self->parent),
+                  t),
+              goto done);
       }
     }
   } else {
@@ -0,0 +1,61 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _CLI_BENCH_BENCH_H
+#define _CLI_BENCH_BENCH_H
+
+#include <sigutils/sigutils.h>
+#include <util/hashlist.h>
+#include <analyzer/realtime.h>
+#include <stdlib.h>
+
+/*
+ * Benchmark suites of the bench command. Every suite checks the optimized
+ * code against a straightforward reference within a stated tolerance and
+ * reports its throughput. Suites return SU_FALSE if any check fails.
+ */
+
+#define SUSCLI_BENCH_DEFAULT_SEED 0x5ca1ab1e
+
+struct suscli_bench_suite {
+  const char *name;
+  const char *desc;
+  SUBOOL (*run) (const hashlist_t *params);
+};
+
+SUINLINE SUFLOAT
+suscli_bench_rand(void)
+{
+  return 2 * (SUFLOAT) rand() / (SUFLOAT) RAND_MAX - 1;
+}
+
+SUINLINE SUFLOAT
+suscli_bench_rate(SUSCOUNT items, uint64_t elapsed_ns)
+{
+  return elapsed_ns > 0 ? 1e3 * items / (SUFLOAT) elapsed_ns : 0;
+}
+
+SUBOOL suscli_bench_kernels(const hashlist_t *params);
+SUBOOL suscli_bench_decimator(const hashlist_t *params);
+SUBOOL suscli_bench_psk(const hashlist_t *params);
+SUBOOL suscli_bench_remote(const hashlist_t *params);
+SUBOOL suscli_bench_inspsched(const hashlist_t *params);
+SUBOOL suscli_bench_mq(const hashlist_t *params);
+
+#endif /* _CLI_BENCH_BENCH_H */
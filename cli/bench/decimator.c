@@ -0,0 +1,252 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "cli-bench-decimator"
+
+#include <sigutils/log.h>
+#include <analyzer/source.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cli/cli.h>
+#include <cli/bench/bench.h>
+
+/*
+ * The source decimator is compared against the per-sample accumulator
+ * decimator it replaced, which kept SUSCAN_SOURCE_ANTIALIAS_REL_SIZE
+ * overlapping accumulators and produced one output whenever one of them
+ * had seen the whole filter. Both use the same taps, so outputs must match
+ * up to float rounding. Throughput is measured in input samples.
+ */
+
+#define SUSCLI_BENCH_DECIMATOR_DEFAULT_SIZE  65536
+#define SUSCLI_BENCH_DECIMATOR_DEFAULT_ITERS 200
+#define SUSCLI_BENCH_DECIMATOR_TOLERANCE     1e-5
+
+SUPRIVATE const int g_decims[] = {2, 3, 4, 8, 16};
+
+#define SUSCLI_BENCH_DECIMATOR_COUNT (sizeof(g_decims) / sizeof(g_decims[0]))
+
+/*************************** Reference decimator *****************************/
+struct suscli_bench_accum_decimator {
+  SUFLOAT  *alloc;
+  const SUFLOAT *taps; /* Preceded by (REL_SIZE - 1) * decim zeroes */
+  SUCOMPLEX accums[SUSCAN_SOURCE_ANTIALIAS_REL_SIZE];
+  int       ptrs[SUSCAN_SOURCE_ANTIALIAS_REL_SIZE];
+  int       length;
+};
+
+SUPRIVATE SUBOOL
+suscli_bench_accum_decimator_init(
+  struct suscli_bench_accum_decimator *self,
+  const struct suscan_source_decimator *decimator)
+{
+  SUFLOAT *taps;
+  int i, decim = decimator->decim;
+  SUBOOL ok = SU_FALSE;
+
+  memset(self, 0, sizeof(struct suscli_bench_accum_decimator));
+
+  self->length = decim * SUSCAN_SOURCE_ANTIALIAS_REL_SIZE;
+
+  SU_TRY(
+    self->alloc = calloc(
+      2 * SUSCAN_SOURCE_ANTIALIAS_REL_SIZE - 1,
+      decim * sizeof(SUFLOAT)));
+
+  taps = self->alloc + (SUSCAN_SOURCE_ANTIALIAS_REL_SIZE - 1) * decim;
+  for (i = 0; i < self->length; ++i)
+    taps[i] = decimator->taps[2 * i];
+
+  self->taps = taps;
+
+  /* Pointers start at 0, -decim, -2 * decim, -3 * decim... */
+  for (i = 0; i < SUSCAN_SOURCE_ANTIALIAS_REL_SIZE; ++i)
+    self->ptrs[i] = -i * decim;
+
+  ok = SU_TRUE;
+
+done:
+  return ok;
+}
+
+SUPRIVATE void
+suscli_bench_accum_decimator_finalize(
+  struct suscli_bench_accum_decimator *self)
+{
+  if (self->alloc != NULL)
+    free(self->alloc);
+}
+
+/* This is the former code, as it was. It assumes REL_SIZE == 5. */
+#define ACCUMULATE(val) \
+  self->accums[val] += data[i] * (self->taps[self->ptrs[val]++])
+
+#define IF_DONE_PRODUCE_SAMPLE(val)                   \
+  if (self->ptrs[val] == self->length) {              \
+    out[samples++] = self->accums[val];               \
+    self->accums[val] = self->ptrs[val] = 0;          \
+  }
+
+SUPRIVATE SUSCOUNT
+suscli_bench_accum_decimator_feed(
+  struct suscli_bench_accum_decimator *self,
+  const SUCOMPLEX *data,
+  SUSCOUNT len,
+  SUCOMPLEX *out)
+{
+  SUSCOUNT i, samples = 0;
+
+  for (i = 0; i < len; ++i) {
+    ACCUMULATE(0);
+    ACCUMULATE(1);
+    ACCUMULATE(2);
+    ACCUMULATE(3);
+    ACCUMULATE(4);
+
+    IF_DONE_PRODUCE_SAMPLE(0)
+    else IF_DONE_PRODUCE_SAMPLE(1)
+    else IF_DONE_PRODUCE_SAMPLE(2)
+    else IF_DONE_PRODUCE_SAMPLE(3)
+    else IF_DONE_PRODUCE_SAMPLE(4)
+  }
+
+  return samples;
+}
+
+#undef ACCUMULATE
+#undef IF_DONE_PRODUCE_SAMPLE
+
+/******************************** Suite **************************************/
+SUBOOL
+suscli_bench_decimator(const hashlist_t *params)
+{
+  struct suscan_source_decimator decimator;
+  struct suscli_bench_accum_decimator accum;
+  SUCOMPLEX *input = NULL, *block = NULL, *ref = NULL;
+  SUSCOUNT got, expected, j;
+  SUFLOAT err, block_rate, ref_rate;
+  uint64_t start, block_ns, ref_ns;
+  int size, iters, seed, i;
+  unsigned int k;
+  SUBOOL passed = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&decimator, 0, sizeof(struct suscan_source_decimator));
+  memset(&accum, 0, sizeof(struct suscli_bench_accum_decimator));
+
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "size",
+      &size,
+      SUSCLI_BENCH_DECIMATOR_DEFAULT_SIZE));
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "iters",
+      &iters,
+      SUSCLI_BENCH_DECIMATOR_DEFAULT_ITERS));
+  SU_TRY(
+    suscli_param_read_int(params, "seed", &seed, SUSCLI_BENCH_DEFAULT_SEED));
+
+  if (size < 1 || iters < 1) {
+    SU_ERROR("Invalid size or iters\n");
+    goto done;
+  }
+
+  SU_ALLOCATE_MANY(input, size, SUCOMPLEX);
+  SU_ALLOCATE_MANY(block, size, SUCOMPLEX);
+  SU_ALLOCATE_MANY(ref,   size, SUCOMPLEX);
+
+  srand(seed);
+  for (i = 0; i < size; ++i)
+    input[i] = suscli_bench_rand() + I * suscli_bench_rand();
+
+  for (k = 0; k < SUSCLI_BENCH_DECIMATOR_COUNT; ++k) {
+    /* Check */
+    SU_TRY(suscan_source_decimator_init(&decimator, g_decims[k]));
+    SU_TRY(suscli_bench_accum_decimator_init(&accum, &decimator));
+
+    memcpy(block, input, size * sizeof(SUCOMPLEX));
+    got      = suscan_source_decimator_feed(&decimator, block, size);
+    expected = suscli_bench_accum_decimator_feed(&accum, input, size, ref);
+
+    err = 0;
+    for (j = 0; j < MIN(got, expected); ++j)
+      if (SU_C_ABS(block[j] - ref[j]) > err)
+        err = SU_C_ABS(block[j] - ref[j]);
+
+    /* Both may disagree in the last, incomplete output */
+    if (got + 1 < expected || expected + 1 < got)
+      err = INFINITY;
+
+    /* Throughput */
+    start = suscan_gettime();
+    for (i = 0; i < iters; ++i)
+      (void) suscli_bench_accum_decimator_feed(&accum, input, size, ref);
+    ref_ns = suscan_gettime() - start;
+
+    start = suscan_gettime();
+    for (i = 0; i < iters; ++i) {
+      memcpy(block, input, size * sizeof(SUCOMPLEX));
+      (void) suscan_source_decimator_feed(&decimator, block, size);
+    }
+    block_ns = suscan_gettime() - start;
+
+    ref_rate   = suscli_bench_rate((SUSCOUNT) size * iters, ref_ns);
+    block_rate = suscli_bench_rate((SUSCOUNT) size * iters, block_ns);
+
+    fprintf(
+      stderr,
+      "  decim %-3d max error %9.3e (tolerance %7.1e) %s  "
+      "accum %8.2f Msps  block %8.2f Msps  (%.2fx)\n",
+      g_decims[k],
+      err,
+      SUSCLI_BENCH_DECIMATOR_TOLERANCE,
+      err <= SUSCLI_BENCH_DECIMATOR_TOLERANCE ? "OK  " : "FAIL",
+      ref_rate,
+      block_rate,
+      ref_rate > 0 ? block_rate / ref_rate : 0);
+
+    if (!(err <= SUSCLI_BENCH_DECIMATOR_TOLERANCE))
+      passed = SU_FALSE;
+
+    suscan_source_decimator_finalize(&decimator);
+    suscli_bench_accum_decimator_finalize(&accum);
+    memset(&accum, 0, sizeof(struct suscli_bench_accum_decimator));
+  }
+
+  ok = passed;
+
+done:
+  suscan_source_decimator_finalize(&decimator);
+  suscli_bench_accum_decimator_finalize(&accum);
+
+  if (input != NULL)
+    free(input);
+
+  if (block != NULL)
+    free(block);
+
+  if (ref != NULL)
+    free(ref);
+
+  return ok;
+}
@@ -0,0 +1,399 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "cli-bench-inspsched"
+
+#include <sigutils/log.h>
+#include <analyzer/inspsched.h>
+#include <analyzer/inspector/inspector.h>
+#include <analyzer/msg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cli/cli.h>
+#include <cli/bench/bench.h>
+
+/*
+ * A set of PSK inspectors is fed the same channel windows through the
+ * inspector scheduler, once per scheduling policy and with fresh
+ * inspectors every time. Inspectors are stateful, so every policy must
+ * produce the same number of symbols as feeding them one after another
+ * in the calling thread. Under work stealing, the per-worker statistics
+ * must also account for every queued task and sample. Throughput is
+ * given in Msps, both total and per worker.
+ */
+
+#define SUSCLI_BENCH_INSPSCHED_DEFAULT_INSPECTORS 16
+#define SUSCLI_BENCH_INSPSCHED_DEFAULT_WINDOWS    256
+#define SUSCLI_BENCH_INSPSCHED_DEFAULT_WINDOW     4096
+#define SUSCLI_BENCH_INSPSCHED_SAMP_RATE          250000
+#define SUSCLI_BENCH_INSPSCHED_BAUD               31250
+
+struct suscli_bench_inspsched_policy {
+  const char *name;
+  enum suscan_inspsched_policy policy;
+};
+
+SUPRIVATE const struct suscli_bench_inspsched_policy g_policies[] = {
+  {"round-robin",   SUSCAN_INSPSCHED_POLICY_ROUND_ROBIN},
+  {"work-stealing", SUSCAN_INSPSCHED_POLICY_WORK_STEALING},
+};
+
+#define SUSCLI_BENCH_INSPSCHED_POLICY_COUNT \
+  (sizeof(g_policies) / sizeof(g_policies[0]))
+
+struct suscli_bench_inspsched_state {
+  struct suscan_mq ctl_mq;
+  struct suscan_mq out_mq;
+  SUBOOL ctl_mq_init;
+  SUBOOL out_mq_init;
+
+  suscan_inspector_t **insp_list;
+  unsigned int insp_count;
+
+  const SUCOMPLEX *input;
+  unsigned int windows;
+  unsigned int window;
+
+  SUSCOUNT symbols;
+};
+
+/* Inspectors are refcounted. The suite holds one reference of its own. */
+SUPRIVATE void
+suscli_bench_inspsched_close(struct suscli_bench_inspsched_state *state)
+{
+  unsigned int i;
+
+  for (i = 0; i < state->insp_count; ++i)
+    if (state->insp_list[i] != NULL) {
+      SU_DEREF(state->insp_list[i], bench);
+      state->insp_list[i] = NULL;
+    }
+}
+
+SUPRIVATE SUBOOL
+suscli_bench_inspsched_open(struct suscli_bench_inspsched_state *state)
+{
+  struct suscan_inspector_sampling_info samp_info;
+  suscan_config_t *config = NULL;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&samp_info, 0, sizeof(struct suscan_inspector_sampling_info));
+
+  samp_info.equiv_fs = SUSCLI_BENCH_INSPSCHED_SAMP_RATE;
+  samp_info.bw       = SU_ABS2NORM_FREQ(
+    SUSCLI_BENCH_INSPSCHED_SAMP_RATE,
+    SUSCLI_BENCH_INSPSCHED_BAUD);
+  samp_info.bw_bd    = samp_info.bw;
+
+  state->symbols = 0;
+
+  for (i = 0; i < state->insp_count; ++i) {
+    SU_TRY(
+      state->insp_list[i] = suscan_inspector_new(
+        NULL,
+        "psk",
+        &samp_info,
+        &state->out_mq,
+        &state->ctl_mq,
+        NULL));
+
+    SU_REF(state->insp_list[i], bench);
+    state->insp_list[i]->inspector_id = i;
+
+    if (config == NULL) {
+      SU_TRY(config = suscan_inspector_create_config(state->insp_list[i]));
+      SU_TRY(suscan_inspector_get_config(state->insp_list[i], config));
+      SU_TRY(
+        suscan_config_set_float(
+          config,
+          "clock.baud",
+          SUSCLI_BENCH_INSPSCHED_BAUD));
+      SU_TRY(suscan_config_set_bool(config, "clock.running", SU_TRUE));
+    }
+
+    SU_TRY(suscan_inspector_set_config(state->insp_list[i], config));
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (config != NULL)
+    suscan_config_destroy(config);
+
+  return ok;
+}
+
+SUPRIVATE void
+suscli_bench_inspsched_drain(struct suscli_bench_inspsched_state *state)
+{
+  struct suscan_analyzer_sample_batch_msg *batch;
+  uint32_t type;
+  void *msg;
+
+  while (suscan_mq_poll(&state->out_mq, &type, &msg)) {
+    if (type == SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES) {
+      batch = (struct suscan_analyzer_sample_batch_msg *) msg;
+      state->symbols += batch->sample_count;
+    }
+
+    suscan_analyzer_dispose_message(type, msg);
+  }
+
+  while (suscan_mq_poll(&state->ctl_mq, &type, &msg))
+    suscan_analyzer_dispose_message(type, msg);
+}
+
+/* Symbols still in the sampler buffers, not yet sent as messages */
+SUPRIVATE void
+suscli_bench_inspsched_flush(struct suscli_bench_inspsched_state *state)
+{
+  unsigned int i;
+
+  suscli_bench_inspsched_drain(state);
+
+  for (i = 0; i < state->insp_count; ++i)
+    state->symbols += suscan_inspector_get_output_length(state->insp_list[i]);
+}
+
+/* Reference: every inspector is fed in the calling thread, in order */
+SUPRIVATE SUBOOL
+suscli_bench_inspsched_serial(struct suscli_bench_inspsched_state *state)
+{
+  const SUCOMPLEX *data;
+  unsigned int i, w;
+
+  for (w = 0; w < state->windows; ++w) {
+    data = state->input + (SUSCOUNT) w * state->window;
+
+    for (i = 0; i < state->insp_count; ++i)
+      SU_TRYCATCH(
+        suscan_inspector_sampler_loop(
+          state->insp_list[i],
+          data,
+          state->window),
+        return SU_FALSE);
+
+    suscli_bench_inspsched_drain(state);
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscli_bench_inspsched_feed(
+  struct suscli_bench_inspsched_state *state,
+  suscan_inspsched_t *sched)
+{
+  struct suscan_inspector_task_info *task_info;
+  unsigned int i, w;
+
+  for (w = 0; w < state->windows; ++w) {
+    for (i = 0; i < state->insp_count; ++i) {
+      SU_TRYCATCH(
+        task_info = suscan_inspsched_acquire_task_info(
+          sched,
+          state->insp_list[i]),
+        return SU_FALSE);
+
+      task_info->data = state->input + (SUSCOUNT) w * state->window;
+      task_info->size = state->window;
+
+      if (!suscan_inspsched_queue_task(sched, task_info)) {
+        suscan_inspsched_return_task_info(sched, task_info);
+        SU_ERROR("Failed to queue task\n");
+        return SU_FALSE;
+      }
+    }
+
+    SU_TRYCATCH(suscan_inspsched_sync(sched), return SU_FALSE);
+
+    suscli_bench_inspsched_drain(state);
+  }
+
+  return SU_TRUE;
+}
+
+/* Every queued task and sample must show up in the worker statistics */
+SUPRIVATE SUBOOL
+suscli_bench_inspsched_check_stats(
+  const struct suscli_bench_inspsched_state *state,
+  suscan_inspsched_t *sched)
+{
+  struct suscan_inspsched_worker_stats stats;
+  uint64_t tasks = 0, samples = 0;
+  unsigned int i;
+
+  for (i = 0; i < suscan_inspsched_get_num_workers(sched); ++i) {
+    if (!suscan_inspsched_get_worker_stats(sched, i, &stats))
+      return SU_TRUE;
+
+    tasks   += stats.tasks;
+    samples += stats.samples;
+  }
+
+  return tasks == (uint64_t) state->windows * state->insp_count
+    && samples
+      == (uint64_t) state->windows * state->insp_count * state->window;
+}
+
+SUBOOL
+suscli_bench_inspsched(const hashlist_t *params)
+{
+  struct suscli_bench_inspsched_state state;
+  suscan_inspsched_t *sched = NULL;
+  SUCOMPLEX *input = NULL;
+  SUSCOUNT ref_symbols, samples, i;
+  SUFLOAT ref_rate, rate;
+  uint64_t start, elapsed;
+  unsigned int k, workers;
+  int inspectors, windows, window, seed;
+  SUBOOL match;
+  SUBOOL passed = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&state, 0, sizeof(struct suscli_bench_inspsched_state));
+
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "inspectors",
+      &inspectors,
+      SUSCLI_BENCH_INSPSCHED_DEFAULT_INSPECTORS));
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "windows",
+      &windows,
+      SUSCLI_BENCH_INSPSCHED_DEFAULT_WINDOWS));
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "window",
+      &window,
+      SUSCLI_BENCH_INSPSCHED_DEFAULT_WINDOW));
+  SU_TRY(
+    suscli_param_read_int(params, "seed", &seed, SUSCLI_BENCH_DEFAULT_SEED));
+
+  if (inspectors < 1 || windows < 1 || window < 1) {
+    SU_ERROR("Invalid inspectors, windows or window\n");
+    goto done;
+  }
+
+  state.insp_count = inspectors;
+  state.windows    = windows;
+  state.window     = window;
+  samples          = (SUSCOUNT) inspectors * windows * window;
+
+  SU_ALLOCATE_MANY(input, (SUSCOUNT) windows * window, SUCOMPLEX);
+  SU_ALLOCATE_MANY(state.insp_list, inspectors, suscan_inspector_t *);
+
+  srand(seed);
+  for (i = 0; i < (SUSCOUNT) windows * window; ++i)
+    input[i] = suscli_bench_rand() + I * suscli_bench_rand();
+
+  state.input = input;
+
+  SU_TRY(state.ctl_mq_init = suscan_mq_init(&state.ctl_mq));
+  SU_TRY(state.out_mq_init = suscan_mq_init(&state.out_mq));
+
+  /* Reference run */
+  SU_TRY(suscli_bench_inspsched_open(&state));
+  start = suscan_gettime();
+  SU_TRY(suscli_bench_inspsched_serial(&state));
+  elapsed = suscan_gettime() - start;
+  suscli_bench_inspsched_flush(&state);
+  suscli_bench_inspsched_close(&state);
+
+  ref_symbols = state.symbols;
+  ref_rate    = suscli_bench_rate(samples, elapsed);
+
+  fprintf(
+    stderr,
+    "  %-13s %3d inspectors %9lu symbols  %8.2f Msps\n",
+    "serial",
+    inspectors,
+    (unsigned long) ref_symbols,
+    ref_rate);
+
+  for (k = 0; k < SUSCLI_BENCH_INSPSCHED_POLICY_COUNT; ++k) {
+    SU_TRY(
+      sched = suscan_inspsched_new_ex(
+        &state.ctl_mq,
+        g_policies[k].policy,
+        0));
+    workers = suscan_inspsched_get_num_workers(sched);
+
+    SU_TRY(suscli_bench_inspsched_open(&state));
+    start = suscan_gettime();
+    SU_TRY(suscli_bench_inspsched_feed(&state, sched));
+    elapsed = suscan_gettime() - start;
+    suscli_bench_inspsched_flush(&state);
+
+    match = state.symbols == ref_symbols
+      && suscli_bench_inspsched_check_stats(&state, sched);
+
+    SU_TRY(suscan_inspsched_destroy(sched));
+    sched = NULL;
+    suscli_bench_inspsched_close(&state);
+
+    rate = suscli_bench_rate(samples, elapsed);
+
+    fprintf(
+      stderr,
+      "  %-13s %3u workers    %9lu symbols  %8.2f Msps  "
+      "%8.2f Msps/worker  (%.2fx) %s\n",
+      g_policies[k].name,
+      workers,
+      (unsigned long) state.symbols,
+      rate,
+      workers > 0 ? rate / workers : 0,
+      ref_rate > 0 ? rate / ref_rate : 0,
+      match ? "OK" : "FAIL");
+
+    if (!match)
+      passed = SU_FALSE;
+  }
+
+  ok = passed;
+
+done:
+  if (sched != NULL)
+    suscan_inspsched_destroy(sched);
+
+  if (state.insp_list != NULL) {
+    suscli_bench_inspsched_close(&state);
+    free(state.insp_list);
+  }
+
+  if (state.ctl_mq_init && state.out_mq_init)
+    suscli_bench_inspsched_drain(&state);
+
+  if (state.ctl_mq_init)
+    suscan_mq_finalize(&state.ctl_mq);
+
+  if (state.out_mq_init)
+    suscan_mq_finalize(&state.out_mq);
+
+  if (input != NULL)
+    free(input);
+
+  return ok;
+}
@@ -0,0 +1,379 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "cli-bench-kernels"
+
+#include <sigutils/log.h>
+#include <analyzer/spectsrc.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cli/cli.h>
+#include <cli/bench/bench.h>
+
+/*
+ * Every spectrum source kernel is compared against the scalar loop it
+ * replaced (cpow, SU_C_ARG...), on the same random input. Errors are the
+ * largest magnitude of the difference over the block. Throughput figures
+ * include copying the input block, and are only meaningful in release
+ * builds.
+ */
+
+#define SUSCLI_BENCH_KERNELS_DEFAULT_SIZE  4096
+#define SUSCLI_BENCH_KERNELS_DEFAULT_ITERS 2000
+
+struct suscli_bench_kernel {
+  const char *name;
+  SUFLOAT     tolerance;
+  SUBOOL      real;  /* Only the real part is an output */
+  SUBOOL      phase; /* Wrap errors to (-pi, pi] */
+  void (*fast) (SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev);
+  void (*ref)  (SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev);
+};
+
+/****************************** Reference loops ******************************/
+SUINLINE void
+suscli_bench_ref_exp(SUCOMPLEX *x, SUSCOUNT size, int order)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i)
+    x[i] = cpow(x[i] / (SU_C_ABS(x[i]) + 1e-8), order);
+}
+
+SUPRIVATE void
+suscli_bench_ref_exp_2(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  suscli_bench_ref_exp(x, size, 2);
+}
+
+SUPRIVATE void
+suscli_bench_ref_exp_4(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  suscli_bench_ref_exp(x, size, 4);
+}
+
+SUPRIVATE void
+suscli_bench_ref_exp_8(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  suscli_bench_ref_exp(x, size, 8);
+}
+
+SUPRIVATE void
+suscli_bench_ref_diff(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  SUCOMPLEX tmp;
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i) {
+    tmp  = x[i];
+    x[i] = x[i] - prev;
+    prev = tmp;
+  }
+}
+
+SUPRIVATE void
+suscli_bench_ref_absdiff(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  SUCOMPLEX tmp, diff;
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i) {
+    tmp  = x[i];
+    diff = x[i] - prev;
+    x[i] = diff * SU_C_CONJ(diff);
+    prev = tmp;
+  }
+}
+
+SUPRIVATE void
+suscli_bench_ref_conjmul(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  SUCOMPLEX tmp;
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i) {
+    tmp  = x[i];
+    x[i] = x[i] * SU_C_CONJ(prev);
+    prev = tmp;
+  }
+}
+
+SUPRIVATE void
+suscli_bench_ref_phasediff(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  SUCOMPLEX tmp;
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i) {
+    tmp  = x[i];
+    x[i] = SU_C_ARG(x[i] * SU_C_CONJ(prev));
+    prev = tmp;
+  }
+}
+
+SUPRIVATE void
+suscli_bench_ref_arg(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i)
+    x[i] = SU_C_ARG(x[i]);
+}
+
+SUPRIVATE void
+suscli_bench_ref_realdiff(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  SUFLOAT p = SU_C_REAL(prev);
+  SUFLOAT tmp;
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i) {
+    tmp  = SU_C_REAL(x[i]);
+    x[i] = SU_ABS(tmp - p);
+    p    = tmp;
+  }
+}
+
+/******************************* Kernel wrappers *****************************/
+SUPRIVATE void
+suscli_bench_fast_exp_2(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  suscan_spectsrc_kernel_exp(x, size, 1, 1);
+}
+
+SUPRIVATE void
+suscli_bench_fast_exp_4(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  suscan_spectsrc_kernel_exp(x, size, 2, 1);
+}
+
+SUPRIVATE void
+suscli_bench_fast_exp_8(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  suscan_spectsrc_kernel_exp(x, size, 3, 1);
+}
+
+SUPRIVATE void
+suscli_bench_fast_diff(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  (void) suscan_spectsrc_kernel_diff(x, size, prev);
+}
+
+SUPRIVATE void
+suscli_bench_fast_absdiff(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  (void) suscan_spectsrc_kernel_absdiff(x, size, prev);
+}
+
+SUPRIVATE void
+suscli_bench_fast_conjmul(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  (void) suscan_spectsrc_kernel_conjmul(x, size, prev, 1);
+}
+
+SUPRIVATE void
+suscli_bench_fast_phasediff(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  (void) suscan_spectsrc_kernel_phasediff(x, size, prev, 1);
+}
+
+SUPRIVATE void
+suscli_bench_fast_arg(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  suscan_spectsrc_kernel_arg(x, size, 1);
+}
+
+SUPRIVATE void
+suscli_bench_fast_realdiff(SUCOMPLEX *x, SUSCOUNT size, SUCOMPLEX prev)
+{
+  (void) suscan_spectsrc_kernel_realdiff(x, size, SU_C_REAL(prev), 1);
+}
+
+/*
+ * Tolerances leave a 3x margin over the largest errors measured on x86-64,
+ * with and without -ffast-math. Differences and products only reorder
+ * float operations.
+ */
+SUPRIVATE const struct suscli_bench_kernel g_kernels[] = {
+  {"exp-2",     5e-6, SU_FALSE, SU_FALSE, suscli_bench_fast_exp_2,
+    suscli_bench_ref_exp_2},
+  {"exp-4",     1e-5, SU_FALSE, SU_FALSE, suscli_bench_fast_exp_4,
+    suscli_bench_ref_exp_4},
+  {"exp-8",     2e-5, SU_FALSE, SU_FALSE, suscli_bench_fast_exp_8,
+    suscli_bench_ref_exp_8},
+  {"diff",      1e-6, SU_FALSE, SU_FALSE, suscli_bench_fast_diff,
+    suscli_bench_ref_diff},
+  {"absdiff",   1e-6, SU_FALSE, SU_FALSE, suscli_bench_fast_absdiff,
+    suscli_bench_ref_absdiff},
+  {"conjmul",   1e-6, SU_FALSE, SU_FALSE, suscli_bench_fast_conjmul,
+    suscli_bench_ref_conjmul},
+  {"phasediff", 1e-5, SU_TRUE,  SU_TRUE,  suscli_bench_fast_phasediff,
+    suscli_bench_ref_phasediff},
+  {"arg",       1e-5, SU_TRUE,  SU_TRUE,  suscli_bench_fast_arg,
+    suscli_bench_ref_arg},
+  {"realdiff",  1e-6, SU_TRUE,  SU_FALSE, suscli_bench_fast_realdiff,
+    suscli_bench_ref_realdiff},
+};
+
+#define SUSCLI_BENCH_KERNEL_COUNT (sizeof(g_kernels) / sizeof(g_kernels[0]))
+
+/******************************** Suite **************************************/
+SUPRIVATE SUFLOAT
+suscli_bench_kernel_error(
+  const struct suscli_bench_kernel *kernel,
+  const SUCOMPLEX *fast,
+  const SUCOMPLEX *ref,
+  SUSCOUNT size)
+{
+  SUFLOAT err, max = 0;
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i) {
+    if (kernel->real) {
+      err = SU_C_REAL(fast[i]) - SU_C_REAL(ref[i]);
+      if (kernel->phase) {
+        if (err > M_PI)
+          err -= 2 * M_PI;
+        else if (err < -M_PI)
+          err += 2 * M_PI;
+      }
+      err = SU_ABS(err);
+    } else {
+      err = SU_C_ABS(fast[i] - ref[i]);
+    }
+
+    if (err > max)
+      max = err;
+  }
+
+  return max;
+}
+
+SUPRIVATE uint64_t
+suscli_bench_kernel_time(
+  void (*func) (SUCOMPLEX *, SUSCOUNT, SUCOMPLEX),
+  SUCOMPLEX *buf,
+  const SUCOMPLEX *input,
+  SUSCOUNT size,
+  int iters)
+{
+  uint64_t start;
+  int i;
+
+  start = suscan_gettime();
+
+  for (i = 0; i < iters; ++i) {
+    memcpy(buf, input, size * sizeof(SUCOMPLEX));
+    (func) (buf, size, input[size - 1]);
+  }
+
+  return suscan_gettime() - start;
+}
+
+SUBOOL
+suscli_bench_kernels(const hashlist_t *params)
+{
+  const struct suscli_bench_kernel *kernel;
+  SUCOMPLEX *input = NULL, *fast = NULL, *ref = NULL;
+  SUCOMPLEX prev;
+  SUFLOAT err, fast_rate, ref_rate;
+  int size, iters, seed;
+  unsigned int i;
+  SUBOOL passed = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "size",
+      &size,
+      SUSCLI_BENCH_KERNELS_DEFAULT_SIZE));
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "iters",
+      &iters,
+      SUSCLI_BENCH_KERNELS_DEFAULT_ITERS));
+  SU_TRY(
+    suscli_param_read_int(params, "seed", &seed, SUSCLI_BENCH_DEFAULT_SEED));
+
+  if (size < 1 || iters < 1) {
+    SU_ERROR("Invalid size or iters\n");
+    goto done;
+  }
+
+  SU_ALLOCATE_MANY(input, size, SUCOMPLEX);
+  SU_ALLOCATE_MANY(fast,  size, SUCOMPLEX);
+  SU_ALLOCATE_MANY(ref,   size, SUCOMPLEX);
+
+  srand(seed);
+  for (i = 0; i < (unsigned) size; ++i)
+    input[i] = suscli_bench_rand() + I * suscli_bench_rand();
+
+  prev = suscli_bench_rand() + I * suscli_bench_rand();
+
+  for (i = 0; i < SUSCLI_BENCH_KERNEL_COUNT; ++i) {
+    kernel = g_kernels + i;
+
+    memcpy(fast, input, size * sizeof(SUCOMPLEX));
+    memcpy(ref,  input, size * sizeof(SUCOMPLEX));
+
+    (kernel->fast) (fast, size, prev);
+    (kernel->ref)  (ref,  size, prev);
+
+    err = suscli_bench_kernel_error(kernel, fast, ref, size);
+
+    ref_rate = suscli_bench_rate(
+      (SUSCOUNT) size * iters,
+      suscli_bench_kernel_time(kernel->ref, ref, input, size, iters));
+    fast_rate = suscli_bench_rate(
+      (SUSCOUNT) size * iters,
+      suscli_bench_kernel_time(kernel->fast, fast, input, size, iters));
+
+    fprintf(
+      stderr,
+      "  %-10s max error %9.3e (tolerance %7.1e) %s  "
+      "ref %8.2f Msps  kernel %8.2f Msps  (%.2fx)\n",
+      kernel->name,
+      err,
+      kernel->tolerance,
+      err <= kernel->tolerance ? "OK  " : "FAIL",
+      ref_rate,
+      fast_rate,
+      ref_rate > 0 ? fast_rate / ref_rate : 0);
+
+    if (!(err <= kernel->tolerance))
+      passed = SU_FALSE;
+  }
+
+  ok = passed;
+
+done:
+  if (input != NULL)
+    free(input);
+
+  if (fast != NULL)
+    free(fast);
+
+  if (ref != NULL)
+    free(ref);
+
+  return ok;
+}
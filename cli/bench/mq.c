@@ -0,0 +1,244 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "cli-bench-mq"
+
+#include <sigutils/log.h>
+#include <analyzer/mq.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cli/cli.h>
+#include <cli/bench/bench.h>
+
+/*
+ * Several producer threads write numbered messages to a message queue
+ * while the calling thread reads them, once per queue backend. Every
+ * message must be read exactly once, and messages from the same producer
+ * must arrive in the order they were written. Rates are given in
+ * millions of messages per second.
+ */
+
+#define SUSCLI_BENCH_MQ_DEFAULT_MESSAGES 1000000
+#define SUSCLI_BENCH_MQ_READ_TIMEOUT_MS  1000
+
+struct suscli_bench_mq_backend {
+  const char *name;
+  enum suscan_mq_backend backend;
+};
+
+SUPRIVATE const struct suscli_bench_mq_backend g_backends[] = {
+  {"locked",   SUSCAN_MQ_BACKEND_LOCKED},
+  {"lockfree", SUSCAN_MQ_BACKEND_LOCKFREE},
+};
+
+#define SUSCLI_BENCH_MQ_BACKEND_COUNT \
+  (sizeof(g_backends) / sizeof(g_backends[0]))
+
+SUPRIVATE const unsigned int g_producers[] = {1, 4, 16};
+
+#define SUSCLI_BENCH_MQ_PRODUCER_COUNT \
+  (sizeof(g_producers) / sizeof(g_producers[0]))
+
+struct suscli_bench_mq_producer {
+  struct suscan_mq *mq;
+  uint32_t id;
+  unsigned int count;
+  SUBOOL ok;
+};
+
+/* Sequence numbers start at 1, so that no message carries NULL */
+SUPRIVATE void *
+suscli_bench_mq_producer_cb(void *userdata)
+{
+  struct suscli_bench_mq_producer *producer =
+    (struct suscli_bench_mq_producer *) userdata;
+  uintptr_t i;
+
+  for (i = 1; i <= producer->count; ++i)
+    if (!suscan_mq_write(producer->mq, producer->id, (void *) i))
+      return NULL;
+
+  producer->ok = SU_TRUE;
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+suscli_bench_mq_run(
+  enum suscan_mq_backend backend,
+  unsigned int producers,
+  unsigned int per_producer,
+  uint64_t *elapsed)
+{
+  struct suscan_mq mq;
+  struct suscli_bench_mq_producer *producer_list = NULL;
+  pthread_t *thread_list = NULL;
+  uintptr_t *last = NULL;
+  struct timeval timeout;
+  uintptr_t seq;
+  uint32_t type;
+  void *privdata;
+  uint64_t start;
+  SUSCOUNT total = (SUSCOUNT) producers * per_producer, got = 0;
+  unsigned int i, started = 0;
+  SUBOOL mq_init = SU_FALSE;
+  SUBOOL in_order = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  timeout.tv_sec  = SUSCLI_BENCH_MQ_READ_TIMEOUT_MS / 1000;
+  timeout.tv_usec = (SUSCLI_BENCH_MQ_READ_TIMEOUT_MS % 1000) * 1000;
+
+  SU_ALLOCATE_MANY(producer_list, producers, struct suscli_bench_mq_producer);
+  SU_ALLOCATE_MANY(thread_list, producers, pthread_t);
+  SU_ALLOCATE_MANY(last, producers, uintptr_t);
+
+  SU_TRY(mq_init = suscan_mq_init_ex(&mq, backend));
+
+  start = suscan_gettime();
+
+  for (i = 0; i < producers; ++i) {
+    producer_list[i].mq    = &mq;
+    producer_list[i].id    = i;
+    producer_list[i].count = per_producer;
+
+    if (pthread_create(
+        thread_list + i,
+        NULL,
+        suscli_bench_mq_producer_cb,
+        producer_list + i) != 0) {
+      SU_ERROR("Failed to create producer thread\n");
+      goto done;
+    }
+
+    ++started;
+  }
+
+  /* A producer that fails to write stops the read loop on timeout */
+  while (got < total) {
+    seq = (uintptr_t) suscan_mq_read_timeout(&mq, &type, &timeout);
+    if (seq == 0) {
+      SU_ERROR(
+        "Timeout after %lu of %lu messages\n",
+        (unsigned long) got,
+        (unsigned long) total);
+      goto done;
+    }
+
+    if (type >= producers || seq != last[type] + 1)
+      in_order = SU_FALSE;
+    else
+      last[type] = seq;
+
+    ++got;
+  }
+
+  *elapsed = suscan_gettime() - start;
+
+  ok = in_order;
+
+done:
+  for (i = 0; i < started; ++i) {
+    pthread_join(thread_list[i], NULL);
+    if (!producer_list[i].ok)
+      ok = SU_FALSE;
+  }
+
+  if (mq_init) {
+    /* Nothing else may be left in the queue */
+    while (suscan_mq_poll(&mq, &type, &privdata))
+      ok = SU_FALSE;
+
+    suscan_mq_finalize(&mq);
+  }
+
+  if (last != NULL)
+    free(last);
+
+  if (thread_list != NULL)
+    free(thread_list);
+
+  if (producer_list != NULL)
+    free(producer_list);
+
+  return ok;
+}
+
+SUBOOL
+suscli_bench_mq(const hashlist_t *params)
+{
+  SUFLOAT rate, ref_rate;
+  uint64_t elapsed;
+  unsigned int i, j, producers;
+  int messages;
+  SUBOOL match;
+  SUBOOL passed = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "messages",
+      &messages,
+      SUSCLI_BENCH_MQ_DEFAULT_MESSAGES));
+
+  if (messages < 1) {
+    SU_ERROR("Invalid messages\n");
+    goto done;
+  }
+
+  for (j = 0; j < SUSCLI_BENCH_MQ_PRODUCER_COUNT; ++j) {
+    producers = g_producers[j];
+    ref_rate  = 0;
+
+    for (i = 0; i < SUSCLI_BENCH_MQ_BACKEND_COUNT; ++i) {
+      elapsed = 0;
+      match = suscli_bench_mq_run(
+        g_backends[i].backend,
+        producers,
+        (messages + producers - 1) / producers,
+        &elapsed);
+
+      rate = suscli_bench_rate(
+        (SUSCOUNT) producers * ((messages + producers - 1) / producers),
+        elapsed);
+
+      if (i == 0)
+        ref_rate = rate;
+
+      fprintf(
+        stderr,
+        "  %-8s %2u producers  %8.2f Mmsg/s  (%.2fx) %s\n",
+        g_backends[i].name,
+        producers,
+        rate,
+        ref_rate > 0 ? rate / ref_rate : 0,
+        match ? "OK" : "FAIL");
+
+      if (!match)
+        passed = SU_FALSE;
+    }
+  }
+
+  ok = passed;
+
+done:
+  return ok;
+}
@@ -0,0 +1,297 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "cli-bench-psk"
+
+#include <sigutils/log.h>
+#include <analyzer/inspector/inspector.h>
+#include <analyzer/inspector/params.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cli/cli.h>
+#include <cli/bench/bench.h>
+
+/*
+ * A synthetic PSK signal is demodulated by two PSK inspectors with the
+ * same configuration. One of them is fed whole buffers, which the
+ * inspector processes in blocks. The other one is fed one sample at a
+ * time, so every stage runs once per sample in the order of the former
+ * per-sample loop. The symbols of both must match, up to the rounding of
+ * folding the gain into the mixer.
+ */
+
+#define SUSCLI_BENCH_PSK_DEFAULT_SAMPLES 1000000
+#define SUSCLI_BENCH_PSK_SAMP_RATE       250000
+#define SUSCLI_BENCH_PSK_SPS             8     /* Samples per symbol */
+#define SUSCLI_BENCH_PSK_PHASE           .3    /* Carrier phase (rad) */
+#define SUSCLI_BENCH_PSK_NOISE           .05   /* Noise amplitude */
+#define SUSCLI_BENCH_PSK_TOLERANCE       1e-4
+
+struct suscli_bench_psk_case {
+  const char *name;
+  unsigned int bits;
+  enum suscan_inspector_carrier_control fc_ctrl;
+  enum suscan_inspector_baudrate_control br_ctrl;
+  enum suscan_inspector_matched_filter mf_conf;
+  enum suscan_inspector_equalizer eq_conf;
+};
+
+SUPRIVATE const struct suscli_bench_psk_case g_cases[] = {
+  {
+    "bpsk",
+    1,
+    SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_2,
+    SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL,
+    SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL,
+    SUSCAN_INSPECTOR_EQUALIZER_BYPASS
+  },
+  {
+    "qpsk",
+    2,
+    SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_4,
+    SUSCAN_INSPECTOR_BAUDRATE_CONTROL_GARDNER,
+    SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL,
+    SUSCAN_INSPECTOR_EQUALIZER_CMA
+  },
+};
+
+#define SUSCLI_BENCH_PSK_CASE_COUNT (sizeof(g_cases) / sizeof(g_cases[0]))
+
+SUPRIVATE void
+suscli_bench_psk_synthesize(
+  SUCOMPLEX *x,
+  SUSCOUNT size,
+  unsigned int bits)
+{
+  SUCOMPLEX carrier = SU_C_EXP(I * SUSCLI_BENCH_PSK_PHASE);
+  SUCOMPLEX symbol = 0;
+  SUSCOUNT i;
+  int n;
+
+  for (i = 0; i < size; ++i) {
+    if (i % SUSCLI_BENCH_PSK_SPS == 0) {
+      n = rand() & ((1 << bits) - 1);
+      symbol = SU_C_EXP(I * (2 * M_PI * n / (1 << bits) + M_PI / 4));
+    }
+
+    x[i] = carrier * symbol
+      + SUSCLI_BENCH_PSK_NOISE
+        * (suscli_bench_rand() + I * suscli_bench_rand());
+  }
+}
+
+SUPRIVATE suscan_inspector_t *
+suscli_bench_psk_open(const struct suscli_bench_psk_case *test)
+{
+  struct suscan_inspector_sampling_info samp_info;
+  suscan_inspector_t *insp = NULL;
+  suscan_config_t *config = NULL;
+  SUFLOAT baud = SUSCLI_BENCH_PSK_SAMP_RATE / SUSCLI_BENCH_PSK_SPS;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&samp_info, 0, sizeof(struct suscan_inspector_sampling_info));
+
+  samp_info.equiv_fs = SUSCLI_BENCH_PSK_SAMP_RATE;
+  samp_info.bw       = SU_ABS2NORM_FREQ(SUSCLI_BENCH_PSK_SAMP_RATE, baud);
+  samp_info.bw_bd    = samp_info.bw;
+
+  SU_TRY(
+    insp = suscan_inspector_new(NULL, "psk", &samp_info, NULL, NULL, NULL));
+
+  SU_TRY(config = suscan_inspector_create_config(insp));
+  SU_TRY(suscan_inspector_get_config(insp, config));
+
+  SU_TRY(suscan_config_set_integer(config, "afc.costas-order", test->fc_ctrl));
+  SU_TRY(suscan_config_set_integer(config, "clock.type", test->br_ctrl));
+  SU_TRY(suscan_config_set_float(config, "clock.baud", baud));
+  SU_TRY(suscan_config_set_bool(config, "clock.running", SU_TRUE));
+  SU_TRY(suscan_config_set_integer(config, "mf.type", test->mf_conf));
+  SU_TRY(suscan_config_set_integer(config, "equalizer.type", test->eq_conf));
+
+  SU_TRY(suscan_inspector_set_config(insp, config));
+  suscan_inspector_assert_params(insp);
+
+  ok = SU_TRUE;
+
+done:
+  if (config != NULL)
+    suscan_config_destroy(config);
+
+  if (!ok && insp != NULL) {
+    suscan_inspector_destroy(insp);
+    insp = NULL;
+  }
+
+  return insp;
+}
+
+/*
+ * Feeds size samples, step samples per call. If out is not NULL, symbols
+ * are saved there. Returns the number of symbols, or -1 on error.
+ */
+SUPRIVATE SUSDIFF
+suscli_bench_psk_run(
+  suscan_inspector_t *insp,
+  const SUCOMPLEX *x,
+  SUSCOUNT size,
+  SUSCOUNT step,
+  SUCOMPLEX *out,
+  SUSCOUNT out_size)
+{
+  SUSCOUNT i = 0, symbols = 0, len;
+  SUSDIFF fed;
+
+  while (i < size) {
+    len = MIN(step, size - i);
+
+    if ((fed = suscan_inspector_feed_bulk(insp, x + i, len)) < 0)
+      return -1;
+
+    if (out != NULL) {
+      len = MIN(suscan_inspector_get_output_length(insp), out_size - symbols);
+      memcpy(
+        out + symbols,
+        suscan_inspector_get_output_buffer(insp),
+        len * sizeof(SUCOMPLEX));
+    }
+
+    symbols += suscan_inspector_get_output_length(insp);
+    insp->sampler_ptr = 0;
+    i += fed;
+  }
+
+  return symbols;
+}
+
+SUBOOL
+suscli_bench_psk(const hashlist_t *params)
+{
+  const struct suscli_bench_psk_case *test;
+  suscan_inspector_t *block_insp = NULL, *sample_insp = NULL;
+  SUCOMPLEX *input = NULL, *block_out = NULL, *sample_out = NULL;
+  SUSDIFF block_syms, sample_syms;
+  SUSCOUNT j, out_size;
+  SUFLOAT err, block_rate, sample_rate;
+  uint64_t start, block_ns, sample_ns;
+  int samples, seed;
+  unsigned int k;
+  SUBOOL passed = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "samples",
+      &samples,
+      SUSCLI_BENCH_PSK_DEFAULT_SAMPLES));
+  SU_TRY(
+    suscli_param_read_int(params, "seed", &seed, SUSCLI_BENCH_DEFAULT_SEED));
+
+  if (samples < 1) {
+    SU_ERROR("Invalid number of samples\n");
+    goto done;
+  }
+
+  out_size = samples / SUSCLI_BENCH_PSK_SPS + 1;
+
+  SU_ALLOCATE_MANY(input,      samples,  SUCOMPLEX);
+  SU_ALLOCATE_MANY(block_out,  out_size, SUCOMPLEX);
+  SU_ALLOCATE_MANY(sample_out, out_size, SUCOMPLEX);
+
+  for (k = 0; k < SUSCLI_BENCH_PSK_CASE_COUNT; ++k) {
+    test = g_cases + k;
+
+    srand(seed);
+    suscli_bench_psk_synthesize(input, samples, test->bits);
+
+    SU_TRY(block_insp  = suscli_bench_psk_open(test));
+    SU_TRY(sample_insp = suscli_bench_psk_open(test));
+
+    start = suscan_gettime();
+    block_syms = suscli_bench_psk_run(
+      block_insp,
+      input,
+      samples,
+      samples,
+      block_out,
+      out_size);
+    block_ns = suscan_gettime() - start;
+
+    start = suscan_gettime();
+    sample_syms = suscli_bench_psk_run(
+      sample_insp,
+      input,
+      samples,
+      1,
+      sample_out,
+      out_size);
+    sample_ns = suscan_gettime() - start;
+
+    SU_TRY(block_syms >= 0 && sample_syms >= 0);
+
+    err = block_syms == sample_syms ? 0 : INFINITY;
+    for (j = 0; j < MIN(MIN(block_syms, sample_syms), out_size); ++j)
+      if (SU_C_ABS(block_out[j] - sample_out[j]) > err)
+        err = SU_C_ABS(block_out[j] - sample_out[j]);
+
+    block_rate  = suscli_bench_rate(samples, block_ns);
+    sample_rate = suscli_bench_rate(samples, sample_ns);
+
+    fprintf(
+      stderr,
+      "  %-5s %8lld symbols  max error %9.3e (tolerance %7.1e) %s  "
+      "per-sample %7.2f Msps  block %7.2f Msps  (%.2fx)\n",
+      test->name,
+      (long long) block_syms,
+      err,
+      SUSCLI_BENCH_PSK_TOLERANCE,
+      err <= SUSCLI_BENCH_PSK_TOLERANCE ? "OK  " : "FAIL",
+      sample_rate,
+      block_rate,
+      sample_rate > 0 ? block_rate / sample_rate : 0);
+
+    if (!(err <= SUSCLI_BENCH_PSK_TOLERANCE))
+      passed = SU_FALSE;
+
+    suscan_inspector_destroy(block_insp);
+    suscan_inspector_destroy(sample_insp);
+    block_insp = sample_insp = NULL;
+  }
+
+  ok = passed;
+
+done:
+  if (block_insp != NULL)
+    suscan_inspector_destroy(block_insp);
+
+  if (sample_insp != NULL)
+    suscan_inspector_destroy(sample_insp);
+
+  if (input != NULL)
+    free(input);
+
+  if (block_out != NULL)
+    free(block_out);
+
+  if (sample_out != NULL)
+    free(sample_out);
+
+  return ok;
+}
@@ -0,0 +1,229 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "cli-bench-remote"
+
+#include <sigutils/log.h>
+#include <analyzer/msg.h>
+#include <analyzer/impl/remote.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <cli/cli.h>
+#include <cli/bench/bench.h>
+
+/*
+ * Serialized PSD messages of several sizes are compressed and inflated
+ * back, first with the one-shot suscan_remote_deflate_pdu and
+ * suscan_remote_inflate_pdu (a new zlib stream per PDU), and then with
+ * the reusable deflater and inflater of a connection. Both round trips
+ * must return the serialized message byte by byte. Rates are given in
+ * PDUs per second and in uncompressed bytes per second.
+ */
+
+#define SUSCLI_BENCH_REMOTE_DEFAULT_ITERS 500
+#define SUSCLI_BENCH_REMOTE_SAMP_RATE     1e6
+
+SUPRIVATE const unsigned int g_psd_sizes[] = {256, 1024, 4096, 8192, 32768};
+
+#define SUSCLI_BENCH_REMOTE_SIZE_COUNT \
+  (sizeof(g_psd_sizes) / sizeof(g_psd_sizes[0]))
+
+/*
+ * Noise floor with a few carriers on top. Bins are exponentially
+ * distributed around their mean, as in an averaged periodogram.
+ */
+SUPRIVATE void
+suscli_bench_remote_fill_psd(SUFLOAT *psd, unsigned int size)
+{
+  unsigned int i;
+  SUFLOAT mean, u;
+
+  for (i = 0; i < size; ++i) {
+    mean = 1e-6;
+
+    if (i % (size / 8) < size / 64)
+      mean += 1e-3;
+
+    u = (suscli_bench_rand() + 1) / 2;
+    psd[i] = -mean * log(u + 1e-12);
+  }
+}
+
+SUPRIVATE SUBOOL
+suscli_bench_remote_check(const grow_buf_t *pdu, const grow_buf_t *buf)
+{
+  return grow_buf_get_size(pdu) == grow_buf_get_size(buf)
+    && memcmp(
+      grow_buf_get_buffer(pdu),
+      grow_buf_get_buffer(buf),
+      grow_buf_get_size(pdu)) == 0;
+}
+
+/* The compressed buffer holds the inflated PDU on return */
+SUPRIVATE SUBOOL
+suscli_bench_remote_oneshot(const grow_buf_t *pdu, grow_buf_t *cmp)
+{
+  grow_buf_shrink(cmp);
+
+  SU_TRYCATCH(
+    suscan_remote_deflate_pdu((grow_buf_t *) pdu, cmp),
+    return SU_FALSE);
+  SU_TRYCATCH(suscan_remote_inflate_pdu(cmp), return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscli_bench_remote_reused(
+  struct suscan_remote_deflater *deflater,
+  struct suscan_remote_inflater *inflater,
+  const grow_buf_t *pdu,
+  grow_buf_t *cmp)
+{
+  SU_TRYCATCH(
+    suscan_remote_deflater_deflate(deflater, pdu, cmp),
+    return SU_FALSE);
+  SU_TRYCATCH(
+    suscan_remote_inflater_inflate(inflater, cmp),
+    return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscli_bench_remote(const hashlist_t *params)
+{
+  struct suscan_remote_deflater deflater;
+  struct suscan_remote_inflater inflater;
+  struct suscan_analyzer_psd_msg msg;
+  grow_buf_t pdu = grow_buf_INITIALIZER;
+  grow_buf_t cmp = grow_buf_INITIALIZER;
+  SUFLOAT *psd = NULL;
+  SUFLOAT ratio;
+  SUFLOAT oneshot_rate, reused_rate;
+  uint64_t start, oneshot_ns, reused_ns;
+  SUSCOUNT bytes;
+  unsigned int i;
+  int iters, seed, j;
+  SUBOOL passed = SU_TRUE;
+  SUBOOL match;
+  SUBOOL ok = SU_FALSE;
+
+  suscan_remote_deflater_init(
+    &deflater,
+    SUSCAN_REMOTE_DEFAULT_COMPRESS_LEVEL,
+    SUSCAN_REMOTE_DEFAULT_COMPRESS_STRATEGY);
+  memset(&inflater, 0, sizeof(struct suscan_remote_inflater));
+
+  SU_TRY(
+    suscli_param_read_int(
+      params,
+      "iters",
+      &iters,
+      SUSCLI_BENCH_REMOTE_DEFAULT_ITERS));
+  SU_TRY(
+    suscli_param_read_int(params, "seed", &seed, SUSCLI_BENCH_DEFAULT_SEED));
+
+  if (iters < 1) {
+    SU_ERROR("Invalid iters\n");
+    goto done;
+  }
+
+  SU_ALLOCATE_MANY(
+    psd,
+    g_psd_sizes[SUSCLI_BENCH_REMOTE_SIZE_COUNT - 1],
+    SUFLOAT);
+
+  srand(seed);
+
+  for (i = 0; i < SUSCLI_BENCH_REMOTE_SIZE_COUNT; ++i) {
+    suscli_bench_remote_fill_psd(psd, g_psd_sizes[i]);
+
+    memset(&msg, 0, sizeof(struct suscan_analyzer_psd_msg));
+    msg.samp_rate          = SUSCLI_BENCH_REMOTE_SAMP_RATE;
+    msg.measured_samp_rate = SUSCLI_BENCH_REMOTE_SAMP_RATE;
+    msg.psd_size           = g_psd_sizes[i];
+    msg.psd_data           = psd;
+    gettimeofday(&msg.rt_time, NULL);
+    msg.timestamp          = msg.rt_time;
+
+    grow_buf_shrink(&pdu);
+    SU_TRY(suscan_analyzer_psd_msg_serialize(&msg, &pdu));
+
+    /* One-shot streams */
+    SU_TRY(suscli_bench_remote_oneshot(&pdu, &cmp));
+    match = suscli_bench_remote_check(&pdu, &cmp);
+
+    start = suscan_gettime();
+    for (j = 0; j < iters; ++j)
+      SU_TRY(suscli_bench_remote_oneshot(&pdu, &cmp));
+    oneshot_ns = suscan_gettime() - start;
+
+    /* Reused streams. The first PDU also measures the compressed size. */
+    SU_TRY(suscan_remote_deflater_deflate(&deflater, &pdu, &cmp));
+    ratio = grow_buf_get_size(&cmp) > 0
+      ? grow_buf_get_size(&pdu) / (SUFLOAT) grow_buf_get_size(&cmp)
+      : 0;
+    SU_TRY(suscan_remote_inflater_inflate(&inflater, &cmp));
+    match = match && suscli_bench_remote_check(&pdu, &cmp);
+
+    start = suscan_gettime();
+    for (j = 0; j < iters; ++j)
+      SU_TRY(suscli_bench_remote_reused(&deflater, &inflater, &pdu, &cmp));
+    reused_ns = suscan_gettime() - start;
+
+    bytes        = (SUSCOUNT) iters * grow_buf_get_size(&pdu);
+    oneshot_rate = 1e6 * suscli_bench_rate(iters, oneshot_ns);
+    reused_rate  = 1e6 * suscli_bench_rate(iters, reused_ns);
+
+    fprintf(
+      stderr,
+      "  psd %5u (%6lu bytes, ratio %5.2f) round trip %s  "
+      "one-shot %8.1f PDU/s %8.2f MB/s  "
+      "reused %8.1f PDU/s %8.2f MB/s  (%.2fx)\n",
+      g_psd_sizes[i],
+      (unsigned long) grow_buf_get_size(&pdu),
+      ratio,
+      match ? "OK  " : "FAIL",
+      oneshot_rate,
+      suscli_bench_rate(bytes, oneshot_ns),
+      reused_rate,
+      suscli_bench_rate(bytes, reused_ns),
+      oneshot_rate > 0 ? reused_rate / oneshot_rate : 0);
+
+    if (!match)
+      passed = SU_FALSE;
+  }
+
+  ok = passed;
+
+done:
+  suscan_remote_deflater_finalize(&deflater);
+  suscan_remote_inflater_finalize(&inflater);
+
+  grow_buf_finalize(&pdu);
+  grow_buf_finalize(&cmp);
+
+  if (psd != NULL)
+    free(psd);
+
+  return ok;
+}
@@ -58,6 +58,7 @@ suscli_chanloop_open(
   /* Neither PSD nor channel detector */
   analyzer_params.channel_update_int = 0;
   analyzer_params.psd_update_int     = 0;
+  analyzer_params.free_run           = params->free_run;
 
   SU_TRYCATCH(new = calloc(1, sizeof(suscli_chanloop_t)), goto fail);
 
@@ -173,6 +174,7 @@ SUBOOL
 suscli_chanloop_work(suscli_chanloop_t *self)
 {
   struct suscan_analyzer_sample_batch_msg *msg;
+  struct suscan_analyzer_status_msg *status;
   void *rawmsg;
   uint32_t type;
   struct timeval timeout;
@@ -187,6 +189,9 @@ suscli_chanloop_work(suscli_chanloop_t *self)
         &timeout)) != NULL) {
       switch (type) {
         case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+          status = rawmsg;
+          if (self->params.free_run && status->message != NULL)
+            fprintf(stderr, "%s\n", status->message);
           suscan_analyzer_dispose_message(type, rawmsg);
           ok = SU_TRUE;
           goto fail;
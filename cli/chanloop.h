@@ -29,6 +29,7 @@ struct suscli_chanloop_params {
   void *userdata;
   SUBOOL (*on_data) (suscan_analyzer_t *, const SUCOMPLEX *, size_t, void *);
   SUBOOL (*on_open) (suscan_analyzer_t *, suscan_config_t *, void *);
+  SUBOOL free_run; /* File sources: do not throttle, report throughput */
 };
 
 #define suscli_chanloop_params_INITIALIZER      \
@@ -38,6 +39,8 @@ struct suscli_chanloop_params {
   NULL, /* type */                              \
   NULL, /* userdata */                          \
   NULL, /* on_data */                           \
+  NULL, /* on_open */                           \
+  SU_FALSE, /* free_run */                      \
 }
 
 struct suscli_chanloop {
@@ -588,6 +588,22 @@ suscli_init(void)
           suscli_snoop_cb) != -1,
       goto fail);
 
+  SU_TRYCATCH(
+      suscli_command_register(
+          "psdscan",
+          "Compute the spectrogram of a recording using all CPUs",
+          SUSCLI_COMMAND_REQ_SOURCES,
+          suscli_psdscan_cb) != -1,
+      goto fail);
+
+  SU_TRYCATCH(
+      suscli_command_register(
+          "bench",
+          "Check and benchmark the optimized signal processing paths",
+          SUSCLI_COMMAND_REQ_INSPECTORS,
+          suscli_bench_cb) != -1,
+      goto fail);
+
   ok = SU_TRUE;
 
 fail:
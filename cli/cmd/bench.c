@@ -0,0 +1,109 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "cli-bench"
+
+#include <sigutils/log.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cli/cli.h>
+#include <cli/cmds.h>
+#include <cli/bench/bench.h>
+
+/*
+ * bench runs the regression and throughput checks of the hot paths of the
+ * library. suite=NAME runs a single suite, and suite=all (the default)
+ * runs all of them.
+ */
+
+SUPRIVATE const struct suscli_bench_suite g_suites[] = {
+  {
+    "kernels",
+    "Spectrum source preprocessing kernels vs. libm loops",
+    suscli_bench_kernels
+  },
+  {
+    "decimator",
+    "Source antialias decimator vs. per-sample accumulators",
+    suscli_bench_decimator
+  },
+  {
+    "psk",
+    "PSK inspector in blocks vs. sample by sample",
+    suscli_bench_psk
+  },
+  {
+    "remote",
+    "Remote PDU compression with reused vs. one-shot zlib streams",
+    suscli_bench_remote
+  },
+  {
+    "inspsched",
+    "Inspector scheduler policies vs. serial processing",
+    suscli_bench_inspsched
+  },
+  {
+    "mq",
+    "Lock-free vs. locked message queues with several producers",
+    suscli_bench_mq
+  },
+};
+
+#define SUSCLI_BENCH_SUITE_COUNT (sizeof(g_suites) / sizeof(g_suites[0]))
+
+SUBOOL
+suscli_bench_cb(const hashlist_t *params)
+{
+  const char *suite;
+  unsigned int i;
+  SUBOOL found = SU_FALSE;
+  SUBOOL passed = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRY(suscli_param_read_string(params, "suite", &suite, "all"));
+
+  for (i = 0; i < SUSCLI_BENCH_SUITE_COUNT; ++i) {
+    if (strcmp(suite, "all") != 0 && strcmp(suite, g_suites[i].name) != 0)
+      continue;
+
+    found = SU_TRUE;
+
+    fprintf(stderr, "%s: %s\n", g_suites[i].name, g_suites[i].desc);
+
+    if (!(g_suites[i].run) (params)) {
+      fprintf(stderr, "%s: FAILED\n\n", g_suites[i].name);
+      passed = SU_FALSE;
+    } else {
+      fprintf(stderr, "%s: passed\n\n", g_suites[i].name);
+    }
+  }
+
+  if (!found) {
+    SU_ERROR("Unknown suite `%s'. Available suites:\n", suite);
+    for (i = 0; i < SUSCLI_BENCH_SUITE_COUNT; ++i)
+      SU_ERROR("  %-10s %s\n", g_suites[i].name, g_suites[i].desc);
+    goto done;
+  }
+
+  ok = passed;
+
+done:
+  return ok;
+}
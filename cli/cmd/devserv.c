@@ -30,7 +30,9 @@
 #include <analyzer/discovery.h>
 #include <analyzer/version.h>
 #include <string.h>
+#include <strings.h>
 #include <pthread.h>
+#include <zlib.h>
 
 #include <cli/devserv/devserv.h>
 #include <cli/cli.h>
@@ -179,13 +181,12 @@ SUPRIVATE struct suscli_devserv_ctx *
 suscli_devserv_ctx_new(
     const char *iface,
     const char *mcaddr,
-    size_t compress_threshold)
+    const struct suscli_analyzer_server_params *template)
 {
   struct suscli_devserv_ctx *new = NULL;
   suscan_source_config_t *cfg;
   suscli_analyzer_server_t *server = NULL;
-  struct suscli_analyzer_server_params params =
-    suscli_analyzer_server_params_INITIALIZER;
+  struct suscli_analyzer_server_params params = *template;
   int i;
   char loopch = 0;
   struct in_addr mc_if;
@@ -251,8 +252,7 @@ suscli_devserv_ctx_new(
   new->mc_addr.sin_addr.s_addr = inet_addr(mcaddr);
   new->mc_addr.sin_port = htons(SURPC_DISCOVERY_PROTOCOL_PORT);
 
-  params.compress_threshold = compress_threshold;
-  params.ifname             = iface;
+  params.ifname = iface;
 
   /* Populate servers */
   for (i = 1; i <= suscli_get_source_count(); ++i) {
@@ -374,12 +374,38 @@ done:
   return NULL;
 }
 
+SUPRIVATE SUBOOL
+suscli_devserv_parse_compress_strategy(const char *name, int *strategy)
+{
+  if (strcasecmp(name, "default") == 0)
+    *strategy = Z_DEFAULT_STRATEGY;
+  else if (strcasecmp(name, "filtered") == 0)
+    *strategy = Z_FILTERED;
+  else if (strcasecmp(name, "huffman") == 0)
+    *strategy = Z_HUFFMAN_ONLY;
+  else if (strcasecmp(name, "rle") == 0)
+    *strategy = Z_RLE;
+  else if (strcasecmp(name, "fixed") == 0)
+    *strategy = Z_FIXED;
+  else
+    return SU_FALSE;
+
+  return SU_TRUE;
+}
+
 SUBOOL
 suscli_devserv_cb(const hashlist_t *params)
 {
   struct suscli_devserv_ctx *ctx = NULL;
-  const char *iface, *mc;
+  struct suscli_analyzer_compress_params compress =
+    suscli_analyzer_compress_params_INITIALIZER;
+  struct suscli_analyzer_server_params server_params =
+    suscli_analyzer_server_params_INITIALIZER;
+  const char *iface, *mc, *strategy;
   int threshold = 0;
+  int level = SUSCAN_REMOTE_DEFAULT_COMPRESS_LEVEL;
+  int mtu = SUSCLI_MULTICAST_FRAGMENT_MTU;
+  int capture_ring = 0;
 
   pthread_t thread;
   SUBOOL thread_running = SU_FALSE;
@@ -399,6 +425,87 @@ suscli_devserv_cb(const hashlist_t *params)
         0),
       goto done);
 
+  SU_TRYCATCH(
+      suscli_param_read_int(
+        params,
+        "compress_level",
+        &level,
+        SUSCAN_REMOTE_DEFAULT_COMPRESS_LEVEL),
+      goto done);
+
+  SU_TRYCATCH(
+      suscli_param_read_string(
+        params,
+        "compress_strategy",
+        &strategy,
+        "default"),
+      goto done);
+
+  if (level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION) {
+    fprintf(
+      stderr,
+      "devserv: invalid compression level %d (must be between %d and %d)\n",
+      level,
+      Z_NO_COMPRESSION,
+      Z_BEST_COMPRESSION);
+    goto done;
+  }
+
+  if (!suscli_devserv_parse_compress_strategy(strategy, &compress.strategy)) {
+    fprintf(
+      stderr,
+      "devserv: invalid compression strategy `%s' (valid values are "
+      "default, filtered, huffman, rle and fixed)\n",
+      strategy);
+    goto done;
+  }
+
+  compress.threshold = threshold;
+  compress.level     = level;
+
+  SU_TRYCATCH(
+      suscli_param_read_int(
+        params,
+        "mtu",
+        &mtu,
+        SUSCLI_MULTICAST_FRAGMENT_MTU),
+      goto done);
+
+  if (mtu < SUSCLI_MULTICAST_FRAGMENT_MTU 
+    || mtu > SUSCLI_MULTICAST_MAX_FRAGMENT_MTU) {
+    fprintf(
+      stderr,
+      "devserv: invalid multicast MTU %d (must be between %d and %d)\n",
+      mtu,
+      SUSCLI_MULTICAST_FRAGMENT_MTU,
+      SUSCLI_MULTICAST_MAX_FRAGMENT_MTU);
+    goto done;
+  }
+
+  SU_TRYCATCH(
+      suscli_param_read_int(
+        params,
+        "capture_ring",
+        &capture_ring,
+        0),
+      goto done);
+
+  if (capture_ring != 0 
+    && capture_ring < SUSCAN_SOURCE_CAPTURE_RING_MIN_DEPTH) {
+    fprintf(
+      stderr,
+      "devserv: invalid capture ring depth %d (must be 0 or at least %d)\n",
+      capture_ring,
+      SUSCAN_SOURCE_CAPTURE_RING_MIN_DEPTH);
+    goto done;
+  }
+
+  server_params.compress_threshold = compress.threshold;
+  server_params.compress_level     = compress.level;
+  server_params.compress_strategy  = compress.strategy;
+  server_params.mc_mtu             = mtu;
+  server_params.capture_ring_depth = capture_ring;
+
   if (iface == NULL) {
     fprintf(
         stderr,
@@ -452,7 +559,7 @@ suscli_devserv_cb(const hashlist_t *params)
       ctx = suscli_devserv_ctx_new(
         iface, 
         mc, 
-        threshold),
+        &server_params),
       goto done);
 
   SU_TRYCATCH(
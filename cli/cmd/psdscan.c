@@ -0,0 +1,374 @@
+/*
+
+  Copyright (C) 2022 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, version 3.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "cli-psdscan"
+
+#include <sigutils/log.h>
+#include <sigutils/smoothpsd.h>
+#include <analyzer/source.h>
+#include <analyzer/segproc.h>
+#include <analyzer/realtime.h>
+#include <analyzer/msg.h>
+#include <signal.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <cli/cli.h>
+#include <cli/cmds.h>
+
+/*
+ * psdscan computes the spectrogram of a recording, splitting it in
+ * segments that are processed in parallel. Every line of the output is
+ * a PSD frame: its timestamp followed by the power of each bin (in dB,
+ * negative frequencies first).
+ */
+
+#define SUSCLI_PSDSCAN_DEFAULT_FFT_SIZE 8192
+#define SUSCLI_PSDSCAN_DEFAULT_RATE     25.
+
+struct suscli_psdscan_params {
+  suscan_source_config_t *profile;
+  int         threads;
+  int         fft_size;
+  SUFLOAT     rate;     /* PSD frames per second of recording */
+  SUFLOAT     segment;  /* Segment length in seconds (0: automatic) */
+  SUFLOAT     overlap;  /* Warm-up seconds (default: one frame) */
+  const char *output;
+};
+
+struct suscli_psdscan_state {
+  struct suscli_psdscan_params params;
+  FILE    *fp;
+  uint64_t frames;
+};
+
+/*
+ * Frames are emitted from inside su_smoothpsd_feed, so the time of the
+ * source (the end of the block read) is not the time of the frame. Blocks
+ * are fed in chunks of one FFT window instead, and frames are timestamped
+ * with the end of the chunk that completed them.
+ */
+struct suscli_psdscan_segment {
+  struct suscan_segproc_segment *seg;
+  su_smoothpsd_t *psd;
+  SUFLOAT  samp_rate;
+  SUSCOUNT chunk;       /* Samples per call to su_smoothpsd_feed */
+  SUSCOUNT decim;       /* Source samples per fed sample */
+  SUSCOUNT source_rate; /* Sample rate of the file */
+  SUSCOUNT pos;         /* Source sample after the chunk being fed */
+  struct timeval start; /* Time of the first sample of the file */
+};
+
+SUPRIVATE suscan_segproc_t *g_segproc = NULL;
+
+SUPRIVATE void
+suscli_psdscan_int_handler(int sig)
+{
+  if (g_segproc != NULL)
+    suscan_segproc_cancel(g_segproc);
+}
+
+/**************************** Segment pipeline *******************************/
+SUPRIVATE void
+suscli_psdscan_segment_get_time(
+  const struct suscli_psdscan_segment *state,
+  struct timeval *tv)
+{
+  struct timeval elapsed;
+
+  elapsed.tv_sec  = state->pos / state->source_rate;
+  elapsed.tv_usec =
+    (1000000 * (state->pos - elapsed.tv_sec * state->source_rate))
+    / state->source_rate;
+
+  timeradd(&state->start, &elapsed, tv);
+}
+
+SUPRIVATE SUBOOL
+suscli_psdscan_on_psd(void *userdata, const SUFLOAT *psd, unsigned int size)
+{
+  struct suscli_psdscan_segment *state =
+    (struct suscli_psdscan_segment *) userdata;
+  struct suscan_analyzer_psd_msg *msg = NULL;
+
+  /* Do not even build frames that would be discarded */
+  if (suscan_segproc_segment_is_warming_up(state->seg))
+    return SU_TRUE;
+
+  SU_TRYCATCH(
+    msg = suscan_analyzer_psd_msg_new_from_data(state->samp_rate, psd, size),
+    return SU_FALSE);
+
+  suscli_psdscan_segment_get_time(state, &msg->timestamp);
+
+  return suscan_segproc_segment_emit(
+    state->seg,
+    SUSCAN_ANALYZER_MESSAGE_TYPE_PSD,
+    msg);
+}
+
+SUPRIVATE void *
+suscli_psdscan_segment_open(void *userdata, struct suscan_segproc_segment *seg)
+{
+  struct suscli_psdscan_state *state = (struct suscli_psdscan_state *) userdata;
+  struct sigutils_smoothpsd_params params =
+    sigutils_smoothpsd_params_INITIALIZER;
+  struct suscli_psdscan_segment *new = NULL;
+
+  SU_ALLOCATE_FAIL(new, struct suscli_psdscan_segment);
+
+  new->seg         = seg;
+  new->samp_rate   = suscan_source_get_samp_rate(seg->source);
+  new->chunk       = state->params.fft_size;
+  new->decim       = seg->source->decim > 1 ? seg->source->decim : 1;
+  new->source_rate = suscan_source_config_get_samp_rate(
+    suscan_source_get_config(seg->source));
+  suscan_source_get_start_time(seg->source, &new->start);
+
+  if (new->source_rate == 0) {
+    SU_ERROR("Source has no sample rate\n");
+    goto fail;
+  }
+
+  params.fft_size     = state->params.fft_size;
+  params.samp_rate    = new->samp_rate;
+  params.refresh_rate = state->params.rate;
+
+  SU_TRY_FAIL(
+    new->psd = su_smoothpsd_new(&params, suscli_psdscan_on_psd, new));
+
+  return new;
+
+fail:
+  if (new != NULL)
+    free(new);
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+suscli_psdscan_segment_feed(
+  void *userdata,
+  struct suscan_segproc_segment *seg,
+  const SUCOMPLEX *data,
+  SUSCOUNT size)
+{
+  struct suscli_psdscan_segment *state =
+    (struct suscli_psdscan_segment *) seg->privdata;
+  SUSCOUNT chunk;
+
+  state->pos = seg->pos;
+
+  while (size > 0) {
+    chunk       = MIN(size, state->chunk);
+    state->pos += chunk * state->decim;
+
+    SU_TRYCATCH(
+      su_smoothpsd_feed(state->psd, data, chunk),
+      return SU_FALSE);
+
+    data += chunk;
+    size -= chunk;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscli_psdscan_segment_close(void *userdata, struct suscan_segproc_segment *seg)
+{
+  struct suscli_psdscan_segment *state =
+    (struct suscli_psdscan_segment *) seg->privdata;
+
+  if (state->psd != NULL)
+    su_smoothpsd_destroy(state->psd);
+
+  free(state);
+}
+
+/****************************** Merged output ********************************/
+SUPRIVATE SUBOOL
+suscli_psdscan_write_frame(
+  struct suscli_psdscan_state *state,
+  const struct suscan_analyzer_psd_msg *msg)
+{
+  SUSCOUNT i, half = msg->psd_size / 2;
+
+  SU_TRYCATCH(
+    fprintf(
+      state->fp,
+      "%ld.%06ld",
+      (long) msg->timestamp.tv_sec,
+      (long) msg->timestamp.tv_usec) > 0,
+    return SU_FALSE);
+
+  for (i = 0; i < msg->psd_size; ++i)
+    SU_TRYCATCH(
+      fprintf(
+        state->fp,
+        ",%.2f",
+        SU_POWER_DB_RAW(msg->psd_data[(i + half) % msg->psd_size])) > 0,
+      return SU_FALSE);
+
+  SU_TRYCATCH(fputc('\n', state->fp) != EOF, return SU_FALSE);
+
+  ++state->frames;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscli_psdscan_on_output(
+  void *userdata,
+  const struct suscan_segproc_segment *seg,
+  uint32_t type,
+  void *ptr)
+{
+  struct suscli_psdscan_state *state = (struct suscli_psdscan_state *) userdata;
+  SUBOOL ok = SU_TRUE;
+
+  if (type == SUSCAN_ANALYZER_MESSAGE_TYPE_PSD)
+    ok = suscli_psdscan_write_frame(state, ptr);
+
+  suscan_analyzer_dispose_message(type, ptr);
+
+  return ok;
+}
+
+/******************************** Command ************************************/
+SUPRIVATE SUBOOL
+suscli_psdscan_params_parse(
+  struct suscli_psdscan_params *self,
+  const hashlist_t *p)
+{
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRY(suscli_param_read_profile(p, "profile", &self->profile));
+
+  if (self->profile == NULL) {
+    SU_ERROR("Suscan is unable to load any valid profile\n");
+    goto done;
+  }
+
+  SU_TRY(suscli_param_read_int(p, "threads", &self->threads, 0));
+  SU_TRY(
+    suscli_param_read_int(
+      p,
+      "fft_size",
+      &self->fft_size,
+      SUSCLI_PSDSCAN_DEFAULT_FFT_SIZE));
+  SU_TRY(
+    suscli_param_read_float(
+      p,
+      "rate",
+      &self->rate,
+      SUSCLI_PSDSCAN_DEFAULT_RATE));
+  SU_TRY(suscli_param_read_float(p, "segment", &self->segment, 0));
+  SU_TRY(suscli_param_read_float(p, "overlap", &self->overlap, -1));
+  SU_TRY(suscli_param_read_string(p, "output", &self->output, NULL));
+
+  if (self->threads < 0 || self->fft_size < 2 || self->rate <= 0) {
+    SU_ERROR("Invalid threads, fft_size or rate\n");
+    goto done;
+  }
+
+  /* One full frame of warm-up by default */
+  if (self->overlap < 0)
+    self->overlap = 1. / self->rate;
+
+  ok = SU_TRUE;
+
+done:
+  return ok;
+}
+
+SUBOOL
+suscli_psdscan_cb(const hashlist_t *params)
+{
+  struct suscli_psdscan_state state;
+  struct suscan_segproc_params sp_params = suscan_segproc_params_INITIALIZER;
+  suscan_segproc_t *segproc = NULL;
+  SUFLOAT samp_rate;
+  uint64_t start;
+  SUFLOAT elapsed;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&state, 0, sizeof(struct suscli_psdscan_state));
+
+  SU_TRY(suscli_psdscan_params_parse(&state.params, params));
+
+  if (state.params.output != NULL) {
+    if ((state.fp = fopen(state.params.output, "w")) == NULL) {
+      SU_ERROR(
+        "Cannot open %s for writing: %s\n",
+        state.params.output,
+        strerror(errno));
+      goto done;
+    }
+  } else {
+    state.fp = stdout;
+  }
+
+  samp_rate = suscan_source_config_get_samp_rate(state.params.profile);
+
+  sp_params.threads      = state.params.threads;
+  sp_params.segment_size = state.params.segment * samp_rate;
+  sp_params.overlap      = state.params.overlap * samp_rate;
+  sp_params.userdata     = &state;
+  sp_params.open         = suscli_psdscan_segment_open;
+  sp_params.feed         = suscli_psdscan_segment_feed;
+  sp_params.close        = suscli_psdscan_segment_close;
+  sp_params.on_output    = suscli_psdscan_on_output;
+
+  SU_MAKE(segproc, suscan_segproc, state.params.profile, &sp_params);
+
+  fprintf(
+    stderr,
+    "Processing %u segments with %u threads\n",
+    suscan_segproc_get_segment_count(segproc),
+    suscan_segproc_get_worker_count(segproc));
+
+  g_segproc = segproc;
+  signal(SIGINT, suscli_psdscan_int_handler);
+
+  start = suscan_gettime();
+  SU_TRY(suscan_segproc_run(segproc));
+  elapsed = (suscan_gettime() - start) * 1e-9;
+
+  fprintf(
+    stderr,
+    "%llu PSD frames written in %.3f s (%.3f Msps)\n",
+    (unsigned long long) state.frames,
+    elapsed,
+    elapsed > 0 ? 1e-6 * segproc->total / elapsed : 0);
+
+  ok = SU_TRUE;
+
+done:
+  signal(SIGINT, SIG_DFL);
+  g_segproc = NULL;
+
+  if (segproc != NULL)
+    suscan_segproc_destroy(segproc);
+
+  if (state.fp != NULL && state.fp != stdout)
+    fclose(state.fp);
+
+  return ok;
+}
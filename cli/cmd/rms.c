@@ -62,6 +62,7 @@ struct suscli_rms_params {
   suscan_source_config_t *profile;
   enum suscli_rms_mode mode;
   SUBOOL  audio;
+  SUBOOL  free_run;
   int     samp_rate;
   SUFLOAT db_min;
   SUFLOAT db_max;
@@ -343,6 +344,10 @@ suscli_rms_params_debug(const struct suscli_rms_params *self)
       stderr,
       "  Audio: %s\n",
       self->audio ? "ON" : "OFF");
+  fprintf(
+      stderr,
+      "  Free-running: %s\n",
+      self->free_run ? "ON" : "OFF");
 
   if (self->audio) {
     fprintf(
@@ -405,6 +410,14 @@ suscli_rms_params_parse(
           SU_FALSE),
       goto fail);
 
+  SU_TRYCATCH(
+      suscli_param_read_bool(
+          p,
+          "freerun",
+          &self->free_run,
+          SU_FALSE),
+      goto fail);
+
   SU_TRYCATCH(
       suscli_param_read_int(
           p,
@@ -779,6 +792,7 @@ suscli_rms_cb(const hashlist_t *params)
   chanloop_params.userdata = &state;
   chanloop_params.rello    = SU_ASFLOAT(-1./6.);
   chanloop_params.relbw    = SU_ASFLOAT(1./3.15);
+  chanloop_params.free_run = state.params.free_run;
 
   SU_TRYCATCH(
       chanloop = suscli_chanloop_open(
@@ -32,5 +32,7 @@ SUBOOL suscli_devices_cb(const hashlist_t *params);
 SUBOOL suscli_makeprof_cb(const hashlist_t *params);
 SUBOOL suscli_tleinfo_cb(const hashlist_t *params);
 SUBOOL suscli_snoop_cb(const hashlist_t *params);
+SUBOOL suscli_psdscan_cb(const hashlist_t *params);
+SUBOOL suscli_bench_cb(const hashlist_t *params);
 
 #endif /* _CLI_CMDS_H */
@@ -32,7 +32,9 @@
 
 /************************** Analyzer Client API *******************************/
 suscli_analyzer_client_t *
-suscli_analyzer_client_new(int sfd, unsigned int compress_threshold)
+suscli_analyzer_client_new(
+  int sfd,
+  const struct suscli_analyzer_compress_params *compress)
 {
   struct sockaddr_in sin;
   struct suscan_analyzer_params params = suscan_analyzer_params_INITIALIZER;
@@ -79,7 +81,7 @@ suscli_analyzer_client_new(int sfd, unsigned int compress_threshold)
       suscli_analyzer_client_tx_thread_initialize(
         &new->tx, 
         sfd,
-        compress_threshold),
+        compress),
       goto fail);
 
   SU_MAKE_FAIL(new->req_table, rbtree);
@@ -680,6 +682,18 @@ suscli_analyzer_client_write_buffer_zerocopy(
   return SU_TRUE;
 }
 
+SUBOOL
+suscli_analyzer_client_write_shared(
+    suscli_analyzer_client_t *self,
+    struct suscli_analyzer_shared_pdu *pdu)
+{
+  SU_TRYCATCH(
+      suscli_analyzer_client_tx_thread_push_shared(&self->tx, pdu),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
 SUBOOL
 suscli_analyzer_client_write_buffer(
     suscli_analyzer_client_t *self,
@@ -1104,7 +1118,8 @@ suscli_analyzer_client_list_init(
     struct suscli_analyzer_client_list *self,
     int listen_fd,
     int cancel_fd,
-    const char *ifname)
+    const char *ifname,
+    unsigned int mc_mtu)
 {
   SUBOOL ok = SU_FALSE;
 
@@ -1120,7 +1135,8 @@ suscli_analyzer_client_list_init(
      */
     self->mc_manager = suscli_multicast_manager_new(
       ifname,
-      SUSCLI_MULTICAST_PORT);
+      SUSCLI_MULTICAST_PORT,
+      mc_mtu);
   }
 
   SU_MAKE(self->client_tree, rbtree);
@@ -1300,6 +1316,56 @@ done:
   return ok;
 }
 
+SUPRIVATE SUBOOL
+suscli_analyzer_client_list_call_is_discardable(
+    const struct suscan_analyzer_remote_call *call)
+{
+  const struct suscan_analyzer_psd_msg *psd;
+  const struct suscan_analyzer_inspector_msg *insp;
+
+  if (call->type != SUSCAN_ANALYZER_REMOTE_MESSAGE)
+    return SU_FALSE;
+
+  switch (call->msg.type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
+      psd = call->msg.ptr;
+      return !psd->looped;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
+      insp = call->msg.ptr;
+      return insp->kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SPECTRUM;
+
+    default:
+      return SU_FALSE;
+  }
+}
+
+/*
+ * Messages added to the 0.8 protocol later are not understood by older
+ * clients, which would drop the connection on them. Returns the auth
+ * flags a client must have announced to receive this call, or 0 if
+ * every client understands it.
+ */
+SUPRIVATE uint32_t
+suscli_analyzer_client_list_call_required_flags(
+    const struct suscan_analyzer_remote_call *call)
+{
+  if (call->type != SUSCAN_ANALYZER_REMOTE_MESSAGE)
+    return 0;
+
+  switch (call->msg.type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_BAND:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP_STATS:
+      return SUSCAN_REMOTE_FLAGS_SWEEP;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
+      return SUSCAN_REMOTE_FLAGS_SAMPLES_LOST;
+
+    default:
+      return 0;
+  }
+}
+
 SUBOOL
 suscli_analyzer_client_list_broadcast_unsafe(
     struct suscli_analyzer_client_list *self,
@@ -1312,20 +1378,25 @@ suscli_analyzer_client_list_broadcast_unsafe(
 {
   suscli_analyzer_client_t *this;
   grow_buf_t pdu = grow_buf_INITIALIZER;
+  struct suscli_analyzer_shared_pdu *shared = NULL;
   SUBOOL mc_enabled = self->mc_manager != NULL;
+  uint32_t required = suscli_analyzer_client_list_call_required_flags(call);
   SUBOOL unicast;
   int error;
   SUBOOL ok = SU_FALSE;
 
+  /*
+   * Multicast reaches every client regardless of its capabilities.
+   * Messages that older clients do not understand are sent by unicast.
+   */
+  if (required != 0)
+    mc_enabled = SU_FALSE;
+
   /* Step 1: If multicast is enabled, chop and send via multicast */
   if (mc_enabled)
     SU_TRY(suscli_multicast_manager_deliver_call(self->mc_manager, call));
 
   /* Step 2: For non-multicast clients, make a normal PDU and send */
-  SU_TRYCATCH(
-    suscan_analyzer_remote_call_serialize(call, &pdu),
-    goto done);
-
   this = self->client_head;  
   while (this != NULL) {
     unicast = 
@@ -1333,8 +1404,29 @@ suscli_analyzer_client_list_broadcast_unsafe(
 
     if (suscli_analyzer_client_can_write(this)
         && suscli_analyzer_client_has_source_info(this)
+        && suscli_analyzer_client_has_flags(this, required)
         && unicast) {
-      if (!suscli_analyzer_client_write_buffer(this, &pdu)) {
+      /*
+       * Serialize and compress only once, and only if there is at least
+       * one recipient. All TX threads share the resulting PDU.
+       */
+      if (shared == NULL) {
+        SU_TRYCATCH(
+          suscan_analyzer_remote_call_serialize(call, &pdu),
+          goto done);
+
+        SU_TRYCATCH(
+          shared = suscli_analyzer_shared_pdu_new(
+            &pdu,
+            self->compress.threshold,
+            &self->deflater),
+          goto done);
+
+        shared->discardable =
+          suscli_analyzer_client_list_call_is_discardable(call);
+      }
+
+      if (!suscli_analyzer_client_write_shared(this, shared)) {
         error = errno;
         SU_WARNING(
             "%s: write failed (%s)\n",
@@ -1350,6 +1442,9 @@ suscli_analyzer_client_list_broadcast_unsafe(
   ok = SU_TRUE;
 
 done:
+  if (shared != NULL)
+    suscli_analyzer_shared_pdu_unref(shared);
+
   grow_buf_finalize(&pdu);
 
   return ok;
@@ -1495,6 +1590,8 @@ suscli_analyzer_client_list_finalize(struct suscli_analyzer_client_list *self)
   if (self->mc_manager != NULL)
     suscli_multicast_manager_destroy(self->mc_manager);
 
+  suscan_remote_deflater_finalize(&self->deflater);
+
   if (self->client_tree != NULL)
     rbtree_destroy(self->client_tree);
 
@@ -22,6 +22,7 @@
 
 #include <util/compat-unistd.h>
 #include <analyzer/impl/remote.h>
+#include <analyzer/impl/multicast.h>
 #include <util/rbtree.h>
 #include <util/hashlist.h>
 #include <util/compat-inet.h>
@@ -63,11 +64,53 @@ struct suscli_analyzer_client_inspector_list {
 
 #define SUSCLI_ANALYZER_CLIENT_TX_MESSAGE 0
 #define SUSCLI_ANALYZER_CLIENT_TX_CANCEL  1
+#define SUSCLI_ANALYZER_CLIENT_TX_SHARED  2
+
+#define SUSCLI_ANALYZER_DEFAULT_COMPRESS_THRESHOLD 1400
+
+struct suscli_analyzer_compress_params {
+  unsigned int threshold; /* PDUs bigger than this are compressed (0: never) */
+  int          level;     /* zlib compression level */
+  int          strategy;  /* zlib compression strategy */
+};
+
+#define suscli_analyzer_compress_params_INITIALIZER \
+{                                                   \
+  SUSCLI_ANALYZER_DEFAULT_COMPRESS_THRESHOLD,       \
+  SUSCAN_REMOTE_DEFAULT_COMPRESS_LEVEL,             \
+  SUSCAN_REMOTE_DEFAULT_COMPRESS_STRATEGY           \
+}
+
+/*
+ * Broadcast PDUs are serialized (and compressed, if needed) only once,
+ * and shared by the TX threads of all recipients. The last one to send
+ * it releases the buffer.
+ */
+struct suscli_analyzer_shared_pdu {
+  unsigned int refcount;
+  uint32_t     magic;       /* PDU header magic (plain or compressed) */
+  SUBOOL       discardable; /* May be dropped by the TX queue cleanup */
+  grow_buf_t   buffer;
+};
+
+struct suscli_analyzer_shared_pdu *suscli_analyzer_shared_pdu_new(
+    grow_buf_t *pdu,
+    unsigned int compress_threshold,
+    struct suscan_remote_deflater *deflater);
+
+void suscli_analyzer_shared_pdu_ref(struct suscli_analyzer_shared_pdu *self);
+
+void suscli_analyzer_shared_pdu_unref(struct suscli_analyzer_shared_pdu *self);
 
 #define SUSCLI_ANALYZER_CLIENT_TX_CLEANUP_WATERMARK 50
+#define SUSCLI_ANALYZER_CLIENT_TX_BATCH_SIZE        16
 
 struct suscli_analyzer_client_tx_thread {
-  unsigned int      compress_threshold;
+  struct suscli_analyzer_compress_params compress;
+  struct suscan_remote_deflater deflater;   /* TX thread only */
+  grow_buf_t compressed[SUSCLI_ANALYZER_CLIENT_TX_BATCH_SIZE]; /* Ditto */
+  uint64_t   pdus_sent;                     /* TX thread only */
+  uint64_t   send_calls;                    /* TX thread only */
   struct suscan_mq  pool;
   SUBOOL            pool_initialized;
   struct suscan_mq  queue;
@@ -97,10 +140,14 @@ SUBOOL suscli_analyzer_client_tx_thread_push_zerocopy(
     struct suscli_analyzer_client_tx_thread *self,
     grow_buf_t *pdu);
 
+SUBOOL suscli_analyzer_client_tx_thread_push_shared(
+    struct suscli_analyzer_client_tx_thread *self,
+    struct suscli_analyzer_shared_pdu *pdu);
+
 SUBOOL suscli_analyzer_client_tx_thread_initialize(
     struct suscli_analyzer_client_tx_thread *self,
     int fd,
-    unsigned int compress_threshold);
+    const struct suscli_analyzer_compress_params *compress);
 
 /* 
  * This strucure relates global request IDs with per-client
@@ -178,7 +225,7 @@ struct suscli_analyzer_client {
   SUBOOL failed;
   SUBOOL closed;
   unsigned int epoch;
-  unsigned int compress_threshold;
+  uint32_t flags; /* As announced in the client auth */
   struct timeval conntime;
   struct in_addr remote_addr;
   
@@ -286,6 +333,14 @@ suscli_analyzer_client_accepts_multicast(const suscli_analyzer_client_t *self)
   return self->accepts_multicast;
 }
 
+SUINLINE SUBOOL
+suscli_analyzer_client_has_flags(
+    const suscli_analyzer_client_t *self,
+    uint32_t flags)
+{
+  return (self->flags & flags) == flags;
+}
+
 SUINLINE SUBOOL
 suscli_analyzer_client_can_write(const suscli_analyzer_client_t *self)
 {
@@ -338,7 +393,7 @@ suscli_analyzer_client_mark_failed(suscli_analyzer_client_t *self)
 
 suscli_analyzer_client_t *suscli_analyzer_client_new(
   int sfd,
-  unsigned int compress_threshold);
+  const struct suscli_analyzer_compress_params *compress);
 
 SUINLINE void
 suscli_analyzer_client_set_analyzer_params(
@@ -402,6 +457,10 @@ SUBOOL suscli_analyzer_client_write_buffer_zerocopy(
     suscli_analyzer_client_t *self,
     grow_buf_t *buffer);
 
+SUBOOL suscli_analyzer_client_write_shared(
+    suscli_analyzer_client_t *self,
+    struct suscli_analyzer_shared_pdu *pdu);
+
 SUBOOL suscli_analyzer_client_send_source_info(
     suscli_analyzer_client_t *self,
     const struct suscan_analyzer_source_info *info,
@@ -446,6 +505,10 @@ struct suscli_analyzer_client_list {
 
   struct suscli_multicast_manager *mc_manager;
 
+  /* Compression settings and context for broadcast PDUs */
+  struct suscli_analyzer_compress_params compress;
+  struct suscan_remote_deflater          deflater;
+
   /* Actual list */
   suscli_analyzer_client_t *client_head;
   rbtree_t                 *client_tree;
@@ -500,6 +563,20 @@ suscli_analyzer_client_list_supports_multicast(
   return self->mc_manager != NULL;
 }
 
+SUINLINE void
+suscli_analyzer_client_list_set_compress_params(
+  struct suscli_analyzer_client_list *self,
+  const struct suscli_analyzer_compress_params *compress)
+{
+  self->compress = *compress;
+
+  suscan_remote_deflater_finalize(&self->deflater);
+  suscan_remote_deflater_init(
+    &self->deflater,
+    compress->level,
+    compress->strategy);
+}
+
 SUINLINE void
 suscli_analyzer_client_list_increment_epoch(
     struct suscli_analyzer_client_list *self)
@@ -511,7 +588,8 @@ SUBOOL suscli_analyzer_client_list_init(
     struct suscli_analyzer_client_list *,
     int listen_fd,
     int cancel_fd,
-    const char *ifname);
+    const char *ifname,
+    unsigned int mc_mtu);
 
 SUBOOL suscli_analyzer_client_list_append_client(
     struct suscli_analyzer_client_list *self,
@@ -589,17 +667,23 @@ struct suscli_analyzer_server_params {
   suscan_source_config_t *profile;
   uint16_t    port;
   const char *ifname;
+  unsigned int mc_mtu;
+  unsigned int capture_ring_depth;
   size_t      compress_threshold;
+  int         compress_level;
+  int         compress_strategy;
 };
 
-#define SUSCLI_ANALYZER_DEFAULT_COMPRESS_THRESHOLD 1400
-
 #define suscli_analyzer_server_params_INITIALIZER \
 {                                                 \
   NULL,        /* profile */                      \
   28001,       /* port */                         \
   NULL,        /* ifname */                       \
-  SUSCLI_ANALYZER_DEFAULT_COMPRESS_THRESHOLD      \
+  SUSCLI_MULTICAST_FRAGMENT_MTU, /* mc_mtu */     \
+  0,           /* capture_ring_depth */           \
+  SUSCLI_ANALYZER_DEFAULT_COMPRESS_THRESHOLD,     \
+  SUSCAN_REMOTE_DEFAULT_COMPRESS_LEVEL,           \
+  SUSCAN_REMOTE_DEFAULT_COMPRESS_STRATEGY         \
 }
 
 struct suscli_analyzer_server {
@@ -17,6 +17,8 @@
 
 */
 
+#define _GNU_SOURCE
+
 #define SU_LOG_DOMAIN "multicast-manager"
 
 #include <analyzer/impl/multicast.h>
@@ -27,6 +29,20 @@
 #include <util/compat.h>
 #include <analyzer/msg.h>
 
+#ifdef __linux__
+#  define SUSCLI_MULTICAST_USE_SENDMMSG
+#endif /* __linux__ */
+
+/*
+ * Fragments are queued for the TX worker in batches, saving one queue
+ * round-trip per fragment.
+ */
+struct suscli_multicast_fragment_batch {
+  uint32_t     types[SUSCLI_MULTICAST_TX_BATCH_SIZE];
+  void        *frags[SUSCLI_MULTICAST_TX_BATCH_SIZE];
+  unsigned int count;
+};
+
 SUPRIVATE
 SU_METHOD(
   suscli_multicast_manager,
@@ -93,6 +109,93 @@ done:
   return ok;
 }
 
+#ifdef SUSCLI_MULTICAST_USE_SENDMMSG
+SUPRIVATE SU_METHOD(
+  suscli_multicast_manager,
+  SUBOOL,
+  send_fragments,
+  struct suscan_analyzer_fragment_header **frags,
+  unsigned int count)
+{
+  struct mmsghdr msgs[SUSCLI_MULTICAST_TX_BATCH_SIZE];
+  struct iovec   iov[SUSCLI_MULTICAST_TX_BATCH_SIZE];
+  unsigned int i, p = 0;
+  int ret;
+
+  memset(msgs, 0, count * sizeof(struct mmsghdr));
+
+  for (i = 0; i < count; ++i) {
+    iov[i].iov_base = frags[i];
+    iov[i].iov_len  = SUSCLI_MULTICAST_FRAG_SIZE(ntohs(frags[i]->size));
+
+    msgs[i].msg_hdr.msg_name    = &self->mc_addr;
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    msgs[i].msg_hdr.msg_iov     = iov + i;
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+  }
+
+  while (p < count) {
+    ret = sendmmsg(self->fd, msgs + p, count - p, 0);
+
+    if (ret == -1) {
+      if (errno == EINTR)
+        continue;
+      SU_ERROR("Failed to send fragments: %s\n", strerror(errno));
+      return SU_FALSE;
+    } else if (ret == 0) {
+      SU_WARNING("Multicast socket closed!\n");
+      return SU_FALSE;
+    }
+
+    for (i = p; i < p + ret; ++i)
+      if (msgs[i].msg_len != iov[i].iov_len) {
+        SU_ERROR(
+          "Datagram truncation (%u/%u)\n",
+          msgs[i].msg_len,
+          (unsigned int) iov[i].iov_len);
+        return SU_FALSE;
+      }
+
+    p += ret;
+  }
+
+  return SU_TRUE;
+}
+#else
+SUPRIVATE SU_METHOD(
+  suscli_multicast_manager,
+  SUBOOL,
+  send_fragments,
+  struct suscan_analyzer_fragment_header **frags,
+  unsigned int count)
+{
+  unsigned int i;
+  int ret;
+  int size;
+
+  for (i = 0; i < count; ++i) {
+    size = SUSCLI_MULTICAST_FRAG_SIZE(ntohs(frags[i]->size));
+    if ((ret = sendto(
+      self->fd,
+      (void *) frags[i],
+      size,
+      0,
+      (struct sockaddr *) &self->mc_addr,
+      sizeof(struct sockaddr_in))) != size) {
+      if (ret == 0)
+        SU_WARNING("Multicast socket closed!\n");
+      else if (ret == -1)
+        SU_ERROR("Failed to send fragment: %s\n", strerror(errno));
+      else
+        SU_ERROR("Datagram truncation (%d/%d)\n", ret, size);
+      return SU_FALSE;
+    }
+  }
+
+  return SU_TRUE;
+}
+#endif /* SUSCLI_MULTICAST_USE_SENDMMSG */
+
 /* All messages are guaranteed to be allocated up to the MTU size */
 SUPRIVATE SUBOOL
 suscli_multicast_manager_tx_cb(
@@ -102,39 +205,40 @@ suscli_multicast_manager_tx_cb(
 {
   suscli_multicast_manager_t *self = 
     (suscli_multicast_manager_t *) wk_private;
-  struct suscan_analyzer_fragment_header *header = NULL;
-  uint32_t type;
-  int ret;
-  int size;
+  struct suscan_msg *batch[SUSCLI_MULTICAST_TX_BATCH_SIZE];
+  struct suscan_analyzer_fragment_header *frags[SUSCLI_MULTICAST_TX_BATCH_SIZE];
+  uint32_t types[SUSCLI_MULTICAST_TX_BATCH_SIZE];
+  struct timeval tv = {0, 0};
+  unsigned int i, count, n;
 
   while (!self->cancelled 
-      && suscan_mq_poll(&self->queue, &type, (void **) &header)) {
-    if (type == SUSCLI_MULTICAST_FRAG_MESSAGE) {
-      if (!self->cancelled) {
-        size = SUSCLI_MULTICAST_FRAG_SIZE(ntohs(header->size));
-        if ((ret = sendto(
-          self->fd,
-          (void *) header,
-          size,
-          0,
-          (struct sockaddr *) &self->mc_addr,
-          sizeof(struct sockaddr_in))) != size) {
-          if (ret == 0)
-            SU_WARNING("Multicast socket closed!\n");
-          else if (ret == -1)
-            SU_ERROR("Failed to send announce message: %s\n", strerror(errno));
-          else
-            SU_ERROR("Datagram truncation (%d/%d)\n", ret, size);
-          self->cancelled = SU_TRUE;
-        }
-
-        gettimeofday(&self->last_tx, NULL);
+      && (count = suscan_mq_read_batch(
+        &self->queue,
+        batch,
+        SUSCLI_MULTICAST_TX_BATCH_SIZE,
+        &tv)) > 0) {
+    n = 0;
+
+    for (i = 0; i < count; ++i) {
+      if (batch[i]->type == SUSCLI_MULTICAST_FRAG_MESSAGE) {
+        types[n]   = batch[i]->type;
+        frags[n++] = batch[i]->privdata;
       }
 
-      /* TODO: Add growth control here */
-      if (!suscan_mq_write(&self->pool, type, header))
-        free(header);
+      suscan_msg_destroy(batch[i]);
     }
+
+    if (!self->cancelled && n > 0) {
+      if (!suscli_multicast_manager_send_fragments(self, frags, n))
+        self->cancelled = SU_TRUE;
+
+      gettimeofday(&self->last_tx, NULL);
+    }
+
+    /* TODO: Add growth control here */
+    if (!suscan_mq_write_batch(&self->pool, types, (void **) frags, n))
+      for (i = 0; i < n; ++i)
+        free(frags[i]);
   } 
 
   return SU_FALSE;
@@ -234,12 +338,27 @@ done:
   return NULL;
 }
 
-SU_INSTANCER(suscli_multicast_manager, const char *ifname, uint16_t port)
+SU_INSTANCER(
+  suscli_multicast_manager,
+  const char *ifname,
+  uint16_t port,
+  unsigned int mtu)
 {
   suscli_multicast_manager_t *new = NULL;
 
+  if (mtu < SUSCLI_MULTICAST_FRAGMENT_MTU 
+    || mtu > SUSCLI_MULTICAST_MAX_FRAGMENT_MTU) {
+    SU_ERROR(
+      "Invalid multicast MTU %u (must be between %u and %u)\n",
+      mtu,
+      SUSCLI_MULTICAST_FRAGMENT_MTU,
+      SUSCLI_MULTICAST_MAX_FRAGMENT_MTU);
+    return NULL;
+  }
+
   SU_ALLOCATE_FAIL(new, suscli_multicast_manager_t);
   new->fd = -1;
+  new->mtu = mtu;
   new->cancel_pipefd[0] = -1;
   new->cancel_pipefd[1] = -1;
 
@@ -333,9 +452,9 @@ SUPRIVATE SU_METHOD(
   void *data = NULL;
 
   if (!suscan_mq_poll(&self->pool, &type, &data))
-    SU_ALLOCATE_MANY(data, SUSCLI_MULTICAST_FRAGMENT_MTU, uint8_t);
+    SU_ALLOCATE_MANY(data, self->mtu, uint8_t);
 
-  usable = SUSCLI_MULTICAST_FRAGMENT_MTU - SUSCLI_MULTICAST_FRAG_SIZE(0);
+  usable = self->mtu - SUSCLI_MULTICAST_FRAG_SIZE(0);
 
   msg = data;
   msg->magic = htonl(SUSCAN_REMOTE_FRAGMENT_HEADER_MAGIC);
@@ -345,6 +464,56 @@ done:
   return msg;
 }
 
+SUPRIVATE SU_METHOD(
+  suscli_multicast_manager,
+  SUBOOL,
+  flush_fragments,
+  struct suscli_multicast_fragment_batch *batch)
+{
+  if (batch->count > 0) {
+    if (!suscan_mq_write_batch(
+      &self->queue,
+      batch->types,
+      batch->frags,
+      batch->count))
+      return SU_FALSE;
+
+    batch->count = 0;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SU_METHOD(
+  suscli_multicast_manager,
+  SUBOOL,
+  queue_fragment,
+  struct suscli_multicast_fragment_batch *batch,
+  struct suscan_analyzer_fragment_header *header)
+{
+  if (batch->count == SUSCLI_MULTICAST_TX_BATCH_SIZE)
+    if (!suscli_multicast_manager_flush_fragments(self, batch))
+      return SU_FALSE;
+
+  batch->types[batch->count] = SUSCLI_MULTICAST_FRAG_MESSAGE;
+  batch->frags[batch->count] = header;
+  ++batch->count;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscli_multicast_fragment_batch_discard(
+  struct suscli_multicast_fragment_batch *batch)
+{
+  unsigned int i;
+
+  for (i = 0; i < batch->count; ++i)
+    free(batch->frags[i]);
+
+  batch->count = 0;
+}
+
 SUPRIVATE SU_METHOD(
   suscli_multicast_manager,
   SUBOOL, 
@@ -354,6 +523,7 @@ SUPRIVATE SU_METHOD(
   struct suscan_analyzer_psd_msg *msg;
   struct suscan_analyzer_fragment_header *header;
   struct suscan_analyzer_psd_sf_fragment frag, *payload;
+  struct suscli_multicast_fragment_batch batch;
   unsigned int usable;
   unsigned int i, count, size;
   uint8_t id = self->id++;
@@ -361,7 +531,9 @@ SUPRIVATE SU_METHOD(
   unsigned int sfsize = SUSCLI_MULTICAST_FRAG_SIZE(psdsf);
   SUBOOL ok = SU_FALSE;
 
-  usable = (SUSCLI_MULTICAST_FRAGMENT_MTU - sfsize) / sizeof(SUFLOAT);
+  batch.count = 0;
+
+  usable = (self->mtu - sfsize) / sizeof(SUFLOAT);
 
   msg = call->msg.ptr;
 
@@ -406,15 +578,12 @@ SUPRIVATE SU_METHOD(
       msg->psd_data + i * usable,
       size * sizeof(SUFLOAT));
 
-    SU_TRY(
-      suscan_mq_write(
-        &self->queue,
-        SUSCLI_MULTICAST_FRAG_MESSAGE,
-        header));
-    
+    SU_TRY(suscli_multicast_manager_queue_fragment(self, &batch, header));
     header = NULL;
   }
 
+  SU_TRY(suscli_multicast_manager_flush_fragments(self, &batch));
+
   /* Messages successfully queued, wake up worker */
   SU_TRY(
     suscan_worker_push(
@@ -425,6 +594,8 @@ SUPRIVATE SU_METHOD(
   ok = SU_TRUE;
 
 done:
+  suscli_multicast_fragment_batch_discard(&batch);
+
   if (header != NULL)
     free(header);
 
@@ -439,6 +610,7 @@ SUPRIVATE SU_METHOD(
 {
   struct suscan_analyzer_fragment_header *header = NULL;
   grow_buf_t pdu = grow_buf_INITIALIZER;
+  struct suscli_multicast_fragment_batch batch;
   unsigned int usable;
   unsigned int i, count, size;
   unsigned int full_size;
@@ -446,7 +618,9 @@ SUPRIVATE SU_METHOD(
   uint8_t id = self->id++;
   SUBOOL ok = SU_FALSE;
 
-  usable = SUSCLI_MULTICAST_FRAGMENT_MTU 
+  batch.count = 0;
+
+  usable = self->mtu
     - SUSCLI_MULTICAST_FRAG_SIZE(
       sizeof(struct suscan_analyzer_psd_sf_fragment));
 
@@ -472,15 +646,12 @@ SUPRIVATE SU_METHOD(
 
     memcpy(header->sf_data, as_bytes + i * usable, size);
 
-    SU_TRY(
-      suscan_mq_write(
-        &self->queue,
-        SUSCLI_MULTICAST_FRAG_MESSAGE,
-        header));
-    
+    SU_TRY(suscli_multicast_manager_queue_fragment(self, &batch, header));
     header = NULL;
   }
 
+  SU_TRY(suscli_multicast_manager_flush_fragments(self, &batch));
+
   /* Messages successfully queued, wake up worker */
   SU_TRY(
     suscan_worker_push(
@@ -491,6 +662,7 @@ SUPRIVATE SU_METHOD(
   ok = SU_TRUE;
 
 done:
+  suscli_multicast_fragment_batch_discard(&batch);
   grow_buf_finalize(&pdu);
 
   if (header != NULL)
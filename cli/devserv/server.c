@@ -515,6 +515,7 @@ suscli_analyzer_server_process_auth_message(
     client->auth = SU_TRUE;
     client->accepts_multicast = 
       !!(call->client_auth.flags & SUSCAN_REMOTE_FLAGS_MULTICAST);
+    client->flags = call->client_auth.flags;
   }
 
   ok = SU_TRUE;
@@ -1058,7 +1059,7 @@ suscli_analyzer_server_register_clients(suscli_analyzer_server_t *self)
       (struct sockaddr *) &inaddr,
       &len)) != -1) {
     SU_TRYCATCH(
-        client = suscli_analyzer_client_new(fd, self->params.compress_threshold),
+        client = suscli_analyzer_client_new(fd, &self->client_list.compress),
         goto done);
 
     suscli_analyzer_client_set_analyzer_params(
@@ -1310,12 +1311,15 @@ suscli_analyzer_server_new_with_params(
   suscli_analyzer_server_t *new = NULL;
   struct suscan_analyzer_params analyzer_params =
       suscan_analyzer_params_INITIALIZER;
+  struct suscli_analyzer_compress_params compress =
+      suscli_analyzer_compress_params_INITIALIZER;
   int sfd = -1;
 
   SU_ALLOCATE(new, suscli_analyzer_server_t);
 
   new->params = *params;
   new->analyzer_params = analyzer_params;
+  new->analyzer_params.capture_ring_depth = params->capture_ring_depth;
 
   new->client_list.listen_fd = -1;
   new->client_list.cancel_fd = -1;
@@ -1340,7 +1344,13 @@ suscli_analyzer_server_new_with_params(
     &new->client_list,
     sfd,
     new->cancel_pipefd[0],
-    params->ifname);
+    params->ifname,
+    params->mc_mtu);
+
+  compress.threshold = params->compress_threshold;
+  compress.level     = params->compress_level;
+  compress.strategy  = params->compress_strategy;
+  suscli_analyzer_client_list_set_compress_params(&new->client_list, &compress);
 
   SU_TRYC(
       pthread_create(
@@ -30,12 +30,21 @@
 #  define MSG_NOSIGNAL 0
 #endif
 
+#ifndef _WIN32
+#  include <sys/uio.h>
+#  define SUSCLI_ANALYZER_CLIENT_TX_USE_SENDMSG
+#endif /* _WIN32 */
+
+/*
+ * Released PDU buffers keep their allocation, so that the next PDU pushed
+ * to this client can reuse it instead of allocating a new one.
+ */
 SUPRIVATE void
 suscli_analyzer_client_tx_thread_dispose_buffer(
     struct suscli_analyzer_client_tx_thread *self,
     grow_buf_t *buffer)
 {
-  grow_buf_clear(buffer);
+  grow_buf_shrink(buffer);
 
   if (!suscan_mq_write(&self->pool, 0, buffer)) {
     grow_buf_finalize(buffer);
@@ -59,143 +68,294 @@ suscli_analyzer_client_tx_thread_alloc_buffer(
   return new;
 }
 
-SUINLINE SUBOOL
-suscli_analyzer_client_tx_thread_helper_send(
-  int fd,
-  const void *data,
-  size_t size)
+/***************************** Shared PDUs **********************************/
+struct suscli_analyzer_shared_pdu *
+suscli_analyzer_shared_pdu_new(
+    grow_buf_t *pdu,
+    unsigned int compress_threshold,
+    struct suscan_remote_deflater *deflater)
 {
-  const uint8_t *bytes = data;
-  size_t p = 0;
-  ssize_t got = 0;
+  struct suscli_analyzer_shared_pdu *new = NULL;
+
+  SU_ALLOCATE_FAIL(new, struct suscli_analyzer_shared_pdu);
+
+  new->refcount = 1;
+
+  if (compress_threshold > 0 && grow_buf_get_size(pdu) > compress_threshold) {
+    SU_TRYCATCH(
+      suscan_remote_deflater_deflate(deflater, pdu, &new->buffer),
+      goto fail);
+    new->magic = SUSCAN_REMOTE_COMPRESSED_PDU_HEADER_MAGIC;
+  } else {
+    /* Small enough: just take the uncompressed PDU */
+    new->buffer = *pdu;
+    memset(pdu, 0, sizeof(grow_buf_t));
+    new->magic = SUSCAN_REMOTE_PDU_HEADER_MAGIC;
+  }
 
-  while (p < size) {
-    got = send(fd, bytes + p, size - p, MSG_NOSIGNAL);
-    if (got == 0) {
-      SU_ERROR("send(): connection closed by foreign host\n");
-      return SU_FALSE;
-    } else if (got < 0) {
-      SU_ERROR("send(): error: %s\n", strerror(errno));
-      return SU_FALSE;
-    }
+  return new;
 
-    p += got;
+fail:
+  if (new != NULL)
+    suscli_analyzer_shared_pdu_unref(new);
+
+  return NULL;
+}
+
+void
+suscli_analyzer_shared_pdu_ref(struct suscli_analyzer_shared_pdu *self)
+{
+  __atomic_add_fetch(&self->refcount, 1, __ATOMIC_RELAXED);
+}
+
+void
+suscli_analyzer_shared_pdu_unref(struct suscli_analyzer_shared_pdu *self)
+{
+  if (__atomic_sub_fetch(&self->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+    grow_buf_finalize(&self->buffer);
+    free(self);
   }
+}
 
-  return SU_TRUE;
+SUPRIVATE void
+suscli_analyzer_client_tx_thread_release(uint32_t type, void *data)
+{
+  if (data == NULL)
+    return;
+
+  if (type == SUSCLI_ANALYZER_CLIENT_TX_SHARED) {
+    suscli_analyzer_shared_pdu_unref(data);
+  } else {
+    grow_buf_finalize(data);
+    free(data);
+  }
 }
 
-SUINLINE SUBOOL
-suscli_analyzer_client_tx_thread_write_buffer_internal(
+/*
+ * PDUs read from the queue in the same batch are written together. Every
+ * PDU contributes its header and its body (plain, compressed by this
+ * thread or shared with other clients) to a single vectored write.
+ */
+struct suscli_analyzer_client_tx_pdu {
+  uint32_t type;
+  void    *data;
+
+  struct suscan_analyzer_remote_pdu_header header;
+  const grow_buf_t *body;
+};
+
+SUPRIVATE SUBOOL
+suscli_analyzer_client_tx_thread_prepare_pdu(
     struct suscli_analyzer_client_tx_thread *self,
-    uint32_t magic,
-    const grow_buf_t *buffer)
+    struct suscli_analyzer_client_tx_pdu *pdu,
+    grow_buf_t *compressed)
 {
-  struct suscan_analyzer_remote_pdu_header header;
-  const uint8_t *data;
-  size_t size, chunksize;
-  SUBOOL ok = SU_FALSE;
+  struct suscli_analyzer_shared_pdu *shared;
+  uint32_t magic;
+
+  if (pdu->type == SUSCLI_ANALYZER_CLIENT_TX_SHARED) {
+    /* Already serialized and compressed by the broadcaster */
+    shared    = pdu->data;
+    magic     = shared->magic;
+    pdu->body = &shared->buffer;
+  } else if (self->compress.threshold > 0 
+    && grow_buf_get_size(pdu->data) > self->compress.threshold) {
+    SU_TRYCATCH(
+      suscan_remote_deflater_deflate(&self->deflater, pdu->data, compressed),
+      return SU_FALSE);
+    magic     = SUSCAN_REMOTE_COMPRESSED_PDU_HEADER_MAGIC;
+    pdu->body = compressed;
+  } else {
+    magic     = SUSCAN_REMOTE_PDU_HEADER_MAGIC;
+    pdu->body = pdu->data;
+  }
 
-  data = grow_buf_get_buffer(buffer);
-  size = grow_buf_get_size(buffer);
+  pdu->header.magic = htonl(magic);
+  pdu->header.size  = htonl(grow_buf_get_size(pdu->body));
 
-  header.magic = htonl(magic);
-  header.size  = htonl(size);
+  return SU_TRUE;
+}
 
-  chunksize = sizeof(struct suscan_analyzer_remote_pdu_header);
+#ifdef SUSCLI_ANALYZER_CLIENT_TX_USE_SENDMSG
+SUPRIVATE SUBOOL
+suscli_analyzer_client_tx_thread_helper_sendv(
+  struct suscli_analyzer_client_tx_thread *self,
+  struct iovec *iov,
+  unsigned int iovcnt)
+{
+  struct msghdr msg;
+  ssize_t got;
 
-  if (!suscli_analyzer_client_tx_thread_helper_send(
-    self->fd,
-    &header,
-    chunksize))
-    goto done;
+  memset(&msg, 0, sizeof(struct msghdr));
 
-  /*
-   * Calls can be extremely big, so we better send them in small chunks. Also,
-   * this loop may be slow and thread may have been cancelled in the
-   * meantime. Check for every chunk whether it was cancelled before
-   * continuing.
-   */
+  while (iovcnt > 0) {
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = iovcnt;
 
-  while (size > 0 && !self->thread_cancelled) {
-    chunksize = size;
-    if (chunksize > SUSCAN_REMOTE_READ_BUFFER)
-      chunksize = SUSCAN_REMOTE_READ_BUFFER;
+    got = sendmsg(self->fd, &msg, MSG_NOSIGNAL);
+    ++self->send_calls;
 
-    if (!suscli_analyzer_client_tx_thread_helper_send(
-      self->fd,
-      data,
-      chunksize))
-      goto done;
+    if (got == 0) {
+      SU_ERROR("sendmsg(): connection closed by foreign host\n");
+      return SU_FALSE;
+    } else if (got < 0) {
+      if (errno == EINTR)
+        continue;
+      SU_ERROR("sendmsg(): error: %s\n", strerror(errno));
+      return SU_FALSE;
+    }
 
-    data += chunksize;
-    size -= chunksize;
-  }
+    /* Partial write: skip what was sent and try again */
+    while (iovcnt > 0 && (size_t) got >= iov->iov_len) {
+      got -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
 
-  ok = SU_TRUE;
+    if (iovcnt > 0) {
+      iov->iov_base  = (uint8_t *) iov->iov_base + got;
+      iov->iov_len  -= got;
 
-done:
-  return ok;
+      /* Check cancellation between whole writes only */
+      if (self->thread_cancelled)
+        return SU_FALSE;
+    }
+  }
+
+  return SU_TRUE;
 }
 
-SUINLINE SUBOOL
-suscli_analyzer_client_tx_thread_write_compressed_buffer(
+SUPRIVATE SUBOOL
+suscli_analyzer_client_tx_thread_write_pdus(
     struct suscli_analyzer_client_tx_thread *self,
-    const grow_buf_t *buffer)
+    struct suscli_analyzer_client_tx_pdu *pdus,
+    unsigned int count)
 {
-  grow_buf_t compressed = grow_buf_INITIALIZER;
-  SUBOOL ok = SU_FALSE;
-  
-  SU_TRYCATCH(
-    suscan_remote_deflate_pdu((grow_buf_t *) buffer, &compressed),
-    goto done);
+  struct iovec iov[2 * SUSCLI_ANALYZER_CLIENT_TX_BATCH_SIZE];
+  unsigned int i;
+
+  for (i = 0; i < count; ++i) {
+    SU_TRYCATCH(
+      suscli_analyzer_client_tx_thread_prepare_pdu(
+        self,
+        pdus + i,
+        self->compressed + i),
+      return SU_FALSE);
+
+    iov[2 * i].iov_base     = &pdus[i].header;
+    iov[2 * i].iov_len      = sizeof(struct suscan_analyzer_remote_pdu_header);
+    iov[2 * i + 1].iov_base = grow_buf_get_buffer(pdus[i].body);
+    iov[2 * i + 1].iov_len  = grow_buf_get_size(pdus[i].body);
+  }
 
   SU_TRYCATCH(
-    suscli_analyzer_client_tx_thread_write_buffer_internal(
-      self, 
-      SUSCAN_REMOTE_COMPRESSED_PDU_HEADER_MAGIC, 
-      &compressed),
-    goto done);
+    suscli_analyzer_client_tx_thread_helper_sendv(self, iov, 2 * count),
+    return SU_FALSE);
 
-  ok = SU_TRUE;
+  self->pdus_sent += count;
 
-done:
-  grow_buf_finalize(&compressed);
+  return SU_TRUE;
+}
+#else
+SUINLINE SUBOOL
+suscli_analyzer_client_tx_thread_helper_send(
+  struct suscli_analyzer_client_tx_thread *self,
+  const void *data,
+  size_t size)
+{
+  const uint8_t *bytes = data;
+  size_t p = 0;
+  ssize_t got = 0;
 
-  return ok;
+  while (p < size) {
+    got = send(self->fd, bytes + p, size - p, MSG_NOSIGNAL);
+    ++self->send_calls;
+
+    if (got == 0) {
+      SU_ERROR("send(): connection closed by foreign host\n");
+      return SU_FALSE;
+    } else if (got < 0) {
+      SU_ERROR("send(): error: %s\n", strerror(errno));
+      return SU_FALSE;
+    }
+
+    p += got;
+  }
+
+  return SU_TRUE;
 }
 
 SUPRIVATE SUBOOL
-suscli_analyzer_client_tx_thread_write_buffer(
+suscli_analyzer_client_tx_thread_write_pdus(
     struct suscli_analyzer_client_tx_thread *self,
-    const grow_buf_t *buffer)
+    struct suscli_analyzer_client_tx_pdu *pdus,
+    unsigned int count)
 {
-  if (self->compress_threshold > 0 
-    && grow_buf_get_size(buffer) > self->compress_threshold)
-    return suscli_analyzer_client_tx_thread_write_compressed_buffer(
-      self, 
-      buffer);
-  else
-    return suscli_analyzer_client_tx_thread_write_buffer_internal(
-      self,
-      SUSCAN_REMOTE_PDU_HEADER_MAGIC,
-      buffer);
+  unsigned int i;
+
+  /* Check cancellation between whole writes only */
+  for (i = 0; i < count && !self->thread_cancelled; ++i) {
+    SU_TRYCATCH(
+      suscli_analyzer_client_tx_thread_prepare_pdu(
+        self,
+        pdus + i,
+        self->compressed),
+      return SU_FALSE);
+
+    SU_TRYCATCH(
+      suscli_analyzer_client_tx_thread_helper_send(
+        self,
+        &pdus[i].header,
+        sizeof(struct suscan_analyzer_remote_pdu_header)),
+      return SU_FALSE);
+
+    SU_TRYCATCH(
+      suscli_analyzer_client_tx_thread_helper_send(
+        self,
+        grow_buf_get_buffer(pdus[i].body),
+        grow_buf_get_size(pdus[i].body)),
+      return SU_FALSE);
+
+    ++self->pdus_sent;
+  }
+
+  return SU_TRUE;
 }
+#endif /* SUSCLI_ANALYZER_CLIENT_TX_USE_SENDMSG */
 
 SUPRIVATE void *
 suscli_analyzer_client_tx_thread_func(void *userdata)
 {
   struct suscli_analyzer_client_tx_thread *self =
       (struct suscli_analyzer_client_tx_thread *) userdata;
+  struct suscan_msg *batch[SUSCLI_ANALYZER_CLIENT_TX_BATCH_SIZE];
+  struct suscli_analyzer_client_tx_pdu pdus[SUSCLI_ANALYZER_CLIENT_TX_BATCH_SIZE];
   struct pollfd pollfds[2];
+  unsigned int i = 0, count = 0, pdu_count = 0;
   char b;
   uint32_t type;
-  grow_buf_t *buffer = NULL;
+  void *data;
 
-  while ((buffer = suscan_mq_read(&self->queue, &type)) != NULL) {
-    /* Cancelled via MQ. We should not reach this point in this impl. */
-    if (type == SUSCLI_ANALYZER_CLIENT_TX_CANCEL)
-      goto done;
+  while ((count = suscan_mq_read_batch(
+    &self->queue,
+    batch,
+    SUSCLI_ANALYZER_CLIENT_TX_BATCH_SIZE,
+    NULL)) > 0) {
+    pdu_count = 0;
+
+    for (i = 0; i < count; ++i) {
+      type = batch[i]->type;
+      data = batch[i]->privdata;
+      suscan_msg_destroy(batch[i]);
+
+      /* Cancelled via MQ. We should not reach this point in this impl. */
+      if (data == NULL || type == SUSCLI_ANALYZER_CLIENT_TX_CANCEL)
+        goto done;
+
+      pdus[pdu_count].type = type;
+      pdus[pdu_count].data = data;
+      ++pdu_count;
+    }
 
     pollfds[0].events  = POLLOUT | POLLERR | POLLHUP;
     pollfds[0].fd      = self->fd;
@@ -216,24 +376,48 @@ suscli_analyzer_client_tx_thread_func(void *userdata)
     if (pollfds[0].revents != 0) {
       if (pollfds[0].revents & POLLOUT) {
         SU_TRYCATCH(
-            suscli_analyzer_client_tx_thread_write_buffer(self, buffer),
-            goto done);
+          suscli_analyzer_client_tx_thread_write_pdus(self, pdus, pdu_count),
+          goto done);
       } else {
         /* Impossible to write to this fd, give up */
         goto done;
       }
     }
 
-    suscli_analyzer_client_tx_thread_dispose_buffer(self, buffer);
-    buffer = NULL;
+    for (i = 0; i < pdu_count; ++i) {
+      if (pdus[i].type == SUSCLI_ANALYZER_CLIENT_TX_SHARED)
+        suscli_analyzer_shared_pdu_unref(pdus[i].data);
+      else
+        suscli_analyzer_client_tx_thread_dispose_buffer(self, pdus[i].data);
+    }
+
+    pdu_count = 0;
   }
 
 done:
-  if (buffer != NULL) {
-    grow_buf_finalize(buffer);
-    free(buffer);
+  /* Release pending PDUs */
+  while (pdu_count > 0) {
+    --pdu_count;
+    suscli_analyzer_client_tx_thread_release(
+      pdus[pdu_count].type,
+      pdus[pdu_count].data);
   }
 
+  /* Release the rest of the batch */
+  while (++i < count) {
+    suscli_analyzer_client_tx_thread_release(
+      batch[i]->type,
+      batch[i]->privdata);
+    suscan_msg_destroy(batch[i]);
+  }
+
+  if (self->pdus_sent > 0)
+    SU_INFO(
+      "TX: %lu PDUs sent in %lu send calls (%.2f calls per PDU)\n",
+      (unsigned long) self->pdus_sent,
+      (unsigned long) self->send_calls,
+      (double) self->send_calls / self->pdus_sent);
+
   self->thread_finished = SU_TRUE;
 
   return NULL;
@@ -267,15 +451,12 @@ suscli_analyzer_client_tx_thread_cancel_soft(
 SUPRIVATE void
 suscli_analyzer_client_tx_consume_buffer_mq(struct suscan_mq *mq)
 {
-  grow_buf_t *buffer;
+  uint32_t type;
+  void *data;
 
-  while (suscan_mq_poll(mq, NULL, (void **) &buffer)) {
-    /* Null messages are used to notify special conditions */
-    if (buffer != NULL) {
-      grow_buf_finalize(buffer);
-      free(buffer);
-    }
-  }
+  /* Null messages are used to notify special conditions */
+  while (suscan_mq_poll(mq, &type, &data))
+    suscli_analyzer_client_tx_thread_release(type, data);
 }
 
 void
@@ -310,6 +491,8 @@ void
 suscli_analyzer_client_tx_thread_finalize(
     struct suscli_analyzer_client_tx_thread *self)
 {
+  unsigned int i;
+
   suscli_analyzer_client_tx_thread_stop(self);
 
   if (self->pool_initialized)
@@ -322,6 +505,11 @@ suscli_analyzer_client_tx_thread_finalize(
     close(self->cancel_pipefd[0]);
     close(self->cancel_pipefd[1]);
   }
+
+  suscan_remote_deflater_finalize(&self->deflater);
+
+  for (i = 0; i < SUSCLI_ANALYZER_CLIENT_TX_BATCH_SIZE; ++i)
+    grow_buf_clear(self->compressed + i);
 }
 
 SUBOOL
@@ -331,12 +519,21 @@ suscli_analyzer_client_tx_thread_push_zerocopy(
 {
   SUBOOL ok = SU_FALSE;
   grow_buf_t *buffer = NULL;
+  grow_buf_t tmp;
 
   SU_TRYCATCH(
       buffer = suscli_analyzer_client_tx_thread_alloc_buffer(self),
       goto done);
 
-  grow_buf_transfer(buffer, pdu);
+  /*
+   * Swap contents: the PDU goes to the queue and the allocation of the
+   * recycled buffer goes back to the caller, who will reuse it for the
+   * next PDU.
+   */
+  tmp     = *buffer;
+  *buffer = *pdu;
+  *pdu    = tmp;
+  grow_buf_shrink(pdu);
 
   SU_TRYCATCH(
       suscan_mq_write(&self->queue, SUSCLI_ANALYZER_CLIENT_TX_MESSAGE, buffer),
@@ -361,26 +558,49 @@ suscli_analyzer_client_tx_thread_push(
 {
   SUBOOL ok = SU_FALSE;
   void *buf;
-  grow_buf_t copy = grow_buf_INITIALIZER;
+  grow_buf_t *buffer = NULL;
+
+  SU_TRYCATCH(
+      buffer = suscli_analyzer_client_tx_thread_alloc_buffer(self),
+      goto done);
 
   SU_TRYCATCH(
-      buf = grow_buf_alloc(&copy, grow_buf_get_size(pdu)),
+      buf = grow_buf_alloc(buffer, grow_buf_get_size(pdu)),
       goto done);
 
   memcpy(buf, grow_buf_get_buffer(pdu), grow_buf_get_size(pdu));
 
   SU_TRYCATCH(
-      suscli_analyzer_client_tx_thread_push_zerocopy(self, &copy),
+      suscan_mq_write(&self->queue, SUSCLI_ANALYZER_CLIENT_TX_MESSAGE, buffer),
       goto done);
+  buffer = NULL;
 
   ok = SU_TRUE;
 
 done:
-  grow_buf_finalize(&copy);
+  if (buffer != NULL) {
+    grow_buf_finalize(buffer);
+    free(buffer);
+  }
 
   return ok;
 }
 
+SUBOOL
+suscli_analyzer_client_tx_thread_push_shared(
+    struct suscli_analyzer_client_tx_thread *self,
+    struct suscli_analyzer_shared_pdu *pdu)
+{
+  suscli_analyzer_shared_pdu_ref(pdu);
+
+  if (!suscan_mq_write(&self->queue, SUSCLI_ANALYZER_CLIENT_TX_SHARED, pdu)) {
+    suscli_analyzer_shared_pdu_unref(pdu);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
 /* Cleanup callbacks */
 struct suscli_analyzer_client_tx_thread_cleanup_ctx
 {
@@ -462,6 +682,17 @@ suscli_analyzer_client_tx_thread_try_destroy(
 
   suscan_analyzer_remote_call_init(&call, SUSCAN_ANALYZER_REMOTE_NONE);
 
+  /* Shared PDUs may be compressed. Rely on the broadcaster's hint. */
+  if (type == SUSCLI_ANALYZER_CLIENT_TX_SHARED) {
+    if (((struct suscli_analyzer_shared_pdu *) data)->discardable) {
+      suscli_analyzer_shared_pdu_unref(data);
+      ++ctx->discarded;
+      return SU_TRUE;
+    }
+
+    ctx->critical_reached = SU_TRUE;
+  }
+
   if (type == SUSCLI_ANALYZER_CLIENT_TX_MESSAGE) {
     buffer = data;
 
@@ -554,7 +785,7 @@ SUBOOL
 suscli_analyzer_client_tx_thread_initialize(
     struct suscli_analyzer_client_tx_thread *self,
     int fd,
-    unsigned int compress_threshold)
+    const struct suscli_analyzer_compress_params *compress)
 {
   struct suscan_mq_callbacks callbacks = 
   {
@@ -570,12 +801,19 @@ suscli_analyzer_client_tx_thread_initialize(
 
   self->cancel_pipefd[0] = self->cancel_pipefd[1] = -1;
   self->fd = fd;
-  self->compress_threshold = compress_threshold;
+  self->compress = *compress;
+
+  suscan_remote_deflater_init(
+    &self->deflater,
+    compress->level,
+    compress->strategy);
 
   SU_TRYCATCH(suscan_mq_init(&self->pool), goto done);
   self->pool_initialized = SU_TRUE;
 
-  SU_TRYCATCH(suscan_mq_init(&self->queue), goto done);
+  SU_TRYCATCH(
+    suscan_mq_init_ex(&self->queue, SUSCAN_MQ_BACKEND_LOCKFREE),
+    goto done);
   suscan_mq_set_callbacks(
     &self->queue,
     &callbacks);